@@ -0,0 +1,291 @@
+
+// =============================================================
+// Arena allocator
+//
+// An arena is a chain of blocks. Allocating adds the size to the
+// current block's position with one atomic add; when the block is
+// full the arena moves on to the next block of the chain, which is
+// allocated only the first time the chain is that long. Rewinding
+// makes an earlier position current again and keeps every block,
+// so once an arena has grown to what its user needs, rewinding and
+// allocating again never touch the heap.
+//
+// Sizes are rounded up to ARENA_ALIGNMENT. A block left because an
+// allocation did not fit keeps its unused end until a rewind.
+// =============================================================
+
+#include "arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Smallest block added to an arena that runs out (bytes)
+#define ARENA_MIN_GROWTH (64 * 1024)
+
+// Heap allocations counted by the Counted* functions (atomic)
+static long heapAllocations = 0;
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Rounds a size up to the arena alignment.
+*/
+static size_t AlignSize(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/*
+First byte handed out by a block.
+*/
+static inline unsigned char *BlockData(ArenaBlock *block)
+{
+    return (unsigned char *)(block + 1);
+}
+
+/*
+Makes a block with at least size bytes free current, unless another
+thread has moved the arena past full already. Reuses the next block
+of the chain when it is large enough, otherwise puts a new one in
+front of it. Returns false if memory runs out.
+*/
+static bool NextBlock(Arena *arena, ArenaBlock *full, size_t size)
+{
+    bool ok = true;
+
+    pthread_mutex_lock(&arena->growLock);
+
+    if (__atomic_load_n(&arena->current, __ATOMIC_ACQUIRE) == full)
+    {
+        ArenaBlock *next = full->next;
+
+        if (next == NULL || next->capacity < size)
+        {
+            size_t capacity = arena->grownCapacity;
+
+            if (capacity < ARENA_MIN_GROWTH)
+                capacity = ARENA_MIN_GROWTH;
+            if (capacity < size)
+                capacity = size;
+
+            ArenaBlock *grown = CountedMalloc(sizeof(ArenaBlock) + capacity);
+
+            if (grown == NULL)
+                ok = false;
+            else
+            {
+                grown->next = next;
+                grown->capacity = capacity;
+                full->next = grown;
+                next = grown;
+
+                arena->grownCapacity += capacity;
+                arena->blockCount++;
+            }
+        }
+
+        if (ok)
+        {
+            next->used = 0;
+            __atomic_store_n(&arena->current, next, __ATOMIC_RELEASE);
+        }
+    }
+
+    pthread_mutex_unlock(&arena->growLock);
+
+    return ok;
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Makes an arena whose first block, allocated together with it, holds
+capacity bytes. Returns NULL if memory runs out.
+*/
+Arena *CreateArena(size_t capacity)
+{
+    size_t header = AlignSize(sizeof(Arena));
+
+    capacity = AlignSize(capacity);
+
+    Arena *arena = CountedMalloc(header + sizeof(ArenaBlock) + capacity);
+
+    if (arena == NULL)
+        return NULL;
+
+    ArenaBlock *first = (ArenaBlock *)((unsigned char *)arena + header);
+
+    first->next = NULL;
+    first->capacity = capacity;
+    first->used = 0;
+
+    arena->first = first;
+    arena->current = first;
+    arena->grownCapacity = 0;
+    arena->blockCount = 1;
+    pthread_mutex_init(&arena->growLock, NULL);
+
+    return arena;
+}
+
+/*
+Releases an arena and every block of it. NULL is ignored.
+*/
+void DestroyArena(Arena *arena)
+{
+    if (arena == NULL)
+        return;
+
+    ArenaBlock *block = arena->first->next;
+
+    while (block != NULL)
+    {
+        ArenaBlock *next = block->next;
+
+        free(block);
+        block = next;
+    }
+
+    pthread_mutex_destroy(&arena->growLock);
+    free(arena);
+}
+
+// =============================================================
+//                         ALLOCATION
+// =============================================================
+
+/*
+Hands out size bytes, aligned to ARENA_ALIGNMENT. Zero bytes still
+give a distinct pointer. Returns NULL if memory runs out.
+*/
+void *ArenaAlloc(Arena *arena, size_t size)
+{
+    size = (size > 0) ? AlignSize(size) : ARENA_ALIGNMENT;
+
+    for (;;)
+    {
+        ArenaBlock *block = __atomic_load_n(&arena->current, __ATOMIC_ACQUIRE);
+        size_t used = __atomic_fetch_add(&block->used, size, __ATOMIC_RELAXED);
+
+        if (used <= block->capacity && size <= block->capacity - used)
+            return BlockData(block) + used;
+
+        if (!NextBlock(arena, block, size))
+            return NULL;
+    }
+}
+
+/*
+ArenaAlloc() with the bytes cleared.
+*/
+void *ArenaAllocZero(Arena *arena, size_t size)
+{
+    void *memory = ArenaAlloc(arena, size);
+
+    if (memory != NULL)
+        memset(memory, 0, size);
+
+    return memory;
+}
+
+/*
+Makes sure the next size bytes handed out need no heap allocation,
+moving on to a block with room for them if the current one lacks it.
+No other thread may be allocating from the arena meanwhile. Returns
+false if memory runs out.
+*/
+bool ReserveArena(Arena *arena, size_t size)
+{
+    ArenaBlock *block = arena->current;
+
+    size = AlignSize(size);
+
+    if (block->used <= block->capacity && size <= block->capacity - block->used)
+        return true;
+
+    return NextBlock(arena, block, size);
+}
+
+// =============================================================
+//                         REWINDING
+// =============================================================
+
+/*
+Current position, for RewindArena().
+*/
+ArenaMark ArenaPosition(const Arena *arena)
+{
+    ArenaBlock *block = __atomic_load_n(&arena->current, __ATOMIC_ACQUIRE);
+    ArenaMark mark = {block, __atomic_load_n(&block->used, __ATOMIC_RELAXED)};
+
+    return mark;
+}
+
+/*
+Gives back everything handed out since the mark was taken. No other
+thread may be allocating from the arena meanwhile.
+*/
+void RewindArena(Arena *arena, ArenaMark mark)
+{
+    mark.block->used = mark.used;
+    __atomic_store_n(&arena->current, mark.block, __ATOMIC_RELEASE);
+}
+
+/*
+Gives back everything the arena handed out, keeping its blocks.
+*/
+void ResetArena(Arena *arena)
+{
+    ArenaMark start = {arena->first, 0};
+
+    RewindArena(arena, start);
+}
+
+// =============================================================
+//                   COUNTED HEAP ALLOCATIONS
+// =============================================================
+
+/*
+malloc() that adds one to HeapAllocationCount().
+*/
+void *CountedMalloc(size_t size)
+{
+    __atomic_add_fetch(&heapAllocations, 1, __ATOMIC_RELAXED);
+
+    return malloc(size);
+}
+
+/*
+calloc() that adds one to HeapAllocationCount().
+*/
+void *CountedCalloc(size_t count, size_t size)
+{
+    __atomic_add_fetch(&heapAllocations, 1, __ATOMIC_RELAXED);
+
+    return calloc(count, size);
+}
+
+/*
+realloc() that adds one to HeapAllocationCount().
+*/
+void *CountedRealloc(void *memory, size_t size)
+{
+    __atomic_add_fetch(&heapAllocations, 1, __ATOMIC_RELAXED);
+
+    return realloc(memory, size);
+}
+
+/*
+Heap allocations made through the Counted* functions so far, arena
+blocks included. The engine, journal, solvers, recording, saves and
+endless world allocate through them, so a frame of play that leaves the count as it was
+allocated nothing of its own.
+*/
+long HeapAllocationCount(void)
+{
+    return __atomic_load_n(&heapAllocations, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,85 @@
+
+// =============================================================
+// Arena allocator
+// Memory handed out by bumping a position through large blocks
+// and given back all at once by moving the position back, so a
+// game's board, journal and scratch cost one heap allocation
+// between them and a restart frees them in constant time. The
+// heap allocations of the game's own modules are counted, which
+// lets debug builds check that a frame allocates nothing
+// =============================================================
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// -------------------- Constants --------------------
+
+// Alignment of every block handed out, enough for any scalar type
+#define ARENA_ALIGNMENT 16
+
+// -------------------- Data Structures --------------------
+
+typedef struct ArenaBlock ArenaBlock;
+
+/*
+One heap allocation of an arena. Blocks beyond the current one are
+kept after a rewind and reused before any new block is allocated.
+*/
+struct ArenaBlock
+{
+    ArenaBlock *next;
+    size_t capacity;        // Bytes after the header
+    size_t used;            // Bytes handed out (atomic; may run past
+                            // capacity while the block is being left)
+    size_t padding;         // Keeps the data ARENA_ALIGNMENT aligned
+};
+
+/*
+A chain of blocks and the block allocations currently come from.
+Allocating is safe from several threads at once; rewinding is not.
+*/
+typedef struct
+{
+    ArenaBlock *first;      // Allocated together with the arena
+    ArenaBlock *current;    // (atomic)
+    pthread_mutex_t growLock;       // Guards moving to the next block
+    size_t grownCapacity;   // Bytes of the blocks added after the first
+    int blockCount;
+} Arena;
+
+/*
+Position in an arena to rewind to later.
+*/
+typedef struct
+{
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+Arena *CreateArena(size_t capacity);
+void DestroyArena(Arena *arena);
+
+// Allocation
+void *ArenaAlloc(Arena *arena, size_t size);
+void *ArenaAllocZero(Arena *arena, size_t size);
+bool ReserveArena(Arena *arena, size_t size);
+
+// Rewinding
+ArenaMark ArenaPosition(const Arena *arena);
+void RewindArena(Arena *arena, ArenaMark mark);
+void ResetArena(Arena *arena);
+
+// Counted heap allocations
+void *CountedMalloc(size_t size);
+void *CountedCalloc(size_t count, size_t size);
+void *CountedRealloc(void *memory, size_t size);
+long HeapAllocationCount(void);
+
+#endif
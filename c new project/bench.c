@@ -0,0 +1,1723 @@
+
+// =============================================================
+// Benchmarks
+// =============================================================
+
+#include "bench.h"
+#include "chunkstore.h"
+#include "deal.h"
+#include "engine.h"
+#include "env.h"
+#include "generator.h"
+#include "jobs.h"
+#include "metrics.h"
+#include "prefetch.h"
+#include "probability.h"
+#include "solver.h"
+#include "topology.h"
+#include "world.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Byte grid of the layout benchmark: blocks of the tiled layout are
+// GRID_BLOCK_SIZE tiles on a side
+#define GRID_BLOCK_SHIFT 3
+#define GRID_BLOCK_SIZE (1 << GRID_BLOCK_SHIFT)
+#define GRID_BLOCK_MASK (GRID_BLOCK_SIZE - 1)
+
+// Tile byte: neighbour count in the low bits, then flags
+#define GRID_TILE_COUNT 0x0F
+#define GRID_TILE_MINE 0x10
+#define GRID_TILE_REVEALED 0x20
+#define GRID_TILE_FLAGGED 0x40
+
+// -------------------- Data Structures --------------------
+
+/*
+Totals collected while one solver mode plays a series of games.
+*/
+typedef struct
+{
+    int wins;
+    long guesses;
+    long solves;            // Calls that had to find a move
+    double solveSeconds;
+    long linearSolves;      // Calls where the rules were stuck
+    double linearSeconds;
+    long linearFinds;       // Tiles settled only by the linear pass
+    long wrong;             // Deductions contradicted by the board
+} SolverRun;
+
+/*
+Board size and mine count measured by the generator benchmark.
+*/
+typedef struct
+{
+    int rows;
+    int cols;
+    int mines;
+} BoardShape;
+
+/*
+Totals of one self-play worker. Only that worker writes them, so
+no locks or atomics are needed until they are merged at the end.
+*/
+typedef struct
+{
+    long games;
+    long wins;
+    long moves;             // Tiles the bot opened
+    long guesses;           // Of those, tiles not proven safe
+    double decideSeconds;   // Time spent choosing moves
+    char padding[64];       // Keeps other workers' totals off this cache line
+} SimulationCounters;
+
+/*
+Self-play run shared by every worker job.
+*/
+typedef struct
+{
+    BotKind bot;
+    int rows;
+    int cols;
+    int mines;
+    long games;
+    long nextGame;                  // Next game to claim (atomic)
+    SimulationCounters *counters;   // One per worker
+} SimulationJob;
+
+/*
+Order of the tiles in memory.
+*/
+typedef enum
+{
+    GRID_ROW_MAJOR,     // Row after row
+    GRID_TILED          // 8x8 blocks, row after row of blocks; a
+                        // tile and its neighbours lie in at most
+                        // four blocks
+} GridLayout;
+
+/*
+Tile position on the grid.
+*/
+typedef struct
+{
+    int32_t row;
+    int32_t col;
+} GridPoint;
+
+/*
+A board of rows x cols tiles in one of the layouts.
+*/
+typedef struct
+{
+    GridLayout layout;
+    int rows;
+    int cols;
+    int blockCols;          // Blocks per row of blocks (tiled layout)
+    ptrdiff_t steps[8];     // Index offsets of the neighbours of a tile,
+                            // see HasFixedNeighbours()
+
+    uint8_t *tiles;
+    size_t tileCount;       // Including padding of partial blocks
+
+    GridPoint *worklist;    // Scratch stack for flood fill
+    size_t worklistCapacity;
+} BoardGrid;
+
+// Names accepted by ParseBotName(), in BotKind order
+static const char *botNames[] = {"random", "rules", "linear", "probability"};
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Seconds on a monotonic clock.
+*/
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*
+Opens a random empty tile so every game starts with an opening.
+*/
+static void OpenStartingArea(Game *game, uint64_t *rng)
+{
+    int cellCount = game->rows * game->cols;
+
+    for (int attempt = 0; attempt < cellCount; attempt++)
+    {
+        int index = (int)RandomBelow(rng, (uint32_t)cellCount);
+
+        if (!game->cells[index].hasMine && game->cells[index].nearbyMines == 0)
+        {
+            ApplyMove(game, (Move){MOVE_REVEAL, index / game->cols, index % game->cols});
+            return;
+        }
+    }
+}
+
+// =============================================================
+//                           SOLVER
+// =============================================================
+
+/*
+Plays games by opening every proven-safe tile and guessing at random
+when stuck. With linear set, elimination is tried before guessing.
+*/
+static void PlaySolverGames(SolverRun *run, int games, bool linear)
+{
+    Solver solver;
+    InitSolver(&solver);
+
+    for (int g = 0; g < games; g++)
+    {
+        Game game;
+        uint64_t rng = (uint64_t)g * 0x9E3779B97F4A7C15ull + 1;
+
+        if (!InitGame(&game, BENCH_EXPERT_ROWS, BENCH_EXPERT_COLS, BENCH_EXPERT_MINES, (uint64_t)g + 1))
+            break;
+
+        OpenStartingArea(&game, &rng);
+
+        while (game.status == GAME_PLAYING)
+        {
+            double start = Now();
+            SolveBoard(&solver, &game);
+            run->solveSeconds += Now() - start;
+            run->solves++;
+
+            if (linear && solver.safeCount == 0)
+            {
+                int minesBefore = solver.mineCount;
+
+                start = Now();
+                SolveBoardLinear(&solver, &game);
+                run->linearSeconds += Now() - start;
+                run->linearSolves++;
+                run->linearFinds += solver.safeCount + solver.mineCount - minesBefore;
+            }
+
+            for (int i = 0; i < solver.safeCount; i++)
+                run->wrong += game.cells[solver.safe[i]].hasMine;
+
+            for (int i = 0; i < solver.mineCount; i++)
+                run->wrong += !game.cells[solver.mines[i]].hasMine;
+
+            if (solver.safeCount == 0)
+            {
+                int index;
+
+                do
+                    index = (int)RandomBelow(&rng, (uint32_t)(game.rows * game.cols));
+                while (game.cells[index].revealed);
+
+                ApplyMove(&game, (Move){MOVE_REVEAL, index / game.cols, index % game.cols});
+                run->guesses++;
+                continue;
+            }
+
+            for (int i = 0; i < solver.safeCount; i++)
+                ApplyMove(&game, (Move){MOVE_REVEAL, solver.safe[i] / game.cols, solver.safe[i] % game.cols});
+        }
+
+        run->wins += (game.status == GAME_WON);
+        FreeGame(&game);
+    }
+
+    FreeSolver(&solver);
+}
+
+/*
+Compares the rule-based solver with rules plus elimination on the
+same expert boards. Returns the process exit code.
+*/
+int BenchmarkSolvers(int games)
+{
+    SolverRun rules = {0};
+    SolverRun linear = {0};
+
+    PlaySolverGames(&rules, games, false);
+    PlaySolverGames(&linear, games, true);
+
+    printf("Solver benchmark: %d games on %d x %d with %d mines\n",
+           games, BENCH_EXPERT_ROWS, BENCH_EXPERT_COLS, BENCH_EXPERT_MINES);
+    printf("%-8s %8s %10s %12s %14s %12s %6s\n",
+           "mode", "wins", "guesses", "rules ms", "linear ms", "linear finds", "wrong");
+
+    const SolverRun *runs[2] = {&rules, &linear};
+    const char *names[2] = {"rules", "linear"};
+
+    for (int m = 0; m < 2; m++)
+    {
+        const SolverRun *run = runs[m];
+
+        printf("%-8s %7.1f%% %10.2f %12.4f %14.4f %12ld %6ld\n", names[m],
+               100.0 * run->wins / games,
+               (double)run->guesses / games,
+               run->solves ? 1000.0 * run->solveSeconds / run->solves : 0.0,
+               run->linearSolves ? 1000.0 * run->linearSeconds / run->linearSolves : 0.0,
+               run->linearFinds, run->wrong);
+    }
+
+    printf("(ms are per call; guesses are per game)\n");
+
+    return (rules.wrong + linear.wrong == 0) ? 0 : 2;
+}
+
+// =============================================================
+//                         SELF-PLAY
+// =============================================================
+
+/*
+Looks up a bot by the name used on the command line.
+Returns false if the name is unknown.
+*/
+bool ParseBotName(const char *name, BotKind *bot)
+{
+    for (int b = 0; b < (int)(sizeof(botNames) / sizeof(botNames[0])); b++)
+    {
+        if (strcmp(name, botNames[b]) == 0)
+        {
+            *bot = (BotKind)b;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+Picks a hidden tile at random.
+*/
+static Move RandomGuess(const Game *game, uint64_t *rng)
+{
+    int index;
+
+    do
+        index = (int)RandomBelow(rng, (uint32_t)(game->rows * game->cols));
+    while (game->cells[index].revealed);
+
+    return (Move){MOVE_REVEAL, index / game->cols, index % game->cols};
+}
+
+/*
+Plays one dealt game to the end with the given bot.
+*/
+static void PlayBotGame(Game *game, Solver *solver, ProbabilityMap *chances, BotKind bot,
+                        uint64_t *rng, SimulationCounters *counters)
+{
+    OpenStartingArea(game, rng);
+
+    while (game->status == GAME_PLAYING)
+    {
+        double start = Now();
+        Move guess;
+
+        if (bot != BOT_RANDOM)
+        {
+            SolveBoard(solver, game);
+
+            if (bot != BOT_RULES && solver->safeCount == 0)
+                SolveBoardLinear(solver, game);
+        }
+
+        bool proven = (bot != BOT_RANDOM) && solver->safeCount > 0;
+
+        if (!proven && !(bot == BOT_PROBABILITY
+                         && ComputeMineProbabilities(chances, game, BENCH_PROBABILITY_BUDGET, 1)
+                         && FindSafestGuess(chances, game, &guess)))
+            guess = RandomGuess(game, rng);
+
+        counters->decideSeconds += Now() - start;
+
+        if (!proven)
+        {
+            ApplyMove(game, guess);
+            counters->moves++;
+            counters->guesses++;
+            continue;
+        }
+
+        for (int i = 0; i < solver->safeCount; i++)
+            counters->moves += ApplyMove(game, (Move){MOVE_REVEAL, solver->safe[i] / game->cols,
+                                                      solver->safe[i] % game->cols}) == MOVE_OPENED;
+    }
+
+    counters->games++;
+    counters->wins += (game->status == GAME_WON);
+}
+
+/*
+Worker job: claims games in chunks until all are played, adding
+them to the counters of worker first. Each game is dealt and
+guessed from streams derived from its number, so results do not
+depend on which worker played it.
+*/
+static void SimulationWorker(void *argument, int first, int end)
+{
+    SimulationJob *job = argument;
+    SimulationCounters *counters = &job->counters[first];
+
+    (void)end;
+
+    Game game;
+    Solver solver;
+    ProbabilityMap chances;
+    InitSolver(&solver);
+    InitProbabilityMap(&chances);
+
+    if (AllocateGame(&game, job->rows, job->cols, job->mines))
+    {
+        for (;;)
+        {
+            long chunk = __atomic_fetch_add(&job->nextGame, BENCH_SIMULATION_CHUNK, __ATOMIC_RELAXED);
+
+            if (chunk >= job->games)
+                break;
+
+            for (long g = chunk; g < chunk + BENCH_SIMULATION_CHUNK && g < job->games; g++)
+            {
+                uint64_t rng = (uint64_t)g * 0x9E3779B97F4A7C15ull + 1;
+
+                ResetGame(&game, (uint64_t)g + 1);
+                PlayBotGame(&game, &solver, &chances, job->bot, &rng, counters);
+            }
+        }
+    }
+
+    FreeGame(&game);
+    FreeProbabilityMap(&chances);
+    FreeSolver(&solver);
+}
+
+/*
+Plays games with one bot in threadCount worker jobs on the shared
+job system (0, or more than it has threads, uses one per thread)
+and prints win rate, moves, guesses and throughput.
+Returns the process exit code.
+*/
+int SimulateGames(long games, BotKind bot, int rows, int cols, int mines, int threadCount)
+{
+    if (rows <= 0 || cols <= 0 || mines < 0 || mines >= rows * cols)
+    {
+        fprintf(stderr, "Invalid board %d x %d with %d mines\n", rows, cols, mines);
+        return 1;
+    }
+
+    // One job per thread of the pool, the waiting caller included
+    if (threadCount <= 0 || threadCount > CountJobThreads(NULL))
+        threadCount = CountJobThreads(NULL);
+    if (threadCount > BENCH_MAX_THREADS)
+        threadCount = BENCH_MAX_THREADS;
+
+    SimulationCounters *counters = calloc((size_t)threadCount, sizeof(SimulationCounters));
+    SimulationJob job = {bot, rows, cols, mines, games, 0, counters};
+
+    if (counters == NULL)
+        return 1;
+
+    double start = Now();
+    ParallelFor(NULL, SimulationWorker, &job, 0, threadCount, 1);
+    double seconds = Now() - start;
+
+    // Merge the per-thread totals
+    SimulationCounters total = {0};
+
+    for (int t = 0; t < threadCount; t++)
+    {
+        total.games += counters[t].games;
+        total.wins += counters[t].wins;
+        total.moves += counters[t].moves;
+        total.guesses += counters[t].guesses;
+        total.decideSeconds += counters[t].decideSeconds;
+    }
+
+    free(counters);
+
+    double played = total.games ? (double)total.games : 1.0;
+    double winRate = total.wins / played;
+
+    printf("Self-play: %ld games on %d x %d with %d mines, bot %s, %d threads\n",
+           total.games, rows, cols, mines, botNames[bot], threadCount);
+    printf("%-14s %9.2f%% +- %.2f%%\n", "wins", 100.0 * winRate,
+           196.0 * sqrt(winRate * (1.0 - winRate) / played));
+    printf("%-14s %10.2f\n", "moves/game", total.moves / played);
+    printf("%-14s %10.2f\n", "guesses/game", total.guesses / played);
+    printf("%-14s %10.0f\n", "games/s", seconds > 0.0 ? total.games / seconds : 0.0);
+    printf("%-14s %10.2f\n", "us/game", 1e6 * seconds * threadCount / played);
+    printf("%-14s %9.1f%%\n", "deciding",
+           seconds > 0.0 ? 100.0 * total.decideSeconds / (seconds * threadCount) : 0.0);
+    printf("(the first opening is free; us/game counts the wall time of every thread)\n");
+
+    return (total.games == games) ? 0 : 2;
+}
+
+// =============================================================
+//                         GENERATOR
+// =============================================================
+
+/*
+Generates no-guess boards of several sizes and densities, starting
+from the centre tile, and reports how fast candidates are tested
+and boards are found. Returns the process exit code.
+*/
+int BenchmarkGenerator(int boards)
+{
+    static const BoardShape shapes[] = {
+        {9, 9, 10},
+        {16, 16, 40},
+        {16, 30, 99},
+        {30, 30, 135},
+        {30, 30, 180},
+        {50, 50, 375},
+        {100, 100, 1500},
+    };
+
+    printf("Generator benchmark: %d no-guess boards per shape, first click in the centre\n", boards);
+    printf("%-12s %7s %8s %8s %12s %12s %10s %12s\n",
+           "board", "density", "threads", "found", "attempts/s", "accepted", "boards/s", "ms/board");
+
+    int missing = 0;
+
+    for (int s = 0; s < (int)(sizeof(shapes) / sizeof(shapes[0])); s++)
+    {
+        const BoardShape *shape = &shapes[s];
+        long attempts = 0;
+        int found = 0;
+        int threads = 0;
+        double seconds = 0.0;
+
+        for (int b = 0; b < boards; b++)
+        {
+            GeneratorResult result;
+
+            found += GenerateNoGuessSeed(shape->rows, shape->cols, shape->mines,
+                                         shape->rows / 2, shape->cols / 2,
+                                         (uint64_t)b * 0x9E3779B97F4A7C15ull + 1,
+                                         BENCH_GENERATOR_ATTEMPTS, 0, &result);
+
+            attempts += result.attempts;
+            seconds += result.elapsedSeconds;
+            threads = result.threadCount;
+        }
+
+        char size[16];
+        snprintf(size, sizeof(size), "%dx%d", shape->rows, shape->cols);
+
+        printf("%-12s %6.1f%% %8d %4d/%-3d %12.0f %11.3f%% %10.2f %12.2f\n", size,
+               100.0 * shape->mines / (shape->rows * shape->cols), threads, found, boards,
+               seconds > 0.0 ? attempts / seconds : 0.0,
+               attempts ? 100.0 * found / attempts : 0.0,
+               seconds > 0.0 ? found / seconds : 0.0,
+               found ? 1000.0 * seconds / found : 0.0);
+
+        missing += boards - found;
+    }
+
+    printf("(attempts include speculative candidates past the accepted one)\n");
+
+    return (missing == 0) ? 0 : 2;
+}
+
+// =============================================================
+//                          METRICS
+// =============================================================
+
+/*
+Deals boards of several sizes and measures how fast their 3BV,
+openings, islands and ZiNi are computed. Dealing is not timed.
+Returns the process exit code.
+*/
+int BenchmarkMetrics(int boards)
+{
+    static const BoardShape shapes[] = {
+        {9, 9, 10},
+        {16, 16, 40},
+        {16, 30, 99},
+        {100, 100, 2000},
+        {1000, 1000, 200000},
+    };
+
+    BoardMetrics metrics;
+    InitBoardMetrics(&metrics);
+
+    printf("Metrics benchmark: %d boards per shape\n", boards);
+    printf("%-12s %10s %12s %9s %9s %9s %9s\n",
+           "board", "boards/s", "Mtiles/s", "3BV", "openings", "islands", "ZiNi");
+
+    int status = 0;
+
+    for (int s = 0; s < (int)(sizeof(shapes) / sizeof(shapes[0])) && status == 0; s++)
+    {
+        const BoardShape *shape = &shapes[s];
+        double seconds = 0.0;
+        double bbbv = 0.0, openings = 0.0, islands = 0.0, zini = 0.0;
+        Game game;
+
+        if (!AllocateGame(&game, shape->rows, shape->cols, shape->mines))
+        {
+            status = 1;
+            break;
+        }
+
+        for (int b = 0; b < boards; b++)
+        {
+            ResetGame(&game, (uint64_t)b + 1);
+
+            double start = Now();
+
+            if (!ComputeBoardMetrics(&metrics, &game))
+                status = 1;
+
+            seconds += Now() - start;
+
+            bbbv += metrics.bbbv;
+            openings += metrics.openings;
+            islands += metrics.islands;
+            zini += metrics.zini;
+        }
+
+        FreeGame(&game);
+
+        char size[16];
+        snprintf(size, sizeof(size), "%dx%d", shape->rows, shape->cols);
+
+        printf("%-12s %10.0f %12.1f %9.1f %9.1f %9.1f %9.1f\n", size,
+               seconds > 0.0 ? boards / seconds : 0.0,
+               seconds > 0.0 ? 1e-6 * boards * shape->rows * shape->cols / seconds : 0.0,
+               bbbv / boards, openings / boards, islands / boards, zini / boards);
+    }
+
+    printf("(3BV, openings, islands and ZiNi are means per board)\n");
+
+    FreeBoardMetrics(&metrics);
+
+    return status;
+}
+
+// =============================================================
+//                        ENVIRONMENT
+// =============================================================
+
+/*
+Steps a batch of games with a random agent that picks hidden tiles
+and reports environment steps per second for a few board shapes,
+on one thread and on threadCount threads (0 uses every thread of the
+shared job system).
+Only StepBatchEnv() is timed. Returns the process exit code.
+*/
+int BenchmarkEnvironment(int gameCount, int threadCount)
+{
+    static const BoardShape shapes[] = {
+        {9, 9, 10},
+        {16, 16, 40},
+        {16, 30, 99},
+    };
+
+    if (threadCount <= 0 || threadCount > CountJobThreads(NULL))
+        threadCount = CountJobThreads(NULL);
+
+    int counts[2] = {1, threadCount};
+    int status = 0;
+
+    printf("Environment benchmark: %d games stepped %d times per shape, random agent\n",
+           gameCount, BENCH_ENV_STEPS);
+    printf("%-12s %8s %14s %12s %12s %8s\n", "board", "threads", "steps/s", "ns/step", "episodes/s", "wins");
+
+    for (int s = 0; s < (int)(sizeof(shapes) / sizeof(shapes[0])) && status == 0; s++)
+    {
+        const BoardShape *shape = &shapes[s];
+        int cellCount = shape->rows * shape->cols;
+
+        int8_t *observations = malloc((size_t)gameCount * cellCount);
+        int32_t *actions = malloc((size_t)gameCount * sizeof(int32_t));
+        float *rewards = malloc((size_t)gameCount * sizeof(float));
+        uint8_t *dones = malloc((size_t)gameCount);
+
+        for (int c = 0; c < 2 && observations && actions && rewards && dones; c++)
+        {
+            BatchEnv env;
+            uint64_t rng = 1;
+            long episodes = 0;
+            long wins = 0;
+            double seconds = 0.0;
+
+            if (!InitBatchEnv(&env, gameCount, shape->rows, shape->cols, shape->mines, 1,
+                              counts[c], observations))
+            {
+                status = 1;
+                break;
+            }
+
+            for (int step = 0; step < BENCH_ENV_STEPS; step++)
+            {
+                // A few draws usually find a hidden tile
+                for (int g = 0; g < gameCount; g++)
+                {
+                    const int8_t *view = observations + (size_t)g * cellCount;
+                    int action = (int)RandomBelow(&rng, (uint32_t)cellCount);
+
+                    for (int tries = 0; tries < 8 && view[action] != ENV_HIDDEN; tries++)
+                        action = (int)RandomBelow(&rng, (uint32_t)cellCount);
+
+                    actions[g] = action;
+                }
+
+                double start = Now();
+                StepBatchEnv(&env, actions, rewards, dones);
+                seconds += Now() - start;
+
+                for (int g = 0; g < gameCount; g++)
+                {
+                    episodes += (dones[g] != ENV_RUNNING);
+                    wins += (dones[g] == ENV_WON);
+                }
+            }
+
+            char size[16];
+            snprintf(size, sizeof(size), "%dx%d", shape->rows, shape->cols);
+
+            double steps = (double)gameCount * BENCH_ENV_STEPS;
+
+            printf("%-12s %8d %14.0f %12.1f %12.0f %7.2f%%\n", size, env.threadCount,
+                   seconds > 0.0 ? steps / seconds : 0.0, seconds > 0.0 ? 1e9 * seconds / steps : 0.0,
+                   seconds > 0.0 ? episodes / seconds : 0.0, episodes ? 100.0 * wins / episodes : 0.0);
+
+            FreeBatchEnv(&env);
+        }
+
+        if (!observations || !actions || !rewards || !dones)
+            status = 1;
+
+        free(observations);
+        free(actions);
+        free(rewards);
+        free(dones);
+    }
+
+    return status;
+}
+
+// =============================================================
+//                        ENDLESS WORLD
+// =============================================================
+
+/*
+Explores an endless world: an explorer wanders east for half the
+clicks and back west for the rest, within BENCH_WORLD_BAND rows of
+0, opening a safe tile near itself at every click. Mines are
+skipped by asking the hash, so the game never ends. Returns the
+tiles opened and fills the seconds spent.
+*/
+static long ExploreWorld(World *world, long clicks, double *seconds)
+{
+    uint64_t rng = 1;
+    int32_t x = 0;
+    int32_t y = 0;
+    double start = Now();
+
+    for (long i = 0; i < clicks; i++)
+    {
+        int32_t step = (int32_t)RandomBelow(&rng, 8);
+
+        x += (i < clicks / 2) ? step : -step;
+        y += (int32_t)RandomBelow(&rng, 9) - 4;
+
+        if (y > BENCH_WORLD_BAND)
+            y = BENCH_WORLD_BAND;
+        if (y < -BENCH_WORLD_BAND)
+            y = -BENCH_WORLD_BAND;
+
+        int32_t targetX = x + (int32_t)RandomBelow(&rng, 16) - 8;
+        int32_t targetY = y + (int32_t)RandomBelow(&rng, 16) - 8;
+
+        if (!IsWorldMine(world, targetX, targetY))
+            ApplyWorldMove(world, (Move){MOVE_REVEAL, targetY, targetX});
+    }
+
+    *seconds = Now() - start;
+
+    return world->revealedSafe;
+}
+
+/*
+Waits until a point on the monotonic clock.
+*/
+static void SleepUntil(double deadline)
+{
+    double wait = deadline - Now();
+
+    if (wait <= 0.0)
+        return;
+
+#if defined(_WIN32)
+    Sleep((DWORD)(wait * 1000.0));
+#else
+    struct timespec pause = {(time_t)wait, (long)((wait - (time_t)wait) * 1e9)};
+    nanosleep(&pause, NULL);
+#endif
+}
+
+/*
+Pans a view east along the explorer's trail, bringing what it
+shows into memory each frame like the endless view does, with or
+without a prefetcher. Frames are paced so workers get time between
+them; only the owner's work per frame is timed. Prints one line.
+*/
+static void PanWorld(World *world, ChunkPrefetcher *prefetcher)
+{
+    long loadsBefore = world->chunksLoaded;
+    double total = 0.0;
+    double worst = 0.0;
+    double nextFrame = Now();
+
+    for (int frame = 0; frame < BENCH_PAN_FRAMES; frame++)
+    {
+        double left = (double)frame * BENCH_PAN_SPEED;
+        double top = -BENCH_PAN_VIEW / 2.0;
+        double start = Now();
+
+        if (prefetcher != NULL)
+            UpdateChunkPrefetcher(prefetcher, world, left, top, BENCH_PAN_VIEW, BENCH_PAN_VIEW,
+                                  BENCH_PAN_SPEED * BENCH_PAN_FPS, 0.0);
+
+        LoadWorldArea(world, (int32_t)left, (int32_t)top, (int32_t)left + BENCH_PAN_VIEW,
+                      (int32_t)top + BENCH_PAN_VIEW);
+
+        double seconds = Now() - start;
+
+        total += seconds;
+        worst = (seconds > worst) ? seconds : worst;
+
+        nextFrame += 1.0 / BENCH_PAN_FPS;
+        SleepUntil(nextFrame);
+    }
+
+    char label[16] = "no prefetch";
+
+    if (prefetcher != NULL)
+        snprintf(label, sizeof(label), "%d workers", prefetcher->jobs->workerCount);
+
+    printf("%-14s %8d %12ld %12ld %10ld %12.3f %12.3f\n", label, BENCH_PAN_FRAMES,
+           world->chunksLoaded - loadsBefore, prefetcher ? prefetcher->delivered : 0,
+           prefetcher ? prefetcher->discarded : 0, 1000.0 * total / BENCH_PAN_FRAMES, 1000.0 * worst);
+}
+
+/*
+Explores the same world kept fully in memory and with a chunk
+store holding at most BENCH_WORLD_CHUNKS chunks, and compares
+memory, cache hits and disk traffic. Both runs must open the same
+tiles. The stored world is then panned over with and without the
+prefetcher. Returns the process exit code.
+*/
+int BenchmarkWorld(long clicks)
+{
+    long opened[2] = {0, 0};
+    int status = 0;
+
+    printf("Endless world benchmark: %ld clicks out and back, density %.2f\n", clicks, BENCH_WORLD_DENSITY);
+    printf("%-14s %12s %10s %8s %10s %8s %8s %8s %10s %10s %8s\n", "memory", "clicks/s", "opened",
+           "chunks", "KB", "hits", "loads", "evicted", "KB out", "KB in", "I/O ms");
+
+    for (int run = 0; run < 2 && status == 0; run++)
+    {
+        World world;
+        ChunkStore store;
+        double seconds = 0.0;
+        bool stored = (run == 1);
+
+        if (!InitWorld(&world, 1, BENCH_WORLD_DENSITY)
+            || (stored && !OpenChunkStore(&store, BENCH_WORLD_FILE, world.seed)))
+        {
+            fprintf(stderr, "Could not set up the world%s\n", stored ? " or its chunk store" : "");
+            FreeWorld(&world);
+            return 1;
+        }
+
+        if (stored)
+            AttachChunkStore(&world, &store, BENCH_WORLD_CHUNKS);
+
+        opened[run] = ExploreWorld(&world, clicks, &seconds);
+
+        long lookups = world.chunkHits + world.chunkMisses;
+        char label[16] = "unlimited";
+
+        if (stored)
+            snprintf(label, sizeof(label), "%d chunks", BENCH_WORLD_CHUNKS);
+
+        printf("%-14s %12.0f %10ld %8d %10d %7.1f%% %8ld %8ld %10.0f %10.0f %8.1f\n", label,
+               seconds > 0.0 ? clicks / seconds : 0.0, opened[run], world.chunkCount,
+               (int)(WorldMemoryBytes(&world) / 1024), lookups ? 100.0 * world.chunkHits / lookups : 0.0,
+               world.chunksLoaded, world.chunksEvicted,
+               stored ? store.bytesWritten / 1024.0 : 0.0, stored ? store.bytesRead / 1024.0 : 0.0,
+               stored ? 1000.0 * (store.readSeconds + store.writeSeconds) : 0.0);
+
+        if (stored)
+        {
+            printf("%-14s %ld records in the file, %.0f KB stale, %ld compactions, %ld failures\n", "",
+                   (long)store.indexCount, store.staleBytes / 1024.0, store.compactions, store.failures);
+            status = (store.failures > 0) ? 2 : 0;
+
+            printf("\nPanning a %d x %d view at %d tiles/s over the trail\n", BENCH_PAN_VIEW, BENCH_PAN_VIEW,
+                   BENCH_PAN_SPEED * BENCH_PAN_FPS);
+            printf("%-14s %8s %12s %12s %10s %12s %12s\n", "prefetch", "frames", "sync loads",
+                   "prefetched", "discarded", "mean ms", "worst ms");
+
+            ChunkPrefetcher prefetcher;
+            JobSystem pool;
+
+            PanWorld(&world, NULL);
+
+            if (InitJobSystem(&pool, BENCH_PAN_THREADS))
+            {
+                if (StartChunkPrefetcher(&prefetcher, &world, &store, &pool))
+                    PanWorld(&world, &prefetcher);
+
+                StopChunkPrefetcher(&prefetcher);
+                FreeJobSystem(&pool);
+            }
+        }
+
+        FreeWorld(&world);
+
+        if (stored)
+            CloseChunkStore(&store);
+    }
+
+    if (status == 0 && opened[0] != opened[1])
+    {
+        printf("MISMATCH: %ld tiles opened in memory, %ld with the chunk store\n", opened[0], opened[1]);
+        status = 2;
+    }
+
+    return status;
+}
+
+// =============================================================
+//                        BOARD LAYOUT
+// =============================================================
+
+// The byte grid the layouts are measured on: one byte per tile,
+// stored either row by row or in 8x8 blocks that each fill one
+// cache line. Row-major storage puts the rows above and below a
+// tile a whole row apart, so a flood or a neighbour count moving
+// down a wide board touches a new cache line at every step; the
+// tiled layout keeps seven of every eight vertical steps inside a
+// block. Every loop addresses tiles by row and column through
+// GridIndex(), so both layouts give the same results and differ
+// only in speed. Mines are drawn exactly like PlaceMines(), so a
+// grid and a game of the same seed match. The grid lives here,
+// not in the engine: the game keeps its row-major Cell array.
+
+/*
+Position of a tile in grid->tiles.
+*/
+static inline size_t GridIndex(const BoardGrid *grid, int row, int col)
+{
+    if (grid->layout == GRID_ROW_MAJOR)
+        return (size_t)row * grid->cols + col;
+
+    size_t block = (size_t)(row >> GRID_BLOCK_SHIFT) * grid->blockCols + (size_t)(col >> GRID_BLOCK_SHIFT);
+
+    return (block << (2 * GRID_BLOCK_SHIFT)) | (size_t)((row & GRID_BLOCK_MASK) << GRID_BLOCK_SHIFT)
+           | (size_t)(col & GRID_BLOCK_MASK);
+}
+
+/*
+Checks whether a position lies on the grid.
+*/
+static inline bool InsideGrid(const BoardGrid *grid, int row, int col)
+{
+    return (row >= 0 && row < grid->rows) && (col >= 0 && col < grid->cols);
+}
+
+/*
+Checks whether the eight neighbours of a tile are all on the grid
+and at grid->steps from it: away from the edges of the board and,
+when tiled, of the tile's block.
+*/
+static inline bool HasFixedNeighbours(const BoardGrid *grid, int row, int col)
+{
+    bool inner = (unsigned)(row - 1) < (unsigned)(grid->rows - 2) && (unsigned)(col - 1) < (unsigned)(grid->cols - 2);
+
+    if (grid->layout == GRID_ROW_MAJOR)
+        return inner;
+
+    return inner && (unsigned)((row & GRID_BLOCK_MASK) - 1) < GRID_BLOCK_SIZE - 2
+           && (unsigned)((col & GRID_BLOCK_MASK) - 1) < GRID_BLOCK_SIZE - 2;
+}
+
+// Neighbours in the order of BoardGrid.steps
+static const int ROW_STEPS[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+static const int COL_STEPS[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
+/*
+Allocates an empty grid of rows x cols tiles in a layout.
+Returns false if the size is invalid or memory runs out.
+*/
+static bool InitBoardGrid(BoardGrid *grid, int rows, int cols, GridLayout layout)
+{
+    grid->layout = layout;
+    grid->rows = rows;
+    grid->cols = cols;
+    grid->blockCols = (cols + GRID_BLOCK_MASK) >> GRID_BLOCK_SHIFT;
+    grid->tiles = NULL;
+    grid->tileCount = 0;
+    grid->worklist = NULL;
+    grid->worklistCapacity = 0;
+
+    if (rows <= 0 || cols <= 0)
+        return false;
+
+    int blockRows = (rows + GRID_BLOCK_MASK) >> GRID_BLOCK_SHIFT;
+    ptrdiff_t stride = (layout == GRID_ROW_MAJOR) ? cols : GRID_BLOCK_SIZE;
+    int k = 0;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (dr != 0 || dc != 0)
+                grid->steps[k++] = dr * stride + dc;
+        }
+    }
+
+    grid->tileCount = (layout == GRID_ROW_MAJOR)
+                          ? (size_t)rows * cols
+                          : ((size_t)blockRows * grid->blockCols) << (2 * GRID_BLOCK_SHIFT);
+    grid->tiles = calloc(grid->tileCount, 1);
+
+    return grid->tiles != NULL;
+}
+
+/*
+Releases the tiles and the flood fill stack.
+*/
+static void FreeBoardGrid(BoardGrid *grid)
+{
+    free(grid->tiles);
+    free(grid->worklist);
+
+    grid->tiles = NULL;
+    grid->tileCount = 0;
+    grid->worklist = NULL;
+    grid->worklistCapacity = 0;
+}
+
+/*
+Clears the grid and places totalMines mines with the same draws
+as PlaceMines(). totalMines must be below rows * cols.
+*/
+static void PlaceGridMines(BoardGrid *grid, int totalMines, uint64_t seed)
+{
+    uint64_t rng = seed;
+    int placed = 0;
+
+    for (size_t i = 0; i < grid->tileCount; i++)
+        grid->tiles[i] = 0;
+
+    while (placed < totalMines)
+    {
+        int r = (int)RandomBelow(&rng, (uint32_t)grid->rows);
+        int c = (int)RandomBelow(&rng, (uint32_t)grid->cols);
+        uint8_t *tile = &grid->tiles[GridIndex(grid, r, c)];
+
+        if (!(*tile & GRID_TILE_MINE))
+        {
+            *tile |= GRID_TILE_MINE;
+            placed++;
+        }
+    }
+}
+
+/*
+Counts the mines around a tile.
+*/
+static inline int CountAround(const BoardGrid *grid, int row, int col)
+{
+    int count = 0;
+
+    if (HasFixedNeighbours(grid, row, col))
+    {
+        const uint8_t *tile = &grid->tiles[GridIndex(grid, row, col)];
+
+        for (int k = 0; k < 8; k++)
+            count += (tile[grid->steps[k]] & GRID_TILE_MINE) != 0;
+
+        return count;
+    }
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (InsideGrid(grid, row + dr, col + dc))
+                count += (grid->tiles[GridIndex(grid, row + dr, col + dc)] & GRID_TILE_MINE) != 0;
+        }
+    }
+
+    return count;
+}
+
+/*
+Stores the number of neighbouring mines in every safe tile. Tiles
+are visited one 8x8 block at a time, which keeps the three rows
+being read in cache on either layout.
+*/
+static void CountGridMines(BoardGrid *grid)
+{
+    // A copy the tile stores cannot alias, so the layout and size
+    // stay in registers
+    const BoardGrid view = *grid;
+
+    for (int top = 0; top < view.rows; top += GRID_BLOCK_SIZE)
+    {
+        for (int left = 0; left < view.cols; left += GRID_BLOCK_SIZE)
+        {
+            int bottom = (top + GRID_BLOCK_SIZE < view.rows) ? top + GRID_BLOCK_SIZE : view.rows;
+            int right = (left + GRID_BLOCK_SIZE < view.cols) ? left + GRID_BLOCK_SIZE : view.cols;
+
+            for (int r = top; r < bottom; r++)
+            {
+                for (int c = left; c < right; c++)
+                {
+                    uint8_t *tile = &view.tiles[GridIndex(&view, r, c)];
+
+                    if (!(*tile & GRID_TILE_MINE))
+                        *tile = (uint8_t)((*tile & ~GRID_TILE_COUNT) | CountAround(&view, r, c));
+                }
+            }
+        }
+    }
+}
+
+/*
+Makes sure the flood fill stack can hold needed entries.
+*/
+static bool GrowGridWorklist(BoardGrid *grid, size_t needed)
+{
+    if (needed <= grid->worklistCapacity)
+        return true;
+
+    size_t capacity = (grid->worklistCapacity > 0) ? grid->worklistCapacity * 2 : 1024;
+
+    while (capacity < needed)
+        capacity *= 2;
+
+    GridPoint *worklist = realloc(grid->worklist, capacity * sizeof(GridPoint));
+
+    if (worklist == NULL)
+        return false;
+
+    grid->worklist = worklist;
+    grid->worklistCapacity = capacity;
+
+    return true;
+}
+
+/*
+Opens a hidden tile and, from empty tiles, every safe tile around
+them like RevealEmptyCells(). Flags on opened tiles are removed.
+Returns the tiles opened, or -1 if the tile holds a mine (it is
+opened too).
+*/
+static long RevealGridTile(BoardGrid *grid, int row, int col)
+{
+    // A copy the tile stores cannot alias, see CountGridMines()
+    const BoardGrid view = *grid;
+
+    if (!InsideGrid(grid, row, col))
+        return 0;
+
+    uint8_t *tile = &grid->tiles[GridIndex(grid, row, col)];
+
+    if (*tile & (GRID_TILE_REVEALED | GRID_TILE_FLAGGED))
+        return 0;
+
+    *tile |= GRID_TILE_REVEALED;
+
+    if (*tile & GRID_TILE_MINE)
+        return -1;
+
+    if ((*tile & GRID_TILE_COUNT) != 0 || !GrowGridWorklist(grid, 1))
+        return 1;
+
+    long opened = 1;
+    size_t top = 0;
+    GridPoint *worklist = grid->worklist;
+
+    worklist[top++] = (GridPoint){row, col};
+
+    while (top > 0)
+    {
+        GridPoint point = worklist[--top];
+
+        // Make room for every neighbour up front
+        if (top + 8 > grid->worklistCapacity)
+        {
+            if (!GrowGridWorklist(grid, top + 8))
+                return opened;
+
+            worklist = grid->worklist;
+        }
+
+        bool fixed = HasFixedNeighbours(&view, point.row, point.col);
+        uint8_t *center = &view.tiles[GridIndex(&view, point.row, point.col)];
+
+        for (int k = 0; k < 8; k++)
+        {
+            int nr = point.row + ROW_STEPS[k];
+            int nc = point.col + COL_STEPS[k];
+
+            if (!fixed && !InsideGrid(&view, nr, nc))
+                continue;
+
+            uint8_t *next = fixed ? center + view.steps[k] : &view.tiles[GridIndex(&view, nr, nc)];
+
+            if (*next & (GRID_TILE_REVEALED | GRID_TILE_MINE))
+                continue;
+
+            *next = (uint8_t)((*next & ~GRID_TILE_FLAGGED) | GRID_TILE_REVEALED);
+            opened++;
+
+            if ((*next & GRID_TILE_COUNT) == 0)
+                worklist[top++] = (GridPoint){nr, nc};
+        }
+    }
+
+    return opened;
+}
+
+/*
+Checksum of a grid's tiles in row-major order, whatever its layout.
+*/
+static uint64_t HashGrid(const BoardGrid *grid)
+{
+    uint64_t hash = 0;
+
+    for (int r = 0; r < grid->rows; r++)
+    {
+        for (int c = 0; c < grid->cols; c++)
+            hash = (hash ^ grid->tiles[GridIndex(grid, r, c)]) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+/*
+Same checksum for a game, with its tiles encoded like grid tiles.
+*/
+static uint64_t HashGameTiles(const Game *game)
+{
+    uint64_t hash = 0;
+
+    for (int i = 0; i < game->rows * game->cols; i++)
+    {
+        const Cell *cell = &game->cells[i];
+        uint8_t tile = (uint8_t)((cell->hasMine ? GRID_TILE_MINE : cell->nearbyMines)
+                                 | (cell->revealed ? GRID_TILE_REVEALED : 0));
+
+        hash = (hash ^ tile) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+/*
+CountNearbyMines() as it was before the ghost border: every
+neighbour is bounds checked. Kept as the baseline of the benchmark.
+*/
+static void CountNearbyMinesChecked(Game *game)
+{
+    for (int r = 0; r < game->rows; r++)
+    {
+        for (int c = 0; c < game->cols; c++)
+        {
+            if (GameCell(game, r, c)->hasMine)
+                continue;
+
+            int count = 0;
+
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    if (InsideBoard(game, r + dr, c + dc) && GameCell(game, r + dr, c + dc)->hasMine)
+                        count++;
+                }
+            }
+
+            GameCell(game, r, c)->nearbyMines = (unsigned char)count;
+        }
+    }
+}
+
+/*
+Opens an empty tile and floods from it like RevealEmptyCells() did
+before the ghost border, pushing onto a stack with room for every
+tile. Returns the tiles opened.
+*/
+static long RevealCellsChecked(Game *game, int row, int col, int *stack)
+{
+    long opened = 1;
+    int top = 0;
+
+    GameCell(game, row, col)->revealed = true;
+    stack[top++] = row * game->cols + col;
+
+    while (top > 0)
+    {
+        int index = stack[--top];
+        int r = index / game->cols;
+        int c = index % game->cols;
+
+        for (int dr = -1; dr <= 1; dr++)
+        {
+            for (int dc = -1; dc <= 1; dc++)
+            {
+                int nr = r + dr;
+                int nc = c + dc;
+
+                if (!InsideBoard(game, nr, nc))
+                    continue;
+
+                Cell *next = GameCell(game, nr, nc);
+
+                if (!next->revealed && !next->hasMine)
+                {
+                    next->revealed = true;
+                    opened++;
+
+                    if (next->nearbyMines == 0)
+                        stack[top++] = nr * game->cols + nc;
+                }
+            }
+        }
+    }
+
+    return opened;
+}
+
+/*
+Finds the opening with the most empty tiles on a freshly dealt
+board and stores one of its tiles in row and col. The stack needs
+room for every tile. Returns false if memory runs out or the board
+has no empty tile.
+*/
+static bool FindLargestOpening(const Game *game, int *stack, int *row, int *col)
+{
+    int total = game->rows * game->cols;
+    unsigned char *seen = calloc((size_t)total, 1);
+
+    if (seen == NULL)
+        return false;
+
+    long best = 0;
+
+    for (int i = 0; i < total; i++)
+    {
+        if (seen[i] || game->cells[i].hasMine || game->cells[i].nearbyMines != 0)
+            continue;
+
+        long size = 0;
+        int top = 0;
+
+        seen[i] = 1;
+        stack[top++] = i;
+
+        while (top > 0)
+        {
+            int index = stack[--top];
+            int r = index / game->cols;
+            int c = index % game->cols;
+
+            size++;
+
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    int next = (r + dr) * game->cols + (c + dc);
+
+                    if (InsideBoard(game, r + dr, c + dc) && !seen[next] && game->cells[next].nearbyMines == 0
+                        && !game->cells[next].hasMine)
+                    {
+                        seen[next] = 1;
+                        stack[top++] = next;
+                    }
+                }
+            }
+        }
+
+        if (size > best)
+        {
+            best = size;
+            *row = i / game->cols;
+            *col = i % game->cols;
+        }
+    }
+
+    free(seen);
+
+    return best > 0;
+}
+
+/*
+Counts neighbours and floods the largest opening on a size x size
+board stored four ways: the engine's Cell array with bounds checks
+(the old code) and with its ghost border, and the byte grid
+row-major and tiled. All must end in the same state. Returns the
+process exit code.
+*/
+int BenchmarkLayouts(int size)
+{
+    static const char *names[] = {"cells checked", "cells padded", "grid rows", "grid tiled"};
+
+    int mines = (int)((double)size * size * BENCH_LAYOUT_DENSITY);
+    uint64_t seed = 1;
+    uint64_t hashes[4] = {0, 0, 0, 0};
+    long opened[4] = {0, 0, 0, 0};
+    int startRow = -1;
+    int startCol = -1;
+    int status = 0;
+
+    printf("Layout benchmark: %d x %d board, %d mines\n", size, size, mines);
+    printf("%-14s %12s %12s %12s %14s %14s\n", "layout", "count ms", "ns/tile", "flood ms", "opened", "ns/opened");
+
+    // Room for every tile, taken before any timing starts
+    int *stack = malloc((size_t)size * size * sizeof(int));
+
+    if (stack == NULL)
+        return 1;
+
+    for (int run = 0; run < 4 && status == 0; run++)
+    {
+        Game game;
+        BoardGrid grid;
+        double countSeconds;
+        double floodSeconds;
+
+        if (run < 2)
+        {
+            if (!AllocateGame(&game, size, size, mines))
+            {
+                FreeGame(&game);
+                free(stack);
+                return 1;
+            }
+
+            // Dealt like the grid, whatever the size
+            ResetGameWithDeal(&game, seed, DEAL_WHOLE_BOARD);
+
+            // The largest opening starts every flood
+            if (run == 0 && !FindLargestOpening(&game, stack, &startRow, &startCol))
+            {
+                printf("No opening to flood on this board\n");
+                FreeGame(&game);
+                free(stack);
+                return 1;
+            }
+
+            double start = Now();
+
+            if (run == 0)
+                CountNearbyMinesChecked(&game);
+            else
+                CountNearbyMines(&game);
+
+            countSeconds = Now() - start;
+
+            start = Now();
+
+            if (run == 0)
+                opened[run] = RevealCellsChecked(&game, startRow, startCol, stack);
+            else
+            {
+                ApplyMove(&game, (Move){MOVE_REVEAL, startRow, startCol});
+                opened[run] = game.revealedSafe;
+            }
+
+            floodSeconds = Now() - start;
+
+            hashes[run] = HashGameTiles(&game);
+            FreeGame(&game);
+        }
+        else
+        {
+            if (!InitBoardGrid(&grid, size, size, (run == 2) ? GRID_ROW_MAJOR : GRID_TILED))
+            {
+                FreeBoardGrid(&grid);
+                free(stack);
+                return 1;
+            }
+
+            PlaceGridMines(&grid, mines, seed);
+
+            // The flood pushes no more tiles than the first run opened
+            if (!GrowGridWorklist(&grid, (size_t)opened[0] + 8))
+            {
+                FreeBoardGrid(&grid);
+                free(stack);
+                return 1;
+            }
+
+            double start = Now();
+            CountGridMines(&grid);
+            countSeconds = Now() - start;
+
+            start = Now();
+            opened[run] = RevealGridTile(&grid, startRow, startCol);
+            floodSeconds = Now() - start;
+
+            hashes[run] = HashGrid(&grid);
+            FreeBoardGrid(&grid);
+        }
+
+        printf("%-14s %12.2f %12.2f %12.2f %14ld %14.2f\n", names[run], 1000.0 * countSeconds,
+               1e9 * countSeconds / ((double)size * size), 1000.0 * floodSeconds, opened[run],
+               opened[run] > 0 ? 1e9 * floodSeconds / opened[run] : 0.0);
+
+        if (run > 0 && (hashes[run] != hashes[0] || opened[run] != opened[0]))
+        {
+            printf("MISMATCH: %s ends in a different state than %s\n", names[run], names[0]);
+            status = 2;
+        }
+    }
+
+    free(stack);
+
+    return status;
+}
+
+// =============================================================
+//                         TOPOLOGY
+// =============================================================
+
+/*
+Deals a size x size board in each topology, then times counting
+the numbers, flooding the first opening from the centre and one
+solver pass over the opened board. The square board runs twice:
+on the engine's fixed offsets and on an adjacency table, which
+must end in the same state. Returns the process exit code.
+*/
+int BenchmarkTopologies(int size)
+{
+    int layers = BENCH_TOPOLOGY_LAYERS;
+
+    // The 3D board needs whole layers
+    if (size < layers)
+        layers = size;
+
+    size -= size % layers;
+
+    printf("Topology benchmark: %d x %d board, 3D as %d layers\n", size, size, layers);
+    printf("%-16s %10s %10s %10s %12s %12s %12s\n", "topology", "table ms", "count ns", "opened", "flood ns",
+           "solve ms", "safe found");
+
+    uint64_t squareHash = 0;
+    int status = 0;
+
+    for (int run = -1; run < TOPOLOGY_COUNT && status == 0; run++)
+    {
+        TopologyKind kind = (run < 0) ? TOPOLOGY_SQUARE : (TopologyKind)run;
+        double density = (kind == TOPOLOGY_CUBE) ? BENCH_TOPOLOGY_CUBE_DENSITY : BENCH_TOPOLOGY_DENSITY;
+        int mines = (int)((double)size * size * density);
+        BoardAdjacency adjacency = {0};
+        Game game;
+        Solver solver;
+        double tableSeconds = 0.0;
+
+        if (run >= 0)
+        {
+            double start = Now();
+
+            if (!BuildBoardAdjacency(&adjacency, kind, size, size, layers))
+                return 1;
+
+            tableSeconds = Now() - start;
+        }
+
+        if (!AllocateGame(&game, size, size, mines))
+        {
+            FreeGame(&game);
+            FreeBoardAdjacency(&adjacency);
+            return 1;
+        }
+
+        game.adjacency = (run >= 0) ? &adjacency : NULL;
+        ResetGame(&game, 1);
+
+        double start = Now();
+        CountNearbyMines(&game);
+        double countSeconds = Now() - start;
+
+        int first = -1;
+
+        for (int i = (size / 2) * size + size / 2; i < size * size && first < 0; i++)
+        {
+            if (!game.cells[i].hasMine && game.cells[i].nearbyMines == 0)
+                first = i;
+        }
+
+        start = Now();
+
+        if (first >= 0)
+            ApplyMove(&game, (Move){MOVE_REVEAL, first / size, first % size});
+
+        double floodSeconds = Now() - start;
+
+        InitSolver(&solver);
+
+        start = Now();
+        bool solved = SolveBoard(&solver, &game);
+        double solveSeconds = Now() - start;
+
+        char label[32];
+        snprintf(label, sizeof(label), "%s%s", TopologyName(kind), (run < 0) ? " (offsets)" : "");
+
+        printf("%-16s %10.2f %10.2f %10d %12.2f %12.2f %12d\n", label, 1000.0 * tableSeconds,
+               1e9 * countSeconds / ((double)size * size), game.revealedSafe,
+               game.revealedSafe > 0 ? 1e9 * floodSeconds / game.revealedSafe : 0.0, 1000.0 * solveSeconds,
+               solved ? solver.safeCount : -1);
+
+        if (!solved)
+            status = 1;
+
+        if (run < 0)
+            squareHash = HashGameState(&game);
+        else if (kind == TOPOLOGY_SQUARE && HashGameState(&game) != squareHash)
+        {
+            printf("MISMATCH: the square board's adjacency table and offsets disagree\n");
+            status = 2;
+        }
+
+        FreeSolver(&solver);
+        FreeGame(&game);
+        FreeBoardAdjacency(&adjacency);
+    }
+
+    return status;
+}
+
+// =============================================================
+//                       BANDED DEALING
+// =============================================================
+
+/*
+Deals a size x size board with PlaceMines() on one thread, then in
+bands on pools of 1, 2, 4 ... BENCH_DEAL_THREADS threads (the
+waiting caller counts as one). Every banded deal must give the same
+board, hold every mine and carry the numbers a plain
+CountNearbyMines() recount gives. Returns the process exit code.
+*/
+int BenchmarkDealing(int size)
+{
+    int mines = (int)((double)size * size * BENCH_DEAL_DENSITY);
+    Game game;
+
+    if (!AllocateGame(&game, size, size, mines))
+    {
+        FreeGame(&game);
+        return 1;
+    }
+
+    printf("Dealing benchmark: %d x %d board, %d mines, %d processors\n", size, size, mines, CountProcessors());
+    printf("%-16s %8s %12s %10s %10s %8s\n", "deal", "threads", "ms", "ns/tile", "speedup", "steals");
+
+    double start = Now();
+    ResetGameWithDeal(&game, 1, DEAL_WHOLE_BOARD);
+    double plainSeconds = Now() - start;
+    double tiles = (double)size * size;
+
+    printf("%-16s %8d %12.2f %10.2f %10s %8s\n", "whole board", 1, 1000.0 * plainSeconds,
+           1e9 * plainSeconds / tiles, "-", "-");
+
+    uint64_t firstHash = 0;
+    double firstSeconds = 0.0;
+    int status = 0;
+
+    for (int threads = 1; threads <= BENCH_DEAL_THREADS && status == 0; threads *= 2)
+    {
+        JobSystem pool;
+        JobStats stats;
+
+        if (!InitJobSystem(&pool, threads - 1))
+        {
+            status = 1;
+            break;
+        }
+
+        start = Now();
+        bool dealt = DealGameInBands(&game, 1, &pool);
+        double seconds = Now() - start;
+
+        ReadJobStats(&pool, &stats);
+        FreeJobSystem(&pool);
+
+        if (!dealt)
+        {
+            status = 1;
+            break;
+        }
+
+        uint64_t hash = HashGameState(&game);
+
+        if (threads == 1)
+        {
+            firstHash = hash;
+            firstSeconds = seconds;
+        }
+
+        printf("%-16s %8d %12.2f %10.2f %9.2fx %8ld\n", "banded", threads, 1000.0 * seconds,
+               1e9 * seconds / tiles, firstSeconds / seconds, stats.steals);
+
+        if (hash != firstHash)
+        {
+            printf("MISMATCH: %d threads dealt a different board\n", threads);
+            status = 2;
+        }
+    }
+
+    if (status == 0)
+    {
+        int placed = 0;
+
+        for (int i = 0; i < size * size; i++)
+            placed += game.cells[i].hasMine;
+
+        uint64_t hash = HashGameTiles(&game);
+        CountNearbyMines(&game);
+
+        if (placed != mines)
+        {
+            printf("MISMATCH: %d mines placed instead of %d\n", placed, mines);
+            status = 2;
+        }
+        else if (HashGameTiles(&game) != hash)
+        {
+            printf("MISMATCH: band seams counted differently from a full recount\n");
+            status = 2;
+        }
+    }
+
+    FreeGame(&game);
+
+    return status;
+}
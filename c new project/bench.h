@@ -0,0 +1,96 @@
+
+// =============================================================
+// Benchmarks
+// Headless measurements run from the command line, printed as
+// small tables so results can be compared between builds
+// =============================================================
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+
+// -------------------- Constants --------------------
+
+// Expert board used by the solver benchmark
+#define BENCH_EXPERT_ROWS 16
+#define BENCH_EXPERT_COLS 30
+#define BENCH_EXPERT_MINES 99
+
+// Candidates tried per board by the generator benchmark before it
+// counts the board as not found
+#define BENCH_GENERATOR_ATTEMPTS 200000
+
+// Self-play: most worker jobs, and games claimed per visit to the
+// shared game counter
+#define BENCH_MAX_THREADS 64
+#define BENCH_SIMULATION_CHUNK 64
+
+// Time allowed for mine chances per guess of the probability bot (seconds)
+#define BENCH_PROBABILITY_BUDGET 0.05
+
+// Steps timed per board shape by the environment benchmark
+#define BENCH_ENV_STEPS 2000
+
+// Endless world benchmark: mine density, chunks kept in memory
+// with the chunk store, and its spill file
+#define BENCH_WORLD_DENSITY 0.16
+#define BENCH_WORLD_CHUNKS 64
+#define BENCH_WORLD_FILE "bench_world.msc"
+
+// Rows the explorer keeps to (each way from 0), so the panning
+// view can follow its trail
+#define BENCH_WORLD_BAND 192
+
+// Panning over the explored trail: view size in tiles, tiles moved
+// per frame, frame rate, frames, and workers of the prefetch pool
+#define BENCH_PAN_VIEW 128
+#define BENCH_PAN_SPEED 4
+#define BENCH_PAN_FPS 240
+#define BENCH_PAN_FRAMES 1200
+#define BENCH_PAN_THREADS 2
+
+// Layout benchmark: mine density, low enough that one click opens
+// most of the board
+#define BENCH_LAYOUT_DENSITY 0.08
+
+// Topology benchmark: mine density per topology (a 3D tile has
+// more than three times the neighbours) and layers of the 3D board
+#define BENCH_TOPOLOGY_DENSITY 0.08
+#define BENCH_TOPOLOGY_CUBE_DENSITY 0.02
+#define BENCH_TOPOLOGY_LAYERS 16
+
+// Banded dealing benchmark: mine density and the largest pool tried
+// (in threads, the waiting caller included)
+#define BENCH_DEAL_DENSITY 0.16
+#define BENCH_DEAL_THREADS 8
+
+// -------------------- Data Structures --------------------
+
+/*
+Player used by the self-play simulator. Every bot except the random
+one opens proven-safe tiles first; they differ in how hard they
+look for them and in how they guess when none are left.
+*/
+typedef enum
+{
+    BOT_RANDOM,         // Opens random hidden tiles
+    BOT_RULES,          // Solver rules, random guesses
+    BOT_LINEAR,         // Rules plus elimination, random guesses
+    BOT_PROBABILITY     // Rules plus elimination, safest guess
+} BotKind;
+
+// -------------------- Function Prototypes --------------------
+
+int BenchmarkSolvers(int games);
+int BenchmarkGenerator(int boards);
+int BenchmarkMetrics(int boards);
+bool ParseBotName(const char *name, BotKind *bot);
+int SimulateGames(long games, BotKind bot, int rows, int cols, int mines, int threadCount);
+int BenchmarkEnvironment(int gameCount, int threadCount);
+int BenchmarkWorld(long clicks);
+int BenchmarkLayouts(int size);
+int BenchmarkTopologies(int size);
+int BenchmarkDealing(int size);
+
+#endif
@@ -0,0 +1,458 @@
+
+// =============================================================
+// Chunk store
+//
+// File layout (all integers little-endian):
+//   0  u32 magic        4  u16 version      6  u16 header size
+//   8  u64 world seed
+//  then chunk records, each:
+//   0  u32 magic        4  i32 chunk x      8  i32 chunk y
+//  12  u32 checksum    16  revealed plane   16 + 512  flagged plane
+// Mines and numbers are not stored; they follow from the seed.
+//
+// Records are only ever appended. Writing a chunk again leaves
+// its old record behind as stale bytes and points the index at
+// the new one. Once stale bytes outweigh live ones the latest
+// records are copied to a new file that replaces the old one.
+// The file belongs to one session: it is created empty when
+// opened and deleted when closed.
+//
+// Prefetch threads read chunks while the game writes them, so one
+// mutex guards the file and the index. Each chunk's index entry
+// counts the times it was written; a copy read earlier can be
+// told apart from the current one by that version.
+// =============================================================
+
+#include "chunkstore.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// 64-bit file positions
+#if defined(_WIN32)
+    #define SeekFile _fseeki64
+#else
+    #define SeekFile fseeko
+#endif
+
+// Index slots in a new store (a power of two)
+#define INITIAL_INDEX_SLOTS 256
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Seconds on a monotonic clock.
+*/
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+static void PutU32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void PutU64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t GetU32(const uint8_t *in)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)in[i] << (8 * i);
+
+    return value;
+}
+
+/*
+Writes the file header at the start of a new file.
+*/
+static bool WriteStoreHeader(FILE *file, uint64_t seed)
+{
+    uint8_t header[CHUNK_STORE_HEADER_SIZE];
+
+    PutU32(header + 0, CHUNK_STORE_MAGIC);
+    PutU32(header + 4, CHUNK_STORE_VERSION | ((uint32_t)CHUNK_STORE_HEADER_SIZE << 16));
+    PutU64(header + 8, seed);
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+/*
+Mixes the record planes into a 32-bit checksum.
+*/
+static uint32_t ChecksumRecord(const uint8_t *planes)
+{
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < 2 * CHUNK_PLANE_SIZE; i++)
+        hash = (hash ^ planes[i]) * 16777619u;
+
+    return hash;
+}
+
+// =============================================================
+//                           INDEX
+// =============================================================
+
+/*
+Slot holding a chunk position, or the empty slot it would go in.
+*/
+static int FindIndexSlot(const ChunkStore *store, int32_t chunkX, int32_t chunkY)
+{
+    uint64_t key = ((uint64_t)(uint32_t)chunkX << 32) | (uint32_t)chunkY;
+    int mask = store->indexCapacity - 1;
+
+    for (int s = (int)(NextRandom(&key) & (uint64_t)mask);; s = (s + 1) & mask)
+    {
+        const ChunkIndexEntry *entry = &store->index[s];
+
+        if (entry->offset < 0 || (entry->chunkX == chunkX && entry->chunkY == chunkY))
+            return s;
+    }
+}
+
+/*
+Allocates an empty index of the given capacity.
+*/
+static ChunkIndexEntry *AllocateIndex(int capacity)
+{
+    ChunkIndexEntry *index = CountedMalloc((size_t)capacity * sizeof(ChunkIndexEntry));
+
+    for (int s = 0; index != NULL && s < capacity; s++)
+        index[s].offset = -1;
+
+    return index;
+}
+
+/*
+Doubles the index once it is half full.
+*/
+static bool GrowIndex(ChunkStore *store)
+{
+    if (2 * (store->indexCount + 1) <= store->indexCapacity)
+        return true;
+
+    ChunkIndexEntry *old = store->index;
+    int oldCapacity = store->indexCapacity;
+    ChunkIndexEntry *index = AllocateIndex(oldCapacity * 2);
+
+    if (index == NULL)
+        return false;
+
+    store->index = index;
+    store->indexCapacity = oldCapacity * 2;
+
+    for (int s = 0; s < oldCapacity; s++)
+    {
+        if (old[s].offset >= 0)
+            index[FindIndexSlot(store, old[s].chunkX, old[s].chunkY)] = old[s];
+    }
+
+    free(old);
+
+    return true;
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Creates an empty spill file at path for the world of seed.
+Returns false if the file cannot be created or memory runs out.
+*/
+bool OpenChunkStore(ChunkStore *store, const char *path, uint64_t seed)
+{
+    memset(store, 0, sizeof(*store));
+    pthread_mutex_init(&store->lock, NULL);
+
+    store->seed = seed;
+    store->fileSize = CHUNK_STORE_HEADER_SIZE;
+    store->indexCapacity = INITIAL_INDEX_SLOTS;
+    store->index = AllocateIndex(store->indexCapacity);
+    store->path = CountedMalloc(strlen(path) + 1);
+
+    if (store->path != NULL)
+        strcpy(store->path, path);
+
+    if (store->index != NULL && store->path != NULL)
+        store->file = fopen(path, "w+b");
+
+    if (store->file == NULL || !WriteStoreHeader(store->file, seed))
+    {
+        CloseChunkStore(store);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+Closes the spill file and deletes it.
+*/
+void CloseChunkStore(ChunkStore *store)
+{
+    if (store->file != NULL)
+    {
+        fclose(store->file);
+        remove(store->path);
+    }
+
+    free(store->path);
+    free(store->index);
+
+    pthread_mutex_destroy(&store->lock);
+    memset(store, 0, sizeof(*store));
+}
+
+// =============================================================
+//                         COMPACTION
+// =============================================================
+
+/*
+Copies the latest record of every chunk to a new file next to the
+old one, then puts it in the old one's place. The store keeps
+using the old file if anything fails along the way.
+*/
+static void CompactChunkStore(ChunkStore *store)
+{
+    size_t length = strlen(store->path);
+    char *tempPath = CountedMalloc(length + 5);
+    int64_t *offsets = CountedMalloc((size_t)store->indexCapacity * sizeof(int64_t));
+    FILE *file = NULL;
+    int64_t size = CHUNK_STORE_HEADER_SIZE;
+
+    if (tempPath != NULL)
+    {
+        memcpy(tempPath, store->path, length);
+        memcpy(tempPath + length, ".tmp", 5);
+        file = fopen(tempPath, "w+b");
+    }
+
+    bool ok = (offsets != NULL) && (file != NULL) && WriteStoreHeader(file, store->seed);
+
+    // New offsets are kept aside until every record is copied
+    for (int s = 0; s < store->indexCapacity && ok; s++)
+    {
+        uint8_t record[CHUNK_RECORD_SIZE];
+
+        offsets[s] = store->index[s].offset;
+
+        if (offsets[s] < 0)
+            continue;
+
+        ok = SeekFile(store->file, offsets[s], SEEK_SET) == 0
+             && fread(record, 1, sizeof(record), store->file) == sizeof(record)
+             && fwrite(record, 1, sizeof(record), file) == sizeof(record);
+
+        offsets[s] = size;
+        size += CHUNK_RECORD_SIZE;
+    }
+
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+
+    if (!ok)
+    {
+        if (tempPath != NULL)
+            remove(tempPath);
+
+        free(tempPath);
+        free(offsets);
+        return;
+    }
+
+    // Put the new file in place of the old one. Some systems cannot
+    // rename over an existing file; if the old one cannot be
+    // replaced, the new one is used under its own name
+    fclose(store->file);
+
+    if (rename(tempPath, store->path) != 0 && (remove(store->path) != 0 || rename(tempPath, store->path) != 0))
+    {
+        char *swap = store->path;
+        store->path = tempPath;
+        tempPath = swap;
+    }
+
+    // Every later read or write fails if the file cannot be reopened
+    store->file = fopen(store->path, "r+b");
+
+    if (store->file != NULL)
+    {
+        for (int s = 0; s < store->indexCapacity; s++)
+            store->index[s].offset = offsets[s];
+
+        store->bytesRead += size - CHUNK_STORE_HEADER_SIZE;
+        store->bytesWritten += size;
+        store->fileSize = size;
+        store->staleBytes = 0;
+        store->compactions++;
+    }
+
+    free(tempPath);
+    free(offsets);
+}
+
+// =============================================================
+//                          RECORDS
+// =============================================================
+
+/*
+Checks whether a chunk has a record in the file.
+*/
+bool HasStoredChunk(ChunkStore *store, int32_t chunkX, int32_t chunkY)
+{
+    return StoredChunkVersion(store, chunkX, chunkY) > 0;
+}
+
+/*
+Times a chunk has been written, 0 if it never was.
+*/
+uint32_t StoredChunkVersion(ChunkStore *store, int32_t chunkX, int32_t chunkY)
+{
+    pthread_mutex_lock(&store->lock);
+
+    const ChunkIndexEntry *entry = &store->index[FindIndexSlot(store, chunkX, chunkY)];
+    uint32_t version = (entry->offset >= 0) ? entry->version : 0;
+
+    pthread_mutex_unlock(&store->lock);
+
+    return version;
+}
+
+/*
+Appends the revealed and flagged tiles of a chunk to the file and
+points the index at them. Returns false on I/O failure, in which
+case any older record stays the current one.
+*/
+bool WriteStoredChunk(ChunkStore *store, const WorldChunk *chunk)
+{
+    double start = Now();
+    uint8_t record[CHUNK_RECORD_SIZE];
+    uint8_t *revealed = record + 16;
+    uint8_t *flagged = revealed + CHUNK_PLANE_SIZE;
+
+    memset(revealed, 0, 2 * CHUNK_PLANE_SIZE);
+
+    for (int i = 0; i < WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE; i++)
+    {
+        revealed[i >> 3] |= (uint8_t)(((chunk->tiles[i] & WORLD_TILE_REVEALED) != 0) << (i & 7));
+        flagged[i >> 3] |= (uint8_t)(((chunk->tiles[i] & WORLD_TILE_FLAGGED) != 0) << (i & 7));
+    }
+
+    PutU32(record + 0, CHUNK_RECORD_MAGIC);
+    PutU32(record + 4, (uint32_t)chunk->chunkX);
+    PutU32(record + 8, (uint32_t)chunk->chunkY);
+    PutU32(record + 12, ChecksumRecord(revealed));
+
+    pthread_mutex_lock(&store->lock);
+
+    bool ok = store->file != NULL && GrowIndex(store)
+              && SeekFile(store->file, store->fileSize, SEEK_SET) == 0
+              && fwrite(record, 1, sizeof(record), store->file) == sizeof(record);
+
+    if (ok)
+    {
+        ChunkIndexEntry *entry = &store->index[FindIndexSlot(store, chunk->chunkX, chunk->chunkY)];
+
+        uint32_t version = 1;
+
+        if (entry->offset >= 0)
+        {
+            store->staleBytes += CHUNK_RECORD_SIZE;
+            version = entry->version + 1;
+        }
+        else
+            store->indexCount++;
+
+        *entry = (ChunkIndexEntry){chunk->chunkX, chunk->chunkY, store->fileSize, version};
+
+        store->fileSize += CHUNK_RECORD_SIZE;
+        store->bytesWritten += CHUNK_RECORD_SIZE;
+        store->writes++;
+    }
+    else
+        store->failures++;
+
+    int64_t liveBytes = (int64_t)store->indexCount * CHUNK_RECORD_SIZE;
+
+    if (store->staleBytes > CHUNK_STORE_COMPACT_BYTES && store->staleBytes > liveBytes)
+        CompactChunkStore(store);
+
+    store->writeSeconds += Now() - start;
+
+    pthread_mutex_unlock(&store->lock);
+
+    return ok;
+}
+
+/*
+Reads the latest record of a chunk back over its tiles and sets
+the chunk's version. The chunk must already hold its mines and
+numbers; only the revealed and flagged bits are restored.
+Returns false if the chunk has no record or it cannot be read.
+*/
+bool ReadStoredChunk(ChunkStore *store, WorldChunk *chunk)
+{
+    pthread_mutex_lock(&store->lock);
+
+    const ChunkIndexEntry *entry = &store->index[FindIndexSlot(store, chunk->chunkX, chunk->chunkY)];
+
+    if (entry->offset < 0)
+    {
+        pthread_mutex_unlock(&store->lock);
+        return false;
+    }
+
+    double start = Now();
+    uint8_t record[CHUNK_RECORD_SIZE];
+    const uint8_t *revealed = record + 16;
+    const uint8_t *flagged = revealed + CHUNK_PLANE_SIZE;
+
+    bool ok = store->file != NULL
+              && SeekFile(store->file, entry->offset, SEEK_SET) == 0
+              && fread(record, 1, sizeof(record), store->file) == sizeof(record)
+              && GetU32(record + 0) == CHUNK_RECORD_MAGIC
+              && (int32_t)GetU32(record + 4) == chunk->chunkX
+              && (int32_t)GetU32(record + 8) == chunk->chunkY
+              && GetU32(record + 12) == ChecksumRecord(revealed);
+
+    if (ok)
+    {
+        for (int i = 0; i < WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE; i++)
+        {
+            uint8_t tile = chunk->tiles[i] & (WORLD_TILE_COUNT | WORLD_TILE_MINE);
+
+            if ((revealed[i >> 3] >> (i & 7)) & 1)
+                tile |= WORLD_TILE_REVEALED;
+            if ((flagged[i >> 3] >> (i & 7)) & 1)
+                tile |= WORLD_TILE_FLAGGED;
+
+            chunk->tiles[i] = tile;
+        }
+
+        chunk->version = entry->version;
+        store->bytesRead += CHUNK_RECORD_SIZE;
+        store->reads++;
+    }
+    else
+        store->failures++;
+
+    store->readSeconds += Now() - start;
+
+    pthread_mutex_unlock(&store->lock);
+
+    return ok;
+}
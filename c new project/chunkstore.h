@@ -0,0 +1,88 @@
+
+// =============================================================
+// Chunk store
+// Append-only spill file for chunks of an endless world that do
+// not fit in memory, with an in-memory index of where the latest
+// copy of each chunk lives. Stale copies are compacted away.
+// Every function may be called from any thread
+// =============================================================
+
+#ifndef CHUNKSTORE_H
+#define CHUNKSTORE_H
+
+#include "world.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// -------------------- Constants --------------------
+
+// File identification
+#define CHUNK_STORE_MAGIC 0x5343534Du      // "MSCS" read as little-endian
+#define CHUNK_RECORD_MAGIC 0x4B43534Du     // "MSCK"
+#define CHUNK_STORE_VERSION 1
+
+// Sizes of the file header and of one chunk record: a header and
+// two bit planes (revealed, flagged) of one bit per tile
+#define CHUNK_STORE_HEADER_SIZE 16
+#define CHUNK_PLANE_SIZE (WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE / 8)
+#define CHUNK_RECORD_SIZE (16 + 2 * CHUNK_PLANE_SIZE)
+
+// The file is rewritten with only the latest records once stale
+// records take more than this and more than the live ones
+#define CHUNK_STORE_COMPACT_BYTES (16 << 20)
+
+// -------------------- Data Structures --------------------
+
+/*
+Where the latest record of a chunk starts.
+*/
+typedef struct
+{
+    int32_t chunkX;
+    int32_t chunkY;
+    int64_t offset;         // Negative for an empty slot
+    uint32_t version;       // Times the chunk was written, from 1
+} ChunkIndexEntry;
+
+/*
+An open spill file and its index, with I/O counters.
+*/
+struct ChunkStore
+{
+    pthread_mutex_t lock;   // Held by every function below
+    FILE *file;
+    char *path;
+    uint64_t seed;          // World the file belongs to
+    int64_t fileSize;       // Records are appended here
+
+    ChunkIndexEntry *index; // Open-addressing table on the chunk position
+    int indexCapacity;      // Power of two
+    int indexCount;
+
+    // I/O metrics
+    long reads;
+    long writes;
+    long failures;          // Records that could not be written or read back
+    int64_t bytesRead;
+    int64_t bytesWritten;
+    int64_t staleBytes;     // Records replaced by a newer copy
+    long compactions;
+    double readSeconds;
+    double writeSeconds;
+};
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool OpenChunkStore(ChunkStore *store, const char *path, uint64_t seed);
+void CloseChunkStore(ChunkStore *store);
+
+// Records
+bool HasStoredChunk(ChunkStore *store, int32_t chunkX, int32_t chunkY);
+uint32_t StoredChunkVersion(ChunkStore *store, int32_t chunkX, int32_t chunkY);
+bool WriteStoredChunk(ChunkStore *store, const WorldChunk *chunk);
+bool ReadStoredChunk(ChunkStore *store, WorldChunk *chunk);
+
+#endif
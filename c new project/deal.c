@@ -0,0 +1,257 @@
+
+// =============================================================
+// Banded dealing
+//
+// Dealing happens in two passes over bands of DEAL_BAND_ROWS rows.
+// Before them, the calling thread splits the mines between the
+// bands: band by band, the mines a band gets are drawn from the
+// hypergeometric distribution of a uniform deal, so the split is
+// the one PlaceMines() would give on average. The split only needs
+// one draw per band and depends on the seed alone.
+//
+//   1. Each band clears its rows and places its share of mines
+//      with rejection draws from its own random stream.
+//   2. Each band counts the numbers of its rows. Tiles on a seam
+//      read mines of the next band, which is why counting waits
+//      until every band has placed its mines.
+//
+// Both passes are jobs of one band on the job system; the counting
+// jobs wait for the placing ones through a job counter. Which thread
+// runs a band never changes the result. Boards dealt here differ
+// from PlaceMines() boards of the same seed, so ResetGame() deals
+// this way only from DEAL_BANDED_TILES tiles on, and the game,
+// its replay and its saved file record the method used.
+// =============================================================
+
+#include "deal.h"
+#include <math.h>
+
+// -------------------- Data Structures --------------------
+
+/*
+Deal shared by the band jobs.
+*/
+typedef struct
+{
+    Game *game;
+    uint64_t seed;
+    int bandCount;
+    int *bandMines;         // Mines of each band
+} DealJob;
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Uniform random number in (0, 1).
+*/
+static double RandomUnit(uint64_t *rng)
+{
+    return ((double)(NextRandom(rng) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/*
+Mines among the first part tiles when mines mines are spread
+uniformly over tiles tiles (a hypergeometric draw). Small cases
+are drawn exactly, large ones from the normal approximation.
+*/
+static int DrawShare(uint64_t *rng, int tiles, int mines, int part)
+{
+    if (part >= tiles)
+        return mines;
+
+    // Draw whichever of mines and safe tiles is rarer
+    bool flip = mines > tiles - mines;
+    int items = flip ? tiles - mines : mines;
+
+    double share = (double)part / tiles;
+    double mean = items * share;
+    double variance = mean * (1.0 - (double)items / tiles) * (double)(tiles - part) / (tiles - 1);
+    int hits = 0;
+
+    if (variance < 9.0)
+    {
+        // Place the items one by one
+        for (int i = 0; i < items; i++)
+        {
+            if ((int)RandomBelow(rng, (uint32_t)(tiles - i)) < part - hits)
+                hits++;
+        }
+    }
+    else
+    {
+        double u = RandomUnit(rng);
+        double v = RandomUnit(rng);
+        double normal = sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+
+        hits = (int)floor(mean + normal * sqrt(variance) + 0.5);
+
+        int low = items - (tiles - part);
+
+        if (hits < low)
+            hits = low;
+        if (hits < 0)
+            hits = 0;
+        if (hits > items)
+            hits = items;
+        if (hits > part)
+            hits = part;
+    }
+
+    return flip ? part - hits : hits;
+}
+
+/*
+Random stream of a band: the seed and band number are mixed so that
+neighbouring bands do not get overlapping sequences.
+*/
+static uint64_t BandStream(uint64_t seed, int band)
+{
+    uint64_t state = seed ^ ((uint64_t)(band + 1) * 0xD1B54A32D192ED03ull);
+
+    NextRandom(&state);
+
+    return state;
+}
+
+// =============================================================
+//                          PASSES
+// =============================================================
+
+/*
+Pass 1 for one band: clears its rows (with their part of the ghost
+border) and places its mines.
+*/
+static void PlaceBand(Game *game, int band, int mines, uint64_t seed)
+{
+    int cols = game->cols;
+    int stride = cols + 2;
+    int firstRow = band * DEAL_BAND_ROWS;
+    int endRow = (firstRow + DEAL_BAND_ROWS < game->rows) ? firstRow + DEAL_BAND_ROWS : game->rows;
+
+    for (int r = firstRow; r < endRow; r++)
+    {
+        Cell *cells = &game->cells[r * cols];
+        uint8_t *display = &game->display[r * cols];
+        uint8_t *padded = &game->padded[(r + 1) * stride];
+
+        for (int c = 0; c < cols; c++)
+        {
+            cells[c] = (Cell){false, false, false, 0};
+            display[c] = DISPLAY_HIDDEN;
+            padded[c + 1] = 0;
+        }
+
+        padded[0] = PADDED_STOP;
+        padded[cols + 1] = PADDED_STOP;
+    }
+
+    // The first and last bands own the border rows
+    if (firstRow == 0)
+    {
+        for (int c = 0; c < stride; c++)
+            game->padded[c] = PADDED_STOP;
+    }
+
+    if (endRow == game->rows)
+    {
+        for (int c = 0; c < stride; c++)
+            game->padded[(game->rows + 1) * stride + c] = PADDED_STOP;
+    }
+
+    uint64_t rng = BandStream(seed, band);
+    int bandRows = endRow - firstRow;
+    int placed = 0;
+
+    while (placed < mines)
+    {
+        int r = firstRow + (int)RandomBelow(&rng, (uint32_t)bandRows);
+        int c = (int)RandomBelow(&rng, (uint32_t)cols);
+        Cell *cell = &game->cells[r * cols + c];
+
+        if (!cell->hasMine)
+        {
+            cell->hasMine = true;
+            game->padded[PaddedIndex(game, r, c)] |= PADDED_MINE;
+            placed++;
+        }
+    }
+}
+
+/*
+Job of pass 1: clears and fills bands first..end-1.
+*/
+static void PlaceBands(void *argument, int first, int end)
+{
+    DealJob *job = argument;
+
+    for (int band = first; band < end; band++)
+        PlaceBand(job->game, band, job->bandMines[band], job->seed);
+}
+
+/*
+Job of pass 2: counts the numbers of bands first..end-1.
+*/
+static void CountBands(void *argument, int first, int end)
+{
+    DealJob *job = argument;
+    int endRow = (end * DEAL_BAND_ROWS < job->game->rows) ? end * DEAL_BAND_ROWS : job->game->rows;
+
+    CountNearbyMinesInRows(job->game, first * DEAL_BAND_ROWS, endRow);
+}
+
+// =============================================================
+//                          DEALING
+// =============================================================
+
+/*
+Deals a fresh game on an allocated board like ResetGame(), with
+the bands spread over a pool (NULL for the shared one). The board
+depends on the seed only, not on the pool. Returns false if memory
+runs out.
+*/
+bool DealGameInBands(Game *game, uint64_t seed, JobSystem *jobs)
+{
+    int bandCount = (game->rows + DEAL_BAND_ROWS - 1) / DEAL_BAND_ROWS;
+
+    ResetGameArena(game);
+
+    DealJob job = {game, seed, bandCount, ArenaAlloc(game->arena, (size_t)bandCount * sizeof(int))};
+
+    if (job.bandMines == NULL)
+        return false;
+
+    // Split the mines band by band over what is left of the board
+    uint64_t rng = seed;
+    int tilesLeft = game->rows * game->cols;
+    int minesLeft = game->totalMines;
+
+    for (int b = 0; b < bandCount; b++)
+    {
+        int rows = (b + 1 < bandCount) ? DEAL_BAND_ROWS : game->rows - b * DEAL_BAND_ROWS;
+        int tiles = rows * game->cols;
+
+        job.bandMines[b] = DrawShare(&rng, tilesLeft, minesLeft, tiles);
+        tilesLeft -= tiles;
+        minesLeft -= job.bandMines[b];
+    }
+
+    game->seed = seed;
+    game->deal = DEAL_IN_BANDS;
+    game->status = GAME_PLAYING;
+    game->revealedSafe = 0;
+    game->flaggedCount = 0;
+    game->explodedIndex = -1;
+
+    // Counting starts once every band holds its mines
+    JobCounter placed = {0};
+    JobCounter counted = {0};
+
+    SubmitParallelFor(jobs, PlaceBands, &job, 0, bandCount, 1, NULL, &placed);
+    SubmitParallelFor(jobs, CountBands, &job, 0, bandCount, 1, &placed, &counted);
+    WaitForJobs(jobs, &counted);
+    RewindArena(game->arena, game->boardEnd);
+
+    return true;
+}
@@ -0,0 +1,27 @@
+
+// =============================================================
+// Banded dealing
+// Deals very large boards on the job system. The board is cut
+// into bands of rows that get their mines from their own random
+// streams, so a seed gives the same board on any thread count
+// =============================================================
+
+#ifndef DEAL_H
+#define DEAL_H
+
+#include "engine.h"
+#include "jobs.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// Rows per band. Fixed, so the bands (and the board) do not depend
+// on the number of threads
+#define DEAL_BAND_ROWS 64
+
+// -------------------- Function Prototypes --------------------
+
+bool DealGameInBands(Game *game, uint64_t seed, JobSystem *jobs);
+
+#endif
@@ -0,0 +1,633 @@
+
+// =============================================================
+// Minesweeper engine
+// =============================================================
+
+#include "engine.h"
+#include "deal.h"
+#include "history.h"
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Index offsets of the eight neighbours of a tile in an array that
+is stride tiles wide.
+*/
+static inline void NeighbourSteps(int stride, int steps[8])
+{
+    int k = 0;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (dr != 0 || dc != 0)
+                steps[k++] = dr * stride + dc;
+        }
+    }
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Allocates a board of the requested size and deals a new game.
+Returns false if the parameters are invalid or memory runs out.
+*/
+bool InitGame(Game *game, int rows, int cols, int totalMines, uint64_t seed)
+{
+    if (!AllocateGame(game, rows, cols, totalMines))
+        return false;
+
+    ResetGame(game, seed);
+
+    return true;
+}
+
+/*
+Allocates an empty board without dealing it, for callers that
+fill the tiles themselves (loading a saved game). The board and
+everything the game needs later come from one arena.
+*/
+bool AllocateGame(Game *game, int rows, int cols, int totalMines)
+{
+    game->cells = NULL;
+    game->padded = NULL;
+    game->display = NULL;
+    game->worklist = NULL;
+    game->worklistCapacity = 0;
+    game->arena = NULL;
+    game->history = NULL;
+    game->adjacency = NULL;
+
+    if (rows <= 0 || cols <= 0 || totalMines < 0)
+        return false;
+
+    if ((long long)(rows + 2) * (cols + 2) > 0x7fffffff || totalMines >= rows * cols)
+        return false;
+
+    game->rows = rows;
+    game->cols = cols;
+    game->totalMines = totalMines;
+
+    size_t cellCount = (size_t)rows * cols;
+    size_t paddedCount = (size_t)(rows + 2) * (cols + 2);
+
+    game->arena = CreateArena(cellCount * sizeof(Cell) + paddedCount + cellCount
+                              + 3 * ARENA_ALIGNMENT + GAME_ARENA_SLACK);
+
+    if (game->arena == NULL)
+        return false;
+
+    game->cells = ArenaAlloc(game->arena, cellCount * sizeof(Cell));
+    game->padded = ArenaAlloc(game->arena, paddedCount);
+    game->display = ArenaAlloc(game->arena, cellCount);
+    game->boardEnd = ArenaPosition(game->arena);
+
+    game->seed = 0;
+    game->deal = DEAL_WHOLE_BOARD;
+    game->status = GAME_PLAYING;
+    game->revealedSafe = 0;
+    game->flaggedCount = 0;
+    game->explodedIndex = -1;
+
+    return true;
+}
+
+/*
+Deals a fresh game on the existing board, in bands on the job
+system if the board is large enough.
+*/
+void ResetGame(Game *game, uint64_t seed)
+{
+    ResetGameWithDeal(game, seed, ChooseDealMethod(game->rows, game->cols));
+}
+
+/*
+Deals a fresh game on the existing board the given way, as a replay
+or saved game recorded it. A banded deal that runs out of memory
+falls back to the whole board, which game->deal then tells.
+*/
+void ResetGameWithDeal(Game *game, uint64_t seed, DealMethod deal)
+{
+    if (deal == DEAL_IN_BANDS && DealGameInBands(game, seed, NULL))
+        return;
+
+    game->seed = seed;
+    game->deal = DEAL_WHOLE_BOARD;
+    game->status = GAME_PLAYING;
+    game->revealedSafe = 0;
+    game->flaggedCount = 0;
+
+    ResetGameArena(game);
+    InitializeBoard(game);
+    PlaceMines(game);
+    CountNearbyMines(game);
+}
+
+/*
+How ResetGame() deals a board of the given size.
+*/
+DealMethod ChooseDealMethod(int rows, int cols)
+{
+    return ((long long)rows * cols >= DEAL_BANDED_TILES) ? DEAL_IN_BANDS : DEAL_WHOLE_BOARD;
+}
+
+/*
+Gives back everything the game took from its arena after the board,
+in constant time. The undo journal lived there, so it is emptied.
+*/
+void ResetGameArena(Game *game)
+{
+    RewindArena(game->arena, game->boardEnd);
+
+    game->worklist = NULL;
+    game->worklistCapacity = 0;
+
+    if (game->history != NULL)
+        FreeHistory(game->history);
+}
+
+/*
+Releases the memory owned by a game.
+*/
+void FreeGame(Game *game)
+{
+    DestroyArena(game->arena);
+
+    game->cells = NULL;
+    game->padded = NULL;
+    game->display = NULL;
+    game->worklist = NULL;
+    game->worklistCapacity = 0;
+    game->arena = NULL;
+    game->history = NULL;
+}
+
+// =============================================================
+//                    BOARD INITIALIZATION
+// =============================================================
+
+/*
+Resets the entire board for a new game.
+*/
+void InitializeBoard(Game *game)
+{
+    int total = game->rows * game->cols;
+
+    for (int i = 0; i < total; i++)
+    {
+        game->cells[i].revealed = false;
+        game->cells[i].hasMine = false;
+        game->cells[i].flagged = false;
+        game->cells[i].nearbyMines = 0;
+        game->display[i] = DISPLAY_HIDDEN;
+    }
+
+    game->explodedIndex = -1;
+
+    // Ghost border tiles stop every flood, inner tiles start clear
+    int paddedTotal = (game->rows + 2) * (game->cols + 2);
+
+    for (int i = 0; i < paddedTotal; i++)
+        game->padded[i] = PADDED_STOP;
+
+    for (int r = 0; r < game->rows; r++)
+    {
+        for (int c = 0; c < game->cols; c++)
+            game->padded[PaddedIndex(game, r, c)] = 0;
+    }
+}
+
+/*
+Distributes mines across the board from the game seed.
+The same seed always gives the same layout.
+*/
+void PlaceMines(Game *game)
+{
+    uint64_t rng = game->seed;
+    int placed = 0;
+
+    while (placed < game->totalMines)
+    {
+        int r = (int)RandomBelow(&rng, (uint32_t)game->rows);
+        int c = (int)RandomBelow(&rng, (uint32_t)game->cols);
+
+        if (!GameCell(game, r, c)->hasMine)
+        {
+            GameCell(game, r, c)->hasMine = true;
+            game->padded[PaddedIndex(game, r, c)] |= PADDED_MINE;
+            placed++;
+        }
+    }
+}
+
+/*
+Calculates the number displayed on each safe tile for a topology
+other than the square board: inner tiles from fixed offsets, edge
+tiles from their adjacency lists.
+*/
+static void CountAdjacentMines(Game *game, int firstRow, int endRow)
+{
+    const BoardAdjacency *adjacency = game->adjacency;
+
+    for (int r = firstRow; r < endRow; r++)
+    {
+        const int *steps = adjacency->innerSteps[r & 1];
+
+        for (int c = 0; c < game->cols; c++)
+        {
+            int index = r * game->cols + c;
+            int count = 0;
+
+            if (IsInnerTile(adjacency, r, c))
+            {
+                for (int k = 0; k < adjacency->innerDegree; k++)
+                    count += game->cells[index + steps[k]].hasMine;
+            }
+            else
+            {
+                int degree;
+                const int *neighbours = TileNeighbours(adjacency, index, &degree);
+
+                for (int k = 0; k < degree; k++)
+                    count += game->cells[neighbours[k]].hasMine;
+            }
+
+            game->cells[index].nearbyMines = game->cells[index].hasMine ? 0 : (unsigned char)count;
+        }
+    }
+}
+
+/*
+Calculates the number displayed on each safe tile. The ghost
+border holds no mines, so edge tiles need no special case.
+*/
+void CountNearbyMines(Game *game)
+{
+    CountNearbyMinesInRows(game, 0, game->rows);
+}
+
+/*
+CountNearbyMines() for rows firstRow to endRow - 1 only. Mines may
+be read anywhere on the board but only these rows are written, so
+threads can count separate bands of rows at the same time.
+*/
+void CountNearbyMinesInRows(Game *game, int firstRow, int endRow)
+{
+    if (game->adjacency != NULL)
+    {
+        CountAdjacentMines(game, firstRow, endRow);
+        return;
+    }
+
+    int steps[8];
+    NeighbourSteps(game->cols + 2, steps);
+
+    for (int r = firstRow; r < endRow; r++)
+    {
+        Cell *cells = &game->cells[r * game->cols];
+        const uint8_t *padded = &game->padded[PaddedIndex(game, r, 0)];
+
+        for (int c = 0; c < game->cols; c++)
+        {
+            int count = 0;
+
+            for (int k = 0; k < 8; k++)
+                count += padded[c + steps[k]] & PADDED_MINE;
+
+            cells[c].nearbyMines = cells[c].hasMine ? 0 : (unsigned char)count;
+        }
+    }
+}
+
+/*
+Brings the padded bits and the display state of one tile in line
+with its Cell. Code outside the engine that writes a Cell directly
+calls it afterwards.
+*/
+void SyncTile(Game *game, int index)
+{
+    const Cell *cell = &game->cells[index];
+
+    game->padded[PaddedIndex(game, index / game->cols, index % game->cols)] =
+        (uint8_t)((cell->hasMine ? PADDED_MINE : 0) | (cell->revealed ? PADDED_STOP : 0));
+    game->display[index] = TileDisplay(game, index);
+}
+
+// =============================================================
+//                     GAME MECHANICS
+// =============================================================
+
+/*
+Makes room for at least one more flood-fill entry. The stack moves
+to a larger block of the game's arena; a flood pushes each tile at
+most once, so it never needs more than the board.
+*/
+static bool GrowWorklist(Game *game, int needed)
+{
+    if (needed <= game->worklistCapacity)
+        return true;
+
+    int capacity = (game->worklistCapacity > 0) ? game->worklistCapacity : 64;
+    int limit = game->rows * game->cols + 8;
+
+    while (capacity < needed)
+        capacity *= 2;
+
+    if (capacity > limit)
+        capacity = (needed > limit) ? needed : limit;
+
+    int *grown = ArenaAlloc(game->arena, (size_t)capacity * sizeof(int));
+
+    if (grown == NULL)
+        return false;
+
+    if (game->worklistCapacity > 0)
+        memcpy(grown, game->worklist, (size_t)game->worklistCapacity * sizeof(int));
+
+    game->worklist = grown;
+    game->worklistCapacity = capacity;
+
+    return true;
+}
+
+/*
+Saves a tile in the undo journal before it is modified.
+*/
+static inline void NoteChange(Game *game, int index)
+{
+    if (game->history != NULL)
+        RecordCellChange(game->history, index, game->cells[index]);
+}
+
+/*
+Applies one player move and reports what it changed.
+*/
+MoveResult ApplyMove(Game *game, Move move)
+{
+    if (game->status != GAME_PLAYING || !InsideBoard(game, move.row, move.col))
+        return MOVE_IGNORED;
+
+    int index = move.row * game->cols + move.col;
+    Cell *cell = &game->cells[index];
+
+    if (cell->revealed || (move.type == MOVE_REVEAL && cell->flagged))
+        return MOVE_IGNORED;
+
+    if (game->history != NULL)
+        BeginHistoryEntry(game->history, game);
+
+    NoteChange(game, index);
+
+    MoveResult result;
+
+    if (move.type == MOVE_FLAG)
+    {
+        cell->flagged = !cell->flagged;
+        game->flaggedCount += cell->flagged ? 1 : -1;
+        game->display[index] = cell->flagged ? DISPLAY_FLAGGED : DISPLAY_HIDDEN;
+
+        result = cell->flagged ? MOVE_FLAGGED : MOVE_UNFLAGGED;
+    }
+    else if (cell->hasMine)
+    {
+        cell->revealed = true;
+        game->status = GAME_LOST;
+        game->explodedIndex = index;
+        SyncTile(game, index);
+        RevealAllMines(game);
+
+        result = MOVE_EXPLODED;
+    }
+    else
+    {
+        cell->revealed = true;
+        game->padded[PaddedIndex(game, move.row, move.col)] |= PADDED_STOP;
+        game->display[index] = cell->nearbyMines;
+        game->revealedSafe++;
+
+        if (cell->nearbyMines == 0)
+            RevealEmptyCells(game, move.row, move.col);
+
+        if (CheckWin(game))
+            game->status = GAME_WON;
+
+        result = MOVE_OPENED;
+    }
+
+    if (game->history != NULL)
+        CommitHistoryEntry(game->history, game);
+
+    return result;
+}
+
+/*
+Opens a tile reached by the flood fill and reports whether the
+fill continues from it.
+*/
+static inline bool OpenFloodTile(Game *game, int index)
+{
+    Cell *cell = &game->cells[index];
+
+    NoteChange(game, index);
+
+    cell->revealed = true;
+    game->display[index] = cell->nearbyMines;
+    game->revealedSafe++;
+
+    if (cell->flagged)
+    {
+        cell->flagged = false;
+        game->flaggedCount--;
+    }
+
+    return cell->nearbyMines == 0;
+}
+
+/*
+RevealEmptyCells() for a topology other than the square board:
+inner tiles reach their neighbours at fixed offsets, edge tiles
+through their adjacency lists.
+*/
+static void RevealAdjacentCells(Game *game, int row, int col)
+{
+    const BoardAdjacency *adjacency = game->adjacency;
+
+    if (!GrowWorklist(game, 1))
+        return;
+
+    int top = 0;
+    game->worklist[top++] = row * game->cols + col;
+
+    while (top > 0)
+    {
+        if (!GrowWorklist(game, top + adjacency->maxDegree))
+            return;
+
+        int index = game->worklist[--top];
+        int r = index / game->cols;
+        bool inner = IsInnerTile(adjacency, r, index - r * game->cols);
+        const int *steps = adjacency->innerSteps[r & 1];
+        int degree = adjacency->innerDegree;
+        const int *neighbours = NULL;
+
+        if (!inner)
+            neighbours = TileNeighbours(adjacency, index, &degree);
+
+        for (int k = 0; k < degree; k++)
+        {
+            int neighbour = inner ? index + steps[k] : neighbours[k];
+            const Cell *next = &game->cells[neighbour];
+
+            if (next->revealed || next->hasMine)
+                continue;
+
+            game->padded[PaddedIndex(game, neighbour / game->cols, neighbour % game->cols)] |= PADDED_STOP;
+
+            if (OpenFloodTile(game, neighbour))
+                game->worklist[top++] = neighbour;
+        }
+    }
+}
+
+/*
+Reveals connected empty tiles automatically.
+Uses an explicit stack so huge openings cannot overflow the call stack.
+Neighbours are tested in the padded board, where the ghost border
+stops the flood like an opened tile, so no bounds are checked.
+*/
+void RevealEmptyCells(Game *game, int row, int col)
+{
+    if (game->adjacency != NULL)
+    {
+        RevealAdjacentCells(game, row, col);
+        return;
+    }
+
+    if (!GrowWorklist(game, 1))
+        return;
+
+    int paddedSteps[8];
+    int cellSteps[8];
+    NeighbourSteps(game->cols + 2, paddedSteps);
+    NeighbourSteps(game->cols, cellSteps);
+
+    int top = 0;
+    game->worklist[top++] = row * game->cols + col;
+
+    while (top > 0)
+    {
+        // Make room for every neighbour up front
+        if (!GrowWorklist(game, top + 8))
+            return;
+
+        int index = game->worklist[--top];
+        uint8_t *padded = &game->padded[PaddedIndex(game, index / game->cols, index % game->cols)];
+
+        for (int k = 0; k < 8; k++)
+        {
+            if (padded[paddedSteps[k]] & (PADDED_STOP | PADDED_MINE))
+                continue;
+
+            int neighbour = index + cellSteps[k];
+
+            padded[paddedSteps[k]] |= PADDED_STOP;
+
+            if (OpenFloodTile(game, neighbour))
+                game->worklist[top++] = neighbour;
+        }
+    }
+}
+
+/*
+Shows all mines after losing, and marks flags on safe tiles wrong.
+The wrong flags are journaled too, though their Cell does not
+change, so undo and redo bring their display state back in line.
+*/
+void RevealAllMines(Game *game)
+{
+    int total = game->rows * game->cols;
+
+    for (int i = 0; i < total; i++)
+    {
+        Cell *cell = &game->cells[i];
+
+        if (cell->hasMine && !cell->revealed)
+        {
+            NoteChange(game, i);
+            cell->revealed = true;
+            SyncTile(game, i);
+        }
+        else if (cell->flagged && !cell->hasMine && !cell->revealed)
+        {
+            NoteChange(game, i);
+            game->display[i] = TileDisplay(game, i);
+        }
+    }
+}
+
+/*
+Checks whether all safe tiles are revealed.
+*/
+bool CheckWin(const Game *game)
+{
+    return (game->revealedSafe == game->rows * game->cols - game->totalMines);
+}
+
+// =============================================================
+//                     DETERMINISM HELPERS
+// =============================================================
+
+/*
+Returns the next value of a seeded random sequence (SplitMix64).
+Unlike rand(), results are identical on every platform.
+*/
+uint64_t NextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+/*
+Returns a random number in [0, bound).
+*/
+uint32_t RandomBelow(uint64_t *state, uint32_t bound)
+{
+    return (uint32_t)(((NextRandom(state) >> 32) * bound) >> 32);
+}
+
+/*
+Fingerprints the visible and hidden state of the board.
+Two games that went through the same moves hash identically.
+*/
+uint64_t HashGameState(const Game *game)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    int total = game->rows * game->cols;
+
+    hash = (hash ^ (uint64_t)game->rows) * 0x100000001B3ull;
+    hash = (hash ^ (uint64_t)game->cols) * 0x100000001B3ull;
+    hash = (hash ^ (uint64_t)game->status) * 0x100000001B3ull;
+
+    for (int i = 0; i < total; i++)
+    {
+        const Cell *cell = &game->cells[i];
+        uint64_t state = (uint64_t)cell->revealed
+                       | ((uint64_t)cell->hasMine << 1)
+                       | ((uint64_t)cell->flagged << 2);
+
+        hash = (hash ^ state) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
@@ -0,0 +1,222 @@
+
+// =============================================================
+// Minesweeper engine
+// Board state and game rules, independent of window and audio
+// so the same code drives the game, replays and tools
+// =============================================================
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "arena.h"
+#include "topology.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// Tile bits of Game.padded
+#define PADDED_MINE 0x01    // The tile holds a mine
+#define PADDED_STOP 0x02    // Flood fill passes over it: opened, or
+                            // part of the ghost border
+
+// What a player sees of a tile, see Game.display. Opened safe tiles
+// show their number, 0-8, as it is
+#define DISPLAY_HIDDEN 9
+#define DISPLAY_FLAGGED 10
+#define DISPLAY_MINE 11         // Mine shown after the game is lost
+#define DISPLAY_EXPLODED 12     // The mine that lost the game
+#define DISPLAY_WRONG_FLAG 13   // Flag on a safe tile in a lost game
+
+// Room the arena of a game has beyond its board before it grows
+// (bytes), see Game.arena
+#define GAME_ARENA_SLACK (4 * 1024)
+
+// Boards of at least this many tiles are dealt in bands of rows on
+// the job system (see deal.h) by ResetGame()
+#define DEAL_BANDED_TILES (1024 * 1024)
+
+// -------------------- Data Structures --------------------
+
+/*
+Represents a single grid cell of the board.
+Stores game state for each tile.
+*/
+typedef struct
+{
+    bool revealed;               // Whether the tile is opened
+    bool hasMine;                // Whether the tile contains a mine
+    bool flagged;                // Whether the player marked this tile
+    unsigned char nearbyMines;   // Number shown when revealed
+} Cell;
+
+/*
+Overall progress of a game.
+*/
+typedef enum
+{
+    GAME_PLAYING,
+    GAME_LOST,
+    GAME_WON
+} GameStatus;
+
+/*
+How the mines of a game were laid out from its seed. A seed gives a
+different board with each, so replays and saved games store it.
+*/
+typedef enum
+{
+    DEAL_WHOLE_BOARD,   // PlaceMines() over the whole board
+    DEAL_IN_BANDS       // DealGameInBands(), see deal.h
+} DealMethod;
+
+/*
+Kind of player move.
+*/
+typedef enum
+{
+    MOVE_REVEAL,
+    MOVE_FLAG
+} MoveType;
+
+/*
+A player move on a board cell.
+*/
+typedef struct
+{
+    MoveType type;
+    int row;
+    int col;
+} Move;
+
+/*
+What a move did to the board.
+*/
+typedef enum
+{
+    MOVE_IGNORED,    // Nothing changed (outside board, opened, flagged...)
+    MOVE_OPENED,     // A safe tile was opened
+    MOVE_EXPLODED,   // A mine was opened and the game is lost
+    MOVE_FLAGGED,    // A flag was placed
+    MOVE_UNFLAGGED   // A flag was removed
+} MoveResult;
+
+// Optional undo journal, see history.h
+typedef struct History History;
+
+/*
+Complete state of one game.
+*/
+typedef struct
+{
+    int rows;
+    int cols;
+    int totalMines;
+    uint64_t seed;          // Seed the mines were placed from
+    DealMethod deal;        // How they were placed from it
+
+    Cell *cells;            // rows * cols tiles, row-major
+    uint8_t *padded;        // (rows + 2) x (cols + 2) PADDED_* bits: the
+                            // board inside a one-tile ghost border, so
+                            // neighbour loops need no bounds checks
+    uint8_t *display;       // rows * cols DISPLAY_* bytes, rewritten
+                            // whenever a tile or the outcome changes
+
+    GameStatus status;
+    int revealedSafe;       // Safe tiles opened so far
+    int flaggedCount;       // Flags currently on the board
+    int explodedIndex;      // Mine that lost the game, or -1 (also
+                            // when unknown, as after loading)
+
+    int *worklist;          // Scratch stack for flood fill
+    int worklistCapacity;
+
+    Arena *arena;           // Holds the board, then the worklist, the
+                            // undo journal and solver scratch
+    ArenaMark boardEnd;     // Arena position after the board: dealing
+                            // rewinds to it, dropping the rest
+
+    History *history;       // Journal of changed tiles, or NULL
+
+    const BoardAdjacency *adjacency;    // Neighbour lists of the board's
+                                        // topology, or NULL for the square
+                                        // board. Set before dealing
+} Game;
+
+// -------------------- Board Access --------------------
+
+/*
+Returns the tile at the given position.
+*/
+static inline Cell *GameCell(const Game *game, int row, int col)
+{
+    return &game->cells[row * game->cols + col];
+}
+
+/*
+Position of a tile in game->padded.
+*/
+static inline int PaddedIndex(const Game *game, int row, int col)
+{
+    return (row + 1) * (game->cols + 2) + col + 1;
+}
+
+/*
+Works out the display state of a tile from its Cell and the game.
+*/
+static inline uint8_t TileDisplay(const Game *game, int index)
+{
+    const Cell *cell = &game->cells[index];
+
+    if (cell->revealed)
+    {
+        if (!cell->hasMine)
+            return cell->nearbyMines;
+
+        return (index == game->explodedIndex) ? DISPLAY_EXPLODED : DISPLAY_MINE;
+    }
+
+    if (!cell->flagged)
+        return DISPLAY_HIDDEN;
+
+    return (game->status == GAME_LOST && !cell->hasMine) ? DISPLAY_WRONG_FLAG : DISPLAY_FLAGGED;
+}
+
+/*
+Checks whether a position lies on the board.
+*/
+static inline bool InsideBoard(const Game *game, int row, int col)
+{
+    return (row >= 0 && row < game->rows) && (col >= 0 && col < game->cols);
+}
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool InitGame(Game *game, int rows, int cols, int totalMines, uint64_t seed);
+bool AllocateGame(Game *game, int rows, int cols, int totalMines);
+void ResetGame(Game *game, uint64_t seed);
+void ResetGameWithDeal(Game *game, uint64_t seed, DealMethod deal);
+DealMethod ChooseDealMethod(int rows, int cols);
+void ResetGameArena(Game *game);
+void FreeGame(Game *game);
+
+// Board setup
+void InitializeBoard(Game *game);
+void PlaceMines(Game *game);
+void CountNearbyMines(Game *game);
+void CountNearbyMinesInRows(Game *game, int firstRow, int endRow);
+void SyncTile(Game *game, int index);
+
+// Game actions
+MoveResult ApplyMove(Game *game, Move move);
+void RevealEmptyCells(Game *game, int row, int col);
+void RevealAllMines(Game *game);
+bool CheckWin(const Game *game);
+
+// Determinism helpers
+uint64_t NextRandom(uint64_t *state);
+uint32_t RandomBelow(uint64_t *state, uint32_t bound);
+uint64_t HashGameState(const Game *game);
+
+#endif
@@ -0,0 +1,324 @@
+
+// =============================================================
+// Batch environment
+//
+// The hidden boards hold one byte per tile, 1 for a mine. Numbers
+// are counted only for tiles being opened: most episodes of an
+// untrained agent end after a few clicks, so counting the whole
+// board at every deal would cost more than it saves. The
+// observation buffer is the only visible state, so a step changes
+// just the tiles it opens and nothing is copied out afterwards.
+//
+// Games are split into fixed slices, each stepped as one job on
+// the shared job system; the calling thread steps slices too
+// while it waits. Games never share tiles, so slices need no
+// locking while they run.
+//
+// Boards are dealt exactly like PlaceMines(), so the seed of any
+// episode reproduces its board in the game (with DEAL_WHOLE_BOARD,
+// which ResetGame() picks below DEAL_BANDED_TILES tiles).
+// =============================================================
+
+#include "env.h"
+#include "engine.h"
+#include "jobs.h"
+#include <stdlib.h>
+#include <string.h>
+
+// =============================================================
+//                          DEALING
+// =============================================================
+
+/*
+Deals a new board for game g from its stream and hides every tile.
+*/
+static void DealGame(BatchEnv *env, int g)
+{
+    int rows = env->rows;
+    int cols = env->cols;
+    uint8_t *board = env->boards + (size_t)g * env->cellCount;
+    uint64_t seed = NextRandom(&env->random[g]);
+    uint64_t rng = seed;
+    int placed = 0;
+
+    memset(board, 0, (size_t)env->cellCount);
+    memset(env->observations + (size_t)g * env->cellCount, (unsigned char)ENV_HIDDEN, (size_t)env->cellCount);
+
+    // Same draws as PlaceMines()
+    while (placed < env->totalMines)
+    {
+        int r = (int)RandomBelow(&rng, (uint32_t)rows);
+        int c = (int)RandomBelow(&rng, (uint32_t)cols);
+
+        if (!board[r * cols + c])
+        {
+            board[r * cols + c] = 1;
+            placed++;
+        }
+    }
+
+    env->seeds[g] = seed;
+    env->openedSafe[g] = 0;
+    env->episodeSteps[g] = 0;
+}
+
+// =============================================================
+//                          STEPPING
+// =============================================================
+
+/*
+Counts the mines around a tile.
+*/
+static int8_t CountMines(const BatchEnv *env, const uint8_t *board, int index)
+{
+    int rows = env->rows;
+    int cols = env->cols;
+    int r = index / cols;
+    int c = index % cols;
+    int count = 0;
+
+    for (int nr = (r > 0 ? r - 1 : 0); nr <= (r < rows - 1 ? r + 1 : r); nr++)
+    {
+        for (int nc = (c > 0 ? c - 1 : 0); nc <= (c < cols - 1 ? c + 1 : c); nc++)
+            count += board[nr * cols + nc];
+    }
+
+    return (int8_t)count;
+}
+
+/*
+Opens a safe tile for game g, flooding out from empty tiles.
+Returns the number of tiles opened.
+*/
+static int OpenTiles(BatchEnv *env, int g, int start, int *stack)
+{
+    int rows = env->rows;
+    int cols = env->cols;
+    const uint8_t *board = env->boards + (size_t)g * env->cellCount;
+    int8_t *view = env->observations + (size_t)g * env->cellCount;
+    int opened = 1;
+    int top = 0;
+
+    view[start] = CountMines(env, board, start);
+
+    if (view[start] == 0)
+        stack[top++] = start;
+
+    // Tiles are shown when pushed, so each is pushed at most once
+    while (top > 0)
+    {
+        int index = stack[--top];
+        int r = index / cols;
+        int c = index % cols;
+
+        for (int nr = (r > 0 ? r - 1 : 0); nr <= (r < rows - 1 ? r + 1 : r); nr++)
+        {
+            for (int nc = (c > 0 ? c - 1 : 0); nc <= (c < cols - 1 ? c + 1 : c); nc++)
+            {
+                int next = nr * cols + nc;
+
+                if (view[next] != ENV_HIDDEN)
+                    continue;
+
+                view[next] = CountMines(env, board, next);
+                opened++;
+
+                if (view[next] == 0)
+                    stack[top++] = next;
+            }
+        }
+    }
+
+    return opened;
+}
+
+/*
+Applies one action to game g and deals a new board if it ended.
+*/
+static void StepGame(BatchEnv *env, int g, int32_t action, int *stack)
+{
+    const uint8_t *board = env->boards + (size_t)g * env->cellCount;
+    const int8_t *view = env->observations + (size_t)g * env->cellCount;
+
+    env->episodeSteps[g]++;
+    env->dones[g] = ENV_RUNNING;
+
+    if (action < 0 || action >= env->cellCount || view[action] != ENV_HIDDEN)
+    {
+        env->rewards[g] = ENV_REWARD_WASTED;
+        return;
+    }
+
+    if (board[action])
+    {
+        env->rewards[g] = ENV_REWARD_LOSS;
+        env->dones[g] = ENV_LOST;
+        DealGame(env, g);
+        return;
+    }
+
+    env->openedSafe[g] += OpenTiles(env, g, action, stack);
+
+    if (env->openedSafe[g] == env->cellCount - env->totalMines)
+    {
+        env->rewards[g] = ENV_REWARD_WIN;
+        env->dones[g] = ENV_WON;
+        DealGame(env, g);
+        return;
+    }
+
+    env->rewards[g] = ENV_REWARD_PROGRESS;
+}
+
+/*
+Steps every game of a slice with the actions of the current step.
+*/
+static void StepSlice(BatchEnvSlice *slice)
+{
+    BatchEnv *env = slice->env;
+
+    for (int g = slice->first; g < slice->last; g++)
+        StepGame(env, g, env->actions[g], slice->stack);
+}
+
+/*
+Job: steps slices first..end-1.
+*/
+static void StepSlices(void *argument, int first, int end)
+{
+    BatchEnv *env = argument;
+
+    for (int t = first; t < end; t++)
+        StepSlice(&env->slices[t]);
+}
+
+/*
+Applies actions[g] (a tile index to open) to every game g. Writes
+the reward of each game to rewards and ENV_RUNNING, ENV_WON or
+ENV_LOST to dones. Games that end are dealt again at once, so
+their observations already show the new board.
+*/
+void StepBatchEnv(BatchEnv *env, const int32_t *actions, float *rewards, uint8_t *dones)
+{
+    env->actions = actions;
+    env->rewards = rewards;
+    env->dones = dones;
+
+    if (env->threadCount > 1)
+        ParallelFor(NULL, StepSlices, env, 0, env->threadCount, 1);
+    else
+        StepSlice(&env->slices[0]);
+}
+
+/*
+Deals a new board for every game.
+*/
+void ResetBatchEnv(BatchEnv *env)
+{
+    for (int t = 0; t < env->threadCount; t++)
+    {
+        for (int g = env->slices[t].first; g < env->slices[t].last; g++)
+            DealGame(env, g);
+    }
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Sets up gameCount games of one shape, dealt from seed, stepped in
+threadCount slices on the shared job system (0 or 1 steps on the
+calling thread only; no more slices than the system has threads).
+observations must hold gameCount * rows * cols bytes and stays
+owned by the caller; it always shows the current boards.
+Returns false if the parameters are invalid or memory runs out.
+*/
+bool InitBatchEnv(BatchEnv *env, int gameCount, int rows, int cols, int totalMines,
+                  uint64_t seed, int threadCount, int8_t *observations)
+{
+    memset(env, 0, sizeof(*env));
+
+    bool valid = gameCount > 0 && rows > 0 && cols > 0 && totalMines >= 0 && observations != NULL
+                 && (long long)rows * cols <= 0x7fffffff && totalMines < rows * cols;
+
+    if (!valid)
+    {
+        FreeBatchEnv(env);
+        return false;
+    }
+
+    if (threadCount < 1)
+        threadCount = 1;
+    if (threadCount > 1 && threadCount > CountJobThreads(NULL))
+        threadCount = CountJobThreads(NULL);
+    if (threadCount > ENV_MAX_THREADS)
+        threadCount = ENV_MAX_THREADS;
+    if (threadCount > gameCount)
+        threadCount = gameCount;
+
+    env->gameCount = gameCount;
+    env->rows = rows;
+    env->cols = cols;
+    env->cellCount = rows * cols;
+    env->totalMines = totalMines;
+    env->observations = observations;
+
+    size_t tiles = (size_t)gameCount * env->cellCount;
+
+    env->boards = malloc(tiles);
+    env->random = malloc((size_t)gameCount * sizeof(uint64_t));
+    env->seeds = malloc((size_t)gameCount * sizeof(uint64_t));
+    env->openedSafe = malloc((size_t)gameCount * sizeof(int32_t));
+    env->episodeSteps = malloc((size_t)gameCount * sizeof(int32_t));
+
+    bool ok = env->boards && env->random && env->seeds && env->openedSafe && env->episodeSteps;
+
+    for (int t = 0; t < threadCount && ok; t++)
+    {
+        BatchEnvSlice *slice = &env->slices[t];
+
+        slice->env = env;
+        slice->first = (int)((long long)gameCount * t / threadCount);
+        slice->last = (int)((long long)gameCount * (t + 1) / threadCount);
+        slice->stack = malloc((size_t)env->cellCount * sizeof(int));
+        ok = (slice->stack != NULL);
+    }
+
+    env->threadCount = threadCount;
+
+    if (!ok)
+    {
+        FreeBatchEnv(env);
+        return false;
+    }
+
+    // Every game gets its own stream of boards
+    for (int g = 0; g < gameCount; g++)
+    {
+        uint64_t state = seed + (uint64_t)g;
+        env->random[g] = NextRandom(&state);
+    }
+
+    ResetBatchEnv(env);
+
+    return true;
+}
+
+/*
+Releases everything but the observation buffer. Also undoes a
+failed InitBatchEnv().
+*/
+void FreeBatchEnv(BatchEnv *env)
+{
+    for (int t = 0; t < env->threadCount; t++)
+        free(env->slices[t].stack);
+
+    free(env->boards);
+    free(env->random);
+    free(env->seeds);
+    free(env->openedSafe);
+    free(env->episodeSteps);
+
+    memset(env, 0, sizeof(*env));
+}
@@ -0,0 +1,92 @@
+
+// =============================================================
+// Batch environment
+// Many games of one board shape stepped together, for training
+// agents without a window. Games are stored as arrays across
+// games, and what the agent sees is written straight into a
+// buffer the caller owns
+// =============================================================
+
+#ifndef ENV_H
+#define ENV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// Observation of a tile that is still hidden (open tiles show 0-8)
+#define ENV_HIDDEN -1
+
+// Outcome written to dones for every game after a step
+#define ENV_RUNNING 0
+#define ENV_WON 1           // Won by this step; a new game was dealt
+#define ENV_LOST 2          // Lost by this step; a new game was dealt
+
+// Rewards per step
+#define ENV_REWARD_WIN 1.0f
+#define ENV_REWARD_LOSS -1.0f
+#define ENV_REWARD_PROGRESS 0.1f    // Safe tiles opened, game goes on
+#define ENV_REWARD_WASTED -0.1f     // Tile already open or off the board
+
+// Upper limit for the slices of one environment
+#define ENV_MAX_THREADS 64
+
+// -------------------- Data Structures --------------------
+
+// Defined below; slices point back at their environment
+typedef struct BatchEnv BatchEnv;
+
+/*
+One slice of the games, stepped as one job, with the flood fill
+stack it owns.
+*/
+typedef struct
+{
+    BatchEnv *env;
+    int first;              // Games first..last-1
+    int last;
+    int *stack;             // Flood fill scratch
+} BatchEnvSlice;
+
+/*
+N games of the same shape. Per-game values are arrays indexed by
+game; tiles of game g start at g * cellCount in every tile array.
+*/
+struct BatchEnv
+{
+    int gameCount;
+    int rows;
+    int cols;
+    int cellCount;
+    int totalMines;
+
+    uint8_t *boards;        // Per tile: 1 for a mine
+    int8_t *observations;   // Caller's buffer, gameCount * cellCount
+    uint64_t *random;       // Per game: stream the next boards are dealt from
+    uint64_t *seeds;        // Per game: seed of the current board
+    int32_t *openedSafe;    // Per game: safe tiles opened so far
+    int32_t *episodeSteps;  // Per game: steps since the board was dealt
+
+    // Step being worked on
+    const int32_t *actions;
+    float *rewards;
+    uint8_t *dones;
+
+    // Slices stepped in parallel on the shared job system
+    int threadCount;
+    BatchEnvSlice slices[ENV_MAX_THREADS];
+};
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool InitBatchEnv(BatchEnv *env, int gameCount, int rows, int cols, int totalMines,
+                  uint64_t seed, int threadCount, int8_t *observations);
+void FreeBatchEnv(BatchEnv *env);
+
+// Stepping
+void ResetBatchEnv(BatchEnv *env);
+void StepBatchEnv(BatchEnv *env, const int32_t *actions, float *rewards, uint8_t *dones);
+
+#endif
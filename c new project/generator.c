@@ -0,0 +1,312 @@
+
+// =============================================================
+// Board generator
+//
+// Candidate boards are dealt from a fixed sequence of seeds
+// derived from a base seed. A candidate is kept if its 3BV lies
+// in the requested band (checked first, with early rejection in
+// the metrics pass) and, for no-guess boards, if its first click
+// opens an empty area and the solver (rules, then elimination)
+// can open every other safe tile from there.
+// Most candidates fail, so worker jobs on the job system test
+// candidates speculatively: each takes the next unclaimed one and the
+// lowest accepted position wins. Candidates below the winner
+// are always finished, so the result does not depend on the
+// number of workers or on their timing.
+// =============================================================
+
+#include "generator.h"
+#include "deal.h"
+#include "jobs.h"
+#include "metrics.h"
+#include <limits.h>
+#include <time.h>
+
+// -------------------- Data Structures --------------------
+
+/*
+Search shared by every worker thread.
+*/
+typedef struct
+{
+    const GeneratorRequest *request;
+    long lastCandidate;     // One past the last position to try
+
+    long nextCandidate;     // Next position to claim (atomic)
+    long found;             // Lowest accepted position so far (atomic)
+    long attempts;          // Totals merged by the workers (atomic)
+    long rejectedEarly;
+    long solverRuns;
+    int failed;             // A worker ran out of memory (atomic)
+} GeneratorJob;
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Seconds on a monotonic clock.
+*/
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*
+Seed of the candidate at a position of the sequence.
+*/
+static uint64_t CandidateSeed(uint64_t baseSeed, long candidate)
+{
+    uint64_t state = baseSeed + (uint64_t)candidate;
+    return NextRandom(&state);
+}
+
+/*
+Deals a candidate like ResetGame(). For no-guess boards it stops
+before counting numbers if a mine touches the first click (boards
+dealt in bands are counted with their mines). Returns false for
+such a rejected deal.
+*/
+static bool DealCandidate(Game *game, uint64_t seed, const GeneratorRequest *request)
+{
+    bool banded = (ChooseDealMethod(game->rows, game->cols) == DEAL_IN_BANDS);
+
+    if (!banded || !DealGameInBands(game, seed, NULL))
+    {
+        banded = false;
+        game->seed = seed;
+        game->deal = DEAL_WHOLE_BOARD;
+        game->status = GAME_PLAYING;
+        game->revealedSafe = 0;
+        game->flaggedCount = 0;
+
+        InitializeBoard(game);
+        PlaceMines(game);
+    }
+
+    for (int dr = -1; dr <= 1 && request->noGuess; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            int r = request->startRow + dr;
+            int c = request->startCol + dc;
+
+            if (InsideBoard(game, r, c) && GameCell(game, r, c)->hasMine)
+                return false;
+        }
+    }
+
+    if (!banded)
+        CountNearbyMines(game);
+
+    return true;
+}
+
+// =============================================================
+//                        VERIFICATION
+// =============================================================
+
+/*
+Plays a freshly dealt game from the first click, opening only
+tiles the solver proves safe. Elimination is run only when the
+rules alone are stuck. The game is left where the solver stopped.
+Returns true if the game was won without a guess.
+*/
+bool IsSolvableWithoutGuessing(Game *game, Solver *solver, int startRow, int startCol)
+{
+    if (ApplyMove(game, (Move){MOVE_REVEAL, startRow, startCol}) != MOVE_OPENED)
+        return false;
+
+    while (game->status == GAME_PLAYING)
+    {
+        if (!SolveBoard(solver, game))
+            return false;
+
+        if (solver->safeCount == 0 && !SolveBoardLinear(solver, game))
+            return false;
+
+        if (solver->safeCount == 0)
+            return false;
+
+        for (int i = 0; i < solver->safeCount; i++)
+        {
+            int index = solver->safe[i];
+            ApplyMove(game, (Move){MOVE_REVEAL, index / game->cols, index % game->cols});
+        }
+    }
+
+    return game->status == GAME_WON;
+}
+
+// =============================================================
+//                         SEARCH
+// =============================================================
+
+/*
+Lowers the shared best position to candidate unless a lower one
+was already accepted.
+*/
+static void AcceptCandidate(GeneratorJob *job, long candidate)
+{
+    long best = __atomic_load_n(&job->found, __ATOMIC_RELAXED);
+
+    while (candidate < best
+           && !__atomic_compare_exchange_n(&job->found, &best, candidate, false,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/*
+Worker job: claims candidates until one below its claim has been
+accepted or the attempts run out.
+*/
+static void GeneratorWorker(void *argument, int first, int end)
+{
+    (void)first;
+    (void)end;
+
+    GeneratorJob *job = argument;
+    const GeneratorRequest *request = job->request;
+    bool banded = (request->minBbbv > 0 || request->maxBbbv < INT_MAX);
+    long attempts = 0;
+    long rejectedEarly = 0;
+    long solverRuns = 0;
+
+    Game game;
+    Solver solver;
+    BoardMetrics metrics;
+    InitSolver(&solver);
+    InitBoardMetrics(&metrics);
+
+    bool ready = AllocateGame(&game, request->rows, request->cols, request->totalMines)
+                 && ReserveBoardMetrics(&metrics, request->rows * request->cols);
+
+    if (!ready)
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+
+    while (ready)
+    {
+        long candidate = __atomic_fetch_add(&job->nextCandidate, 1, __ATOMIC_RELAXED);
+
+        if (candidate >= job->lastCandidate || candidate >= __atomic_load_n(&job->found, __ATOMIC_RELAXED))
+            break;
+
+        attempts++;
+
+        if (!DealCandidate(&game, CandidateSeed(request->baseSeed, candidate), request))
+            continue;
+
+        // Cheap band check before the expensive solver
+        if (banded && !ScoreBoardInBand(&metrics, &game, request->minBbbv, request->maxBbbv))
+        {
+            rejectedEarly += (metrics.bbbv < 0);
+            continue;
+        }
+
+        if (request->noGuess)
+        {
+            solverRuns++;
+
+            if (!IsSolvableWithoutGuessing(&game, &solver, request->startRow, request->startCol))
+                continue;
+        }
+
+        AcceptCandidate(job, candidate);
+    }
+
+    __atomic_fetch_add(&job->attempts, attempts, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&job->rejectedEarly, rejectedEarly, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&job->solverRuns, solverRuns, __ATOMIC_RELAXED);
+
+    FreeGame(&game);
+    FreeBoardMetrics(&metrics);
+    FreeSolver(&solver);
+}
+
+/*
+Searches the candidate sequence of a request for the first board
+that satisfies it, with threadCount worker jobs on the shared job
+system (0, or more than it has threads, uses one per thread).
+The same request always gives the same seed, whatever the thread
+count.
+Returns false if no candidate passed or memory ran out; the
+counters in result are filled either way.
+*/
+bool GenerateSeed(const GeneratorRequest *request, int threadCount, GeneratorResult *result)
+{
+    double start = Now();
+
+    if (threadCount <= 0 || threadCount > CountJobThreads(NULL))
+        threadCount = CountJobThreads(NULL);
+    if (threadCount > GENERATOR_MAX_THREADS)
+        threadCount = GENERATOR_MAX_THREADS;
+
+    long lastCandidate = request->firstCandidate + request->maxAttempts;
+    GeneratorJob job = {request, lastCandidate, request->firstCandidate, lastCandidate, 0, 0, 0, 0};
+
+    int rows = request->rows;
+    int cols = request->cols;
+    bool valid = rows > 0 && cols > 0 && request->totalMines >= 0
+                 && (long long)rows * cols <= 0x7fffffff && request->minBbbv <= request->maxBbbv;
+
+    // The first click and its neighbours must leave room for the mines
+    if (valid && request->noGuess)
+        valid = request->startRow >= 0 && request->startRow < rows
+                && request->startCol >= 0 && request->startCol < cols
+                && request->totalMines + 9 <= rows * cols;
+
+    // The calling thread works too while it waits
+    if (valid)
+        ParallelFor(NULL, GeneratorWorker, &job, 0, threadCount, 1);
+
+    bool found = valid && !job.failed && job.found < lastCandidate;
+
+    result->candidate = job.found;
+    result->seed = found ? CandidateSeed(request->baseSeed, job.found) : 0;
+    result->attempts = job.attempts;
+    result->rejectedEarly = job.rejectedEarly;
+    result->solverRuns = job.solverRuns;
+    result->threadCount = threadCount;
+    result->bbbv = 0;
+    result->zini = 0;
+
+    // Score the accepted board once more for the caller
+    if (found)
+    {
+        Game game;
+        BoardMetrics metrics;
+        InitBoardMetrics(&metrics);
+
+        if (InitGame(&game, rows, cols, request->totalMines, result->seed)
+            && ComputeBoardMetrics(&metrics, &game))
+        {
+            result->bbbv = metrics.bbbv;
+            result->zini = metrics.zini;
+        }
+
+        FreeGame(&game);
+        FreeBoardMetrics(&metrics);
+    }
+
+    result->elapsedSeconds = Now() - start;
+
+    return found;
+}
+
+/*
+Searches the candidate sequence of baseSeed for the first board
+that can be won from (startRow, startCol) without guessing.
+At most maxAttempts candidates are tried. See GenerateSeed().
+*/
+bool GenerateNoGuessSeed(int rows, int cols, int totalMines, int startRow, int startCol,
+                         uint64_t baseSeed, long maxAttempts, int threadCount,
+                         GeneratorResult *result)
+{
+    GeneratorRequest request = {rows, cols, totalMines, true, startRow, startCol, 0, INT_MAX,
+                                baseSeed, 0, maxAttempts};
+
+    return GenerateSeed(&request, threadCount, result);
+}
@@ -0,0 +1,72 @@
+
+// =============================================================
+// Board generator
+// Finds boards the solver can clear from a given first click
+// without ever having to guess, or whose 3BV lies in a band
+// =============================================================
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "engine.h"
+#include "solver.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// Upper limit for the worker jobs of one search
+#define GENERATOR_MAX_THREADS 16
+
+// Candidate boards tried before the game gives up on a no-guess deal
+#define GENERATOR_DEFAULT_ATTEMPTS 100000
+
+// -------------------- Data Structures --------------------
+
+/*
+What an accepted board must satisfy, and where to look for it.
+*/
+typedef struct
+{
+    int rows;
+    int cols;
+    int totalMines;
+
+    bool noGuess;           // Must be won from the first click without guessing
+    int startRow;           // That first click
+    int startCol;
+    int minBbbv;            // Accepted 3BV band (0 and INT_MAX for any)
+    int maxBbbv;
+
+    uint64_t baseSeed;      // Candidate sequence
+    long firstCandidate;    // Position the search starts at
+    long maxAttempts;       // Candidates tried from there at most
+} GeneratorRequest;
+
+/*
+Outcome of one search. The seed deals the board through the
+normal PlaceMines(), so saves and replays need nothing extra.
+*/
+typedef struct
+{
+    uint64_t seed;          // Seed of the accepted board
+    long candidate;         // Its position in the candidate sequence
+    long attempts;          // Boards dealt by all workers, including
+                            // speculative ones past the accepted board
+    long rejectedEarly;     // Attempts dropped before their 3BV was complete
+    long solverRuns;        // Attempts that reached the solver
+    int bbbv;               // Metrics of the accepted board
+    int zini;
+    int threadCount;        // Worker jobs the search ran as
+    double elapsedSeconds;
+} GeneratorResult;
+
+// -------------------- Function Prototypes --------------------
+
+bool IsSolvableWithoutGuessing(Game *game, Solver *solver, int startRow, int startCol);
+bool GenerateSeed(const GeneratorRequest *request, int threadCount, GeneratorResult *result);
+bool GenerateNoGuessSeed(int rows, int cols, int totalMines, int startRow, int startCol,
+                         uint64_t baseSeed, long maxAttempts, int threadCount,
+                         GeneratorResult *result);
+
+#endif
@@ -0,0 +1,259 @@
+
+// =============================================================
+// Undo / redo history
+// =============================================================
+
+#include "history.h"
+#include <string.h>
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Moves a journal array of count items to a block of the arena with
+room for at least needed items. The old block stays in the arena
+until the game is dealt again.
+*/
+static bool GrowJournal(Arena *arena, void **items, int count, int *capacity, int needed, size_t itemSize)
+{
+    if (needed <= *capacity)
+        return true;
+
+    void *grown = ArenaAlloc(arena, (size_t)needed * itemSize);
+
+    if (grown == NULL)
+        return false;
+
+    if (count > 0)
+        memcpy(grown, *items, (size_t)count * itemSize);
+
+    *items = grown;
+    *capacity = needed;
+
+    return true;
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Prepares an empty journal.
+*/
+void InitHistory(History *history)
+{
+    history->changes = NULL;
+    history->changeCount = 0;
+    history->changeCapacity = 0;
+
+    history->entries = NULL;
+    history->entryCount = 0;
+    history->entryCapacity = 0;
+    history->applied = 0;
+
+    history->arena = NULL;
+    history->overflow = false;
+}
+
+/*
+Forgets every move but keeps the memory for reuse.
+*/
+void ClearHistory(History *history)
+{
+    history->changeCount = 0;
+    history->entryCount = 0;
+    history->applied = 0;
+    history->overflow = false;
+}
+
+/*
+Forgets every move and the journal memory. The memory belongs to
+the arena of the game, which takes it back when the game is dealt
+again or freed.
+*/
+void FreeHistory(History *history)
+{
+    InitHistory(history);
+}
+
+/*
+Makes room in the game's arena for moveCount moves that change
+changeCount tiles between them, so a game that stays within that
+journals its moves without allocating. Returns false if memory
+runs out.
+*/
+bool ReserveHistory(History *history, Game *game, int moveCount, int changeCount)
+{
+    history->arena = game->arena;
+
+    return GrowJournal(history->arena, (void **)&history->entries, history->entryCount,
+                       &history->entryCapacity, moveCount, sizeof(HistoryEntry))
+           && GrowJournal(history->arena, (void **)&history->changes, history->changeCount,
+                          &history->changeCapacity, changeCount, sizeof(CellChange));
+}
+
+// =============================================================
+//                         RECORDING
+// =============================================================
+
+/*
+Opens a journal entry for the move about to be applied.
+Any undone moves are dropped since they can no longer be redone.
+*/
+void BeginHistoryEntry(History *history, const Game *game)
+{
+    if (history->applied < history->entryCount)
+    {
+        history->changeCount = history->entries[history->applied].firstChange;
+        history->entryCount = history->applied;
+    }
+
+    history->arena = game->arena;
+
+    if (history->entryCount == history->entryCapacity
+        && !GrowJournal(history->arena, (void **)&history->entries, history->entryCount, &history->entryCapacity,
+                        (history->entryCapacity > 0) ? history->entryCapacity * 2 : 64, sizeof(HistoryEntry)))
+    {
+        history->overflow = true;
+        return;
+    }
+
+    HistoryEntry *entry = &history->entries[history->entryCount];
+
+    entry->firstChange = history->changeCount;
+    entry->changeCount = 0;
+    entry->statusBefore = game->status;
+    entry->revealedBefore = game->revealedSafe;
+    entry->flaggedBefore = game->flaggedCount;
+    entry->explodedBefore = game->explodedIndex;
+
+    history->overflow = false;
+}
+
+/*
+Remembers the contents of a tile before the engine changes it.
+*/
+void RecordCellChange(History *history, int index, Cell saved)
+{
+    if (history->overflow)
+        return;
+
+    if (history->changeCount == history->changeCapacity
+        && !GrowJournal(history->arena, (void **)&history->changes, history->changeCount, &history->changeCapacity,
+                        (history->changeCapacity > 0) ? history->changeCapacity * 2 : 1024, sizeof(CellChange)))
+    {
+        history->overflow = true;
+        return;
+    }
+
+    history->changes[history->changeCount].index = index;
+    history->changes[history->changeCount].saved = saved;
+    history->changeCount++;
+}
+
+/*
+Closes the entry opened by BeginHistoryEntry().
+If memory ran out the journal is cleared rather than left with a
+move that could only be undone halfway.
+*/
+void CommitHistoryEntry(History *history, const Game *game)
+{
+    if (history->overflow)
+    {
+        ClearHistory(history);
+        return;
+    }
+
+    HistoryEntry *entry = &history->entries[history->entryCount];
+
+    entry->changeCount = history->changeCount - entry->firstChange;
+    entry->statusAfter = game->status;
+    entry->revealedAfter = game->revealedSafe;
+    entry->flaggedAfter = game->flaggedCount;
+    entry->explodedAfter = game->explodedIndex;
+
+    history->entryCount++;
+    history->applied = history->entryCount;
+}
+
+// =============================================================
+//                         NAVIGATION
+// =============================================================
+
+/*
+Checks whether there is a move to take back.
+*/
+bool CanUndo(const Game *game)
+{
+    return (game->history != NULL) && (game->history->applied > 0);
+}
+
+/*
+Checks whether there is an undone move to apply again.
+*/
+bool CanRedo(const Game *game)
+{
+    return (game->history != NULL) && (game->history->applied < game->history->entryCount);
+}
+
+/*
+Exchanges the journal copy of each tile with the board copy.
+Call it once the game status is restored, which the display
+state of the tiles depends on.
+*/
+static void SwapChanges(Game *game, const HistoryEntry *entry)
+{
+    CellChange *changes = &game->history->changes[entry->firstChange];
+
+    for (int i = 0; i < entry->changeCount; i++)
+    {
+        Cell current = game->cells[changes[i].index];
+
+        game->cells[changes[i].index] = changes[i].saved;
+        changes[i].saved = current;
+        SyncTile(game, changes[i].index);
+    }
+}
+
+/*
+Takes back the most recent move, including a lost game.
+*/
+bool UndoMove(Game *game)
+{
+    if (!CanUndo(game))
+        return false;
+
+    History *history = game->history;
+    const HistoryEntry *entry = &history->entries[--history->applied];
+
+    game->status = entry->statusBefore;
+    game->revealedSafe = entry->revealedBefore;
+    game->flaggedCount = entry->flaggedBefore;
+    game->explodedIndex = entry->explodedBefore;
+
+    SwapChanges(game, entry);
+
+    return true;
+}
+
+/*
+Applies the most recently undone move again.
+*/
+bool RedoMove(Game *game)
+{
+    if (!CanRedo(game))
+        return false;
+
+    History *history = game->history;
+    const HistoryEntry *entry = &history->entries[history->applied++];
+
+    game->status = entry->statusAfter;
+    game->revealedSafe = entry->revealedAfter;
+    game->flaggedCount = entry->flaggedAfter;
+    game->explodedIndex = entry->explodedAfter;
+
+    SwapChanges(game, entry);
+
+    return true;
+}
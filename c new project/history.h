@@ -0,0 +1,84 @@
+
+// =============================================================
+// Undo / redo history
+// Journal of the tiles each move changed, so undoing a move
+// costs as much as the move itself and never copies the board
+// =============================================================
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "engine.h"
+#include <stdbool.h>
+
+// -------------------- Data Structures --------------------
+
+/*
+Previous contents of one tile touched by a move.
+After an undo it holds the undone contents instead, so the
+same record serves the redo.
+*/
+typedef struct
+{
+    int index;      // row * cols + col
+    Cell saved;
+} CellChange;
+
+/*
+One move in the journal: a slice of the change list plus the
+game counters on both sides of the move.
+*/
+typedef struct
+{
+    int firstChange;
+    int changeCount;
+
+    GameStatus statusBefore;
+    GameStatus statusAfter;
+    int revealedBefore;
+    int revealedAfter;
+    int flaggedBefore;
+    int flaggedAfter;
+    int explodedBefore;
+    int explodedAfter;
+} HistoryEntry;
+
+/*
+Journal attached to a game through Game.history. Its arrays live
+in the game's arena; dealing the game again empties the journal.
+*/
+struct History
+{
+    CellChange *changes;
+    int changeCount;
+    int changeCapacity;
+
+    HistoryEntry *entries;
+    int entryCount;         // Moves in the journal, including undone ones
+    int entryCapacity;
+    int applied;            // Moves currently in effect
+
+    Arena *arena;           // Arena of the game the arrays came from
+    bool overflow;          // A change could not be stored this move
+};
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+void InitHistory(History *history);
+void ClearHistory(History *history);
+void FreeHistory(History *history);
+bool ReserveHistory(History *history, Game *game, int moveCount, int changeCount);
+
+// Recording (called by the engine)
+void BeginHistoryEntry(History *history, const Game *game);
+void RecordCellChange(History *history, int index, Cell saved);
+void CommitHistoryEntry(History *history, const Game *game);
+
+// Navigation
+bool CanUndo(const Game *game);
+bool CanRedo(const Game *game);
+bool UndoMove(Game *game);
+bool RedoMove(Game *game);
+
+#endif
@@ -0,0 +1,118 @@
+
+// =============================================================
+// Input event queue
+// =============================================================
+
+#include "raylib.h"
+#include "input.h"
+
+// =============================================================
+//                     QUEUE MANAGEMENT
+// =============================================================
+
+/*
+Prepares an empty queue.
+*/
+void InitInputQueue(InputQueue *queue)
+{
+    queue->head = 0;
+    queue->count = 0;
+    queue->dropped = 0;
+}
+
+/*
+Discards every pending event.
+*/
+void ClearInputQueue(InputQueue *queue)
+{
+    queue->head = 0;
+    queue->count = 0;
+}
+
+/*
+Appends an event. Returns false if the queue is full.
+*/
+bool PushInputEvent(InputQueue *queue, InputEvent event)
+{
+    if (queue->count == INPUT_QUEUE_CAPACITY)
+    {
+        queue->dropped++;
+        return false;
+    }
+
+    int tail = (queue->head + queue->count) & (INPUT_QUEUE_CAPACITY - 1);
+
+    queue->events[tail] = event;
+    queue->count++;
+
+    return true;
+}
+
+/*
+Removes the oldest event. Returns false if nothing is queued.
+*/
+bool PopInputEvent(InputQueue *queue, InputEvent *event)
+{
+    if (queue->count == 0)
+        return false;
+
+    *event = queue->events[queue->head];
+    queue->head = (queue->head + 1) & (INPUT_QUEUE_CAPACITY - 1);
+    queue->count--;
+
+    return true;
+}
+
+// =============================================================
+//                          SAMPLING
+// =============================================================
+
+/*
+Records the clicks and key presses seen since the last input poll.
+*/
+void CollectInputEvents(InputQueue *queue)
+{
+    Vector2 mouse = GetMousePosition();
+    double now = GetTime();
+
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+        PushInputEvent(queue, (InputEvent){INPUT_REVEAL, mouse.x, mouse.y, now});
+
+    if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON))
+        PushInputEvent(queue, (InputEvent){INPUT_FLAG, mouse.x, mouse.y, now});
+
+    if (IsKeyPressed(KEY_Z))
+        PushInputEvent(queue, (InputEvent){INPUT_UNDO, mouse.x, mouse.y, now});
+
+    if (IsKeyPressed(KEY_Y))
+        PushInputEvent(queue, (InputEvent){INPUT_REDO, mouse.x, mouse.y, now});
+
+    if (IsKeyPressed(KEY_S))
+        PushInputEvent(queue, (InputEvent){INPUT_SAVE, mouse.x, mouse.y, now});
+
+    if (IsKeyPressed(KEY_L))
+        PushInputEvent(queue, (InputEvent){INPUT_LOAD, mouse.x, mouse.y, now});
+
+    if (IsKeyPressed(KEY_H))
+        PushInputEvent(queue, (InputEvent){INPUT_HINT, mouse.x, mouse.y, now});
+
+    if (IsKeyPressed(KEY_F3))
+        PushInputEvent(queue, (InputEvent){INPUT_OVERLAY, mouse.x, mouse.y, now});
+}
+
+/*
+Keeps polling the window for input until the deadline passes.
+Replaces the frame-rate sleep so clicks between frames are
+captured close to when they happened instead of being merged.
+*/
+void SampleInputUntil(InputQueue *queue, double deadline)
+{
+    CollectInputEvents(queue);
+
+    while (GetTime() < deadline)
+    {
+        WaitTime(INPUT_POLL_INTERVAL);
+        PollInputEvents();
+        CollectInputEvents(queue);
+    }
+}
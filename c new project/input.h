@@ -0,0 +1,72 @@
+
+// =============================================================
+// Input event queue
+// Buffers clicks and key presses with their own position and
+// time so several of them inside one frame are all applied, in order
+// =============================================================
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+
+// -------------------- Constants --------------------
+
+// Maximum number of pending events (power of two)
+#define INPUT_QUEUE_CAPACITY 256
+
+// How often input is sampled while waiting for the next frame
+#define INPUT_POLL_INTERVAL 0.001
+
+// -------------------- Data Structures --------------------
+
+/*
+Kind of player action carried by an event.
+*/
+typedef enum
+{
+    INPUT_REVEAL,   // Left click on a tile
+    INPUT_FLAG,     // Right click on a tile
+    INPUT_UNDO,     // Z key
+    INPUT_REDO,     // Y key
+    INPUT_SAVE,     // S key
+    INPUT_LOAD,     // L key
+    INPUT_HINT,     // H key
+    INPUT_OVERLAY   // F3 key
+} InputAction;
+
+/*
+A single click or key press, captured at the moment it was sampled.
+*/
+typedef struct
+{
+    InputAction action;
+    float x;        // Cursor position when the click was sampled
+    float y;
+    double time;    // Seconds since the window was opened
+} InputEvent;
+
+/*
+Fixed-size ring buffer of pending events.
+*/
+typedef struct
+{
+    InputEvent events[INPUT_QUEUE_CAPACITY];
+    int head;       // Index of the oldest event
+    int count;      // Number of queued events
+    int dropped;    // Events lost because the queue was full
+} InputQueue;
+
+// -------------------- Function Prototypes --------------------
+
+// Queue management
+void InitInputQueue(InputQueue *queue);
+void ClearInputQueue(InputQueue *queue);
+bool PushInputEvent(InputQueue *queue, InputEvent event);
+bool PopInputEvent(InputQueue *queue, InputEvent *event);
+
+// Sampling from the window
+void CollectInputEvents(InputQueue *queue);
+void SampleInputUntil(InputQueue *queue, double deadline);
+
+#endif
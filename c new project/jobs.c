@@ -0,0 +1,611 @@
+
+// =============================================================
+// Job system
+//
+// Jobs are taken from fixed slots, so submitting one allocates
+// nothing. A worker pushes the jobs it submits onto its own queue
+// and runs its newest job first; when its queue is empty it steals
+// the oldest job of the other queues, the one shared by threads
+// outside the pool included. Workers with nothing to do sleep on
+// one condition variable and are woken as jobs arrive.
+//
+// A job may wait for a counter: it is parked on the counter and
+// queued when the counter's last job finishes. Threads waiting for
+// a counter run queued jobs meanwhile instead of blocking, so jobs
+// may wait for jobs of their own without deadlocking the pool.
+//
+// Jobs are meant to be coarse (a band of rows, a chunk, a worker's
+// share of a search): each one takes a few locks.
+// =============================================================
+
+#include "jobs.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <unistd.h>
+#endif
+
+// Pool returned by SharedJobSystem(), started on first use
+static JobSystem sharedPool;
+static pthread_once_t sharedPoolOnce = PTHREAD_ONCE_INIT;
+
+// Threads the shared pool runs jobs on, the caller included, or 0
+// for one per processor; see SetSharedJobThreads()
+static int sharedThreads = 0;
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Nanoseconds on a monotonic clock.
+*/
+static long long NowNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+/*
+Queue of the calling thread: its own for a worker of the pool, the
+shared one for any other thread.
+*/
+static int CurrentQueue(JobSystem *pool)
+{
+    intptr_t slot = (intptr_t)pthread_getspecific(pool->self);
+
+    return (slot > 0) ? (int)slot - 1 : pool->workerCount;
+}
+
+/*
+Wakes one sleeping thread, or all of them, if any sleeps.
+*/
+static void WakeSleepers(JobSystem *pool, bool all)
+{
+    if (__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) == 0)
+        return;
+
+    pthread_mutex_lock(&pool->sleepLock);
+
+    if (all)
+        pthread_cond_broadcast(&pool->wake);
+    else
+        pthread_cond_signal(&pool->wake);
+
+    pthread_mutex_unlock(&pool->sleepLock);
+}
+
+// =============================================================
+//                          QUEUES
+// =============================================================
+
+/*
+Takes a free job slot, or returns NULL if every slot is in use.
+*/
+static Job *AllocateJob(JobSystem *pool)
+{
+    pthread_mutex_lock(&pool->slotLock);
+
+    Job *job = pool->freeSlots;
+
+    if (job != NULL)
+        pool->freeSlots = job->next;
+
+    pthread_mutex_unlock(&pool->slotLock);
+
+    return job;
+}
+
+/*
+Returns a job slot.
+*/
+static void ReleaseJob(JobSystem *pool, Job *job)
+{
+    pthread_mutex_lock(&pool->slotLock);
+    job->next = pool->freeSlots;
+    pool->freeSlots = job;
+    pthread_mutex_unlock(&pool->slotLock);
+}
+
+/*
+Queues a job on the calling thread's queue and wakes a sleeper.
+Queues cannot overflow: they hold as many jobs as there are slots.
+*/
+static void PushJob(JobSystem *pool, Job *job)
+{
+    JobQueue *queue = &pool->queues[CurrentQueue(pool)];
+
+    pthread_mutex_lock(&queue->lock);
+    queue->jobs[(queue->head + queue->count) & (JOB_CAPACITY - 1)] = job;
+    queue->count++;
+    pthread_mutex_unlock(&queue->lock);
+
+    int queued = __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+    if (queued > __atomic_load_n(&pool->peakQueued, __ATOMIC_RELAXED))
+        __atomic_store_n(&pool->peakQueued, queued, __ATOMIC_RELAXED);
+
+    WakeSleepers(pool, false);
+}
+
+/*
+Removes the newest (or else the oldest) job of a queue, or returns
+NULL if it is empty.
+*/
+static Job *PopJob(JobSystem *pool, JobQueue *queue, bool newest)
+{
+    Job *job = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->count > 0)
+    {
+        if (newest)
+            job = queue->jobs[(queue->head + queue->count - 1) & (JOB_CAPACITY - 1)];
+        else
+        {
+            job = queue->jobs[queue->head];
+            queue->head = (queue->head + 1) & (JOB_CAPACITY - 1);
+        }
+
+        queue->count--;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    if (job != NULL)
+        __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+    return job;
+}
+
+/*
+Finds a job for the thread of queue index: its own newest, or else
+the oldest of another queue (a steal). Returns NULL if none is queued.
+*/
+static Job *TakeJob(JobSystem *pool, int index, bool *stolen)
+{
+    if (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0)
+        return NULL;
+
+    Job *job = PopJob(pool, &pool->queues[index], true);
+
+    *stolen = false;
+
+    for (int k = 1; job == NULL && k <= pool->workerCount; k++)
+    {
+        job = PopJob(pool, &pool->queues[(index + k) % (pool->workerCount + 1)], false);
+        *stolen = (job != NULL);
+    }
+
+    return job;
+}
+
+// =============================================================
+//                          RUNNING
+// =============================================================
+
+/*
+Counts a finished job down. The last one releases the jobs waiting
+for the counter. The counter is not touched after slotLock is
+released, since a waiter may free it as soon as it reads zero.
+*/
+static void FinishJob(JobSystem *pool, JobCounter *counter)
+{
+    Job *released = NULL;
+
+    pthread_mutex_lock(&pool->slotLock);
+
+    bool finished = __atomic_sub_fetch(&counter->pending, 1, __ATOMIC_SEQ_CST) == 0;
+
+    if (finished)
+    {
+        released = counter->waiting;
+        counter->waiting = NULL;
+    }
+
+    pthread_mutex_unlock(&pool->slotLock);
+
+    while (released != NULL)
+    {
+        Job *next = released->next;
+
+        PushJob(pool, released);
+        released = next;
+    }
+
+    // Threads waiting for the counter sleep with the workers
+    if (finished)
+        WakeSleepers(pool, true);
+}
+
+/*
+Runs a job taken by the thread of queue index and frees its slot.
+*/
+static void RunJob(JobSystem *pool, int index, Job *job, bool stolen)
+{
+    Job work = *job;
+    JobQueue *queue = &pool->queues[index];
+
+    ReleaseJob(pool, job);
+
+    work.function(work.argument, work.first, work.end);
+
+    __atomic_add_fetch(&queue->executed, 1, __ATOMIC_RELAXED);
+
+    if (stolen)
+        __atomic_add_fetch(&queue->steals, 1, __ATOMIC_RELAXED);
+
+    if (work.counter != NULL)
+        FinishJob(pool, work.counter);
+}
+
+/*
+Worker thread: runs jobs, sleeping while there are none, until the
+pool stops and its queues are empty.
+*/
+static void *JobWorker(void *argument)
+{
+    JobQueue *queue = argument;
+    JobSystem *pool = queue->pool;
+    int index = queue->index;
+
+    pthread_setspecific(pool->self, (void *)(intptr_t)(index + 1));
+
+    for (;;)
+    {
+        bool stolen;
+        Job *job = TakeJob(pool, index, &stolen);
+
+        if (job != NULL)
+        {
+            RunJob(pool, index, job, stolen);
+            continue;
+        }
+
+        long long idleStart = NowNanoseconds();
+
+        pthread_mutex_lock(&pool->sleepLock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+
+        while (__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0 && !pool->stopping)
+            pthread_cond_wait(&pool->wake, &pool->sleepLock);
+
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+
+        bool stopping = pool->stopping && __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0;
+
+        pthread_mutex_unlock(&pool->sleepLock);
+
+        __atomic_add_fetch(&queue->idleNanoseconds, NowNanoseconds() - idleStart, __ATOMIC_RELAXED);
+
+        if (stopping)
+            break;
+    }
+
+    return NULL;
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Starts a pool of workerCount threads. With no workers, jobs run
+only while some thread waits for them. Returns false if memory
+runs out or a thread does not start; the pool is then unusable
+and needs no freeing.
+*/
+bool InitJobSystem(JobSystem *pool, int workerCount)
+{
+    if (workerCount < 0)
+        workerCount = 0;
+    if (workerCount > JOB_MAX_WORKERS)
+        workerCount = JOB_MAX_WORKERS;
+
+    *pool = (JobSystem){0};
+    pool->workerCount = workerCount;
+    pool->queues = calloc((size_t)workerCount + 1, sizeof(JobQueue));
+    pool->slots = malloc(JOB_CAPACITY * sizeof(Job));
+
+    if (pool->queues == NULL || pool->slots == NULL || pthread_key_create(&pool->self, NULL) != 0)
+    {
+        free(pool->queues);
+        free(pool->slots);
+        return false;
+    }
+
+    for (int q = 0; q <= workerCount; q++)
+    {
+        pool->queues[q].pool = pool;
+        pool->queues[q].index = q;
+        pthread_mutex_init(&pool->queues[q].lock, NULL);
+    }
+
+    for (int i = 0; i < JOB_CAPACITY; i++)
+        pool->slots[i].next = (i + 1 < JOB_CAPACITY) ? &pool->slots[i + 1] : NULL;
+
+    pool->freeSlots = &pool->slots[0];
+
+    pthread_mutex_init(&pool->slotLock, NULL);
+    pthread_mutex_init(&pool->sleepLock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    int started = 0;
+
+    while (started < workerCount
+           && pthread_create(&pool->threads[started], NULL, JobWorker, &pool->queues[started]) == 0)
+        started++;
+
+    if (started < workerCount)
+    {
+        pool->workerCount = started;
+        FreeJobSystem(pool);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+Stops the workers once the queued jobs have run, and releases the
+pool. Jobs still parked on counters are dropped.
+*/
+void FreeJobSystem(JobSystem *pool)
+{
+    pthread_mutex_lock(&pool->sleepLock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->sleepLock);
+
+    for (int t = 0; t < pool->workerCount; t++)
+        pthread_join(pool->threads[t], NULL);
+
+    for (int q = 0; q <= pool->workerCount; q++)
+        pthread_mutex_destroy(&pool->queues[q].lock);
+
+    pthread_mutex_destroy(&pool->slotLock);
+    pthread_mutex_destroy(&pool->sleepLock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_key_delete(pool->self);
+
+    free(pool->queues);
+    free(pool->slots);
+
+    pool->queues = NULL;
+    pool->slots = NULL;
+    pool->workerCount = 0;
+}
+
+/*
+Starts the shared pool with one thread per processor, or with the
+threads SetSharedJobThreads() asked for, or with no workers if that
+fails. The caller waiting on a job counts as one of the threads.
+*/
+static void StartSharedPool(void)
+{
+    int threadCount = (sharedThreads > 0) ? sharedThreads : CountProcessors();
+    int workerCount = (threadCount > 1) ? threadCount - 1 : 0;
+
+    if (!InitJobSystem(&sharedPool, workerCount))
+        InitJobSystem(&sharedPool, 0);
+}
+
+/*
+Makes the shared pool run jobs on threadCount threads, the caller
+waiting for them included (0 or less: one per processor).
+Only calls made before the pool's first use have an effect.
+*/
+void SetSharedJobThreads(int threadCount)
+{
+    sharedThreads = (threadCount > JOB_MAX_WORKERS + 1) ? JOB_MAX_WORKERS + 1 : threadCount;
+}
+
+/*
+The pool every subsystem uses, started on first use and kept until
+the program exits.
+*/
+JobSystem *SharedJobSystem(void)
+{
+    pthread_once(&sharedPoolOnce, StartSharedPool);
+
+    return &sharedPool;
+}
+
+// =============================================================
+//                           SIZING
+// =============================================================
+
+/*
+Number of processors available to the program.
+*/
+int CountProcessors(void)
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (int)count : 1;
+#endif
+}
+
+/*
+Threads that run jobs of a pool (NULL for the shared one) at once:
+its workers and a caller waiting for them. Work split into more
+jobs than this gains nothing.
+*/
+int CountJobThreads(JobSystem *pool)
+{
+    if (pool == NULL)
+        pool = SharedJobSystem();
+
+    return pool->workerCount + 1;
+}
+
+// =============================================================
+//                            JOBS
+// =============================================================
+
+/*
+Queues function(argument, first, end) on a pool (NULL for the shared
+one). If after is given, the job waits until after reaches zero; if
+done is given, it is counted up now and down once the job has run.
+*/
+void SubmitJob(JobSystem *pool, JobFunction function, void *argument, int first, int end,
+               JobCounter *after, JobCounter *done)
+{
+    if (pool == NULL)
+        pool = SharedJobSystem();
+
+    if (done != NULL)
+        __atomic_add_fetch(&done->pending, 1, __ATOMIC_SEQ_CST);
+
+    Job *job = AllocateJob(pool);
+
+    if (job == NULL)
+    {
+        // Every slot is taken: run it here, in order
+        if (after != NULL)
+            WaitForJobs(pool, after);
+
+        __atomic_add_fetch(&pool->inlined, 1, __ATOMIC_RELAXED);
+        function(argument, first, end);
+
+        if (done != NULL)
+            FinishJob(pool, done);
+
+        return;
+    }
+
+    *job = (Job){function, argument, first, end, done, NULL};
+
+    if (after != NULL)
+    {
+        pthread_mutex_lock(&pool->slotLock);
+
+        bool parked = __atomic_load_n(&after->pending, __ATOMIC_SEQ_CST) > 0;
+
+        if (parked)
+        {
+            job->next = after->waiting;
+            after->waiting = job;
+        }
+
+        pthread_mutex_unlock(&pool->slotLock);
+
+        if (parked)
+            return;
+    }
+
+    PushJob(pool, job);
+}
+
+/*
+Queues items first..end-1 as jobs of grain items each (0 picks a
+grain giving every thread a few jobs). after and done apply to
+every job, as in SubmitJob().
+*/
+void SubmitParallelFor(JobSystem *pool, JobFunction function, void *argument, int first, int end, int grain,
+                       JobCounter *after, JobCounter *done)
+{
+    if (pool == NULL)
+        pool = SharedJobSystem();
+
+    if (grain <= 0)
+        grain = (end - first) / (4 * (pool->workerCount + 1));
+    if (grain < 1)
+        grain = 1;
+
+    for (int start = first; start < end; start += grain)
+        SubmitJob(pool, function, argument, start, (end - start > grain) ? start + grain : end, after, done);
+}
+
+/*
+Returns once counter reaches zero, running queued jobs (of any
+counter) in the meantime.
+*/
+void WaitForJobs(JobSystem *pool, JobCounter *counter)
+{
+    if (pool == NULL)
+        pool = SharedJobSystem();
+
+    int index = CurrentQueue(pool);
+
+    while (__atomic_load_n(&counter->pending, __ATOMIC_SEQ_CST) > 0)
+    {
+        bool stolen;
+        Job *job = TakeJob(pool, index, &stolen);
+
+        if (job != NULL)
+        {
+            RunJob(pool, index, job, stolen);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->sleepLock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+
+        while (__atomic_load_n(&counter->pending, __ATOMIC_SEQ_CST) > 0
+               && __atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0)
+            pthread_cond_wait(&pool->wake, &pool->sleepLock);
+
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&pool->sleepLock);
+    }
+
+    // The last FinishJob() may still hold the counter; wait it out
+    pthread_mutex_lock(&pool->slotLock);
+    pthread_mutex_unlock(&pool->slotLock);
+}
+
+/*
+Runs items first..end-1 in jobs of grain items on a pool (NULL for
+the shared one) and returns when all have run. See SubmitParallelFor().
+*/
+void ParallelFor(JobSystem *pool, JobFunction function, void *argument, int first, int end, int grain)
+{
+    JobCounter done = {0};
+
+    SubmitParallelFor(pool, function, argument, first, end, grain, NULL, &done);
+    WaitForJobs(pool, &done);
+}
+
+// =============================================================
+//                         STATISTICS
+// =============================================================
+
+/*
+Reads the counters of a pool (NULL for the shared one). Safe while
+jobs run; the totals are then only roughly consistent.
+*/
+void ReadJobStats(JobSystem *pool, JobStats *stats)
+{
+    if (pool == NULL)
+        pool = SharedJobSystem();
+
+    *stats = (JobStats){0};
+    stats->workerCount = pool->workerCount;
+    stats->queued = __atomic_load_n(&pool->queued, __ATOMIC_RELAXED);
+    stats->peakQueued = __atomic_load_n(&pool->peakQueued, __ATOMIC_RELAXED);
+    stats->inlined = __atomic_load_n(&pool->inlined, __ATOMIC_RELAXED);
+
+    long long idle = 0;
+
+    for (int q = 0; q <= pool->workerCount; q++)
+    {
+        stats->executed += __atomic_load_n(&pool->queues[q].executed, __ATOMIC_RELAXED);
+        stats->steals += __atomic_load_n(&pool->queues[q].steals, __ATOMIC_RELAXED);
+        idle += __atomic_load_n(&pool->queues[q].idleNanoseconds, __ATOMIC_RELAXED);
+    }
+
+    stats->idleSeconds = idle * 1e-9;
+}
@@ -0,0 +1,140 @@
+
+// =============================================================
+// Job system
+// One pool of worker threads shared by every part of the program
+// that runs work in parallel: dealing, generation, probabilities,
+// self-play, the batch environment and the chunk prefetcher. Each
+// worker keeps its own queue of jobs and steals from the others
+// when it runs dry; threads waiting for jobs run jobs meanwhile
+// =============================================================
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+// -------------------- Constants --------------------
+
+// Upper limit for the worker threads of one pool
+#define JOB_MAX_WORKERS 64
+
+// Jobs one pool holds at once, queued or waiting for others. A job
+// submitted while every slot is taken runs at once on the caller
+#define JOB_CAPACITY 1024
+
+// -------------------- Data Structures --------------------
+
+/*
+Work of one job: items first..end-1 of whatever argument points at.
+*/
+typedef void (*JobFunction)(void *argument, int first, int end);
+
+typedef struct Job Job;
+
+/*
+A job and the links it needs while it waits.
+*/
+struct Job
+{
+    JobFunction function;
+    void *argument;
+    int first;
+    int end;
+    struct JobCounter *counter;     // Counts the job down when it has run, or NULL
+    Job *next;                      // Free list, or the jobs waiting for a counter
+};
+
+/*
+Jobs not finished yet, and the jobs that wait until none are left.
+Zero it before use; it may be reused once it has reached zero.
+*/
+typedef struct JobCounter
+{
+    int pending;            // Submitted and not finished (atomic)
+    Job *waiting;           // Released when pending reaches zero
+} JobCounter;
+
+/*
+Ring of jobs of one worker. The worker takes its newest job, so
+work it just split stays in its cache; thieves take the oldest.
+The counters are updated with atomics and read by anyone.
+*/
+typedef struct
+{
+    struct JobSystem *pool; // Pool and position of the queue, for its worker
+    int index;
+
+    pthread_mutex_t lock;
+    Job *jobs[JOB_CAPACITY];
+    int head;               // Oldest job
+    int count;
+
+    long executed;          // Jobs run by this worker
+    long steals;            // Of those, taken from another queue
+    long long idleNanoseconds;
+    char padding[64];       // Keeps the next queue off this cache line
+} JobQueue;
+
+/*
+Worker threads, their queues and the job slots. Queue workerCount
+belongs to every thread outside the pool: jobs they submit go there.
+*/
+typedef struct JobSystem
+{
+    int workerCount;
+    pthread_t threads[JOB_MAX_WORKERS];
+    JobQueue *queues;       // workerCount + 1
+    pthread_key_t self;     // Queue of the calling worker, plus one
+
+    Job *slots;
+    Job *freeSlots;
+    pthread_mutex_t slotLock;       // Guards freeSlots and every counter's waiting list
+
+    pthread_mutex_t sleepLock;
+    pthread_cond_t wake;
+    int sleepers;           // Threads waiting on wake (atomic)
+    int queued;             // Jobs in the queues (atomic)
+    int peakQueued;
+    long inlined;           // Jobs run at once for want of a slot (atomic)
+    bool stopping;
+} JobSystem;
+
+/*
+Snapshot of a pool's counters, summed over its queues.
+*/
+typedef struct
+{
+    int workerCount;
+    int queued;             // Jobs waiting in the queues now
+    int peakQueued;
+    long executed;
+    long steals;
+    long inlined;
+    double idleSeconds;     // Summed over the workers
+} JobStats;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool InitJobSystem(JobSystem *pool, int workerCount);
+void FreeJobSystem(JobSystem *pool);
+JobSystem *SharedJobSystem(void);
+void SetSharedJobThreads(int threadCount);
+
+// Sizing
+int CountProcessors(void);
+int CountJobThreads(JobSystem *pool);
+
+// Jobs
+void SubmitJob(JobSystem *pool, JobFunction function, void *argument, int first, int end,
+               JobCounter *after, JobCounter *done);
+void SubmitParallelFor(JobSystem *pool, JobFunction function, void *argument, int first, int end, int grain,
+                       JobCounter *after, JobCounter *done);
+void WaitForJobs(JobSystem *pool, JobCounter *counter);
+void ParallelFor(JobSystem *pool, JobFunction function, void *argument, int first, int end, int grain);
+
+// Statistics
+void ReadJobStats(JobSystem *pool, JobStats *stats);
+
+#endif
@@ -6,7 +6,25 @@
 // =============================================================
 
 #include "raylib.h"
+#include "bench.h"
+#include "chunkstore.h"
+#include "engine.h"
+#include "generator.h"
+#include "history.h"
+#include "input.h"
+#include "jobs.h"
+#include "prefetch.h"
+#include "replay.h"
+#include "savegame.h"
+#include "world.h"
+#include "probability.h"
+#include "solver.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <stdbool.h>
 
@@ -25,19 +43,33 @@
 // Frame rate limit
 #define MAX_FPS 60
 
-// -------------------- Data Structure --------------------
+// Time allowed for mine chances when no move is certain (seconds)
+#define HINT_PROBABILITY_BUDGET 0.1
 
-/*
-Represents a single grid cell of the board.
-Stores game state for each tile.
-*/
-typedef struct
-{
-    bool revealed;     // Whether the tile is opened
-    bool hasMine;      // Whether the tile contains a mine
-    bool flagged;      // Whether the player marked this tile
-    int nearbyMines;   // Number shown when revealed
-} Cell;
+// Moves skipped by one arrow key press while watching a replay
+#define REPLAY_SEEK_STEP 100
+
+// Where S / L save and restore the game in progress
+#define SAVE_FILE "savegame.mss"
+#define SAVE_REPLAY_FILE "savegame.msr"
+
+// Endless mode: tiles visible at once, mine density, scroll speed
+#define ENDLESS_VIEW_ROWS 12
+#define ENDLESS_VIEW_COLS 16
+#define ENDLESS_DENSITY 0.16
+#define ENDLESS_SCROLL_SPEED 12.0   // Tiles per second
+
+// Endless mode: chunks kept in memory, the rest go to this file
+#define ENDLESS_RESIDENT_CHUNKS 1024
+#define ENDLESS_SPILL_FILE "endless.msc"
+
+// How often the performance overlay recomputes its rates (seconds)
+#define OVERLAY_INTERVAL 0.5
+
+// Memory set aside when a game starts: moves the undo journal and the
+// recording hold, and arena room for flood fills and hints (bytes)
+#define RESERVED_MOVES 4096
+#define RESERVED_SCRATCH (2 * 1024 * 1024)
 
 // -------------------- Global Audio & Texture --------------------
 
@@ -56,222 +88,752 @@ static bool playedGameOver = false;
 static bool playedWin = false;
 static bool playedBoom = false;
 
+// Time the current game started, for replay timestamps
+static double gameStartTime = 0.0;
+
+// Result of the H key, shown until the next action
+static bool hintShown = false;
+static Move hintMove;
+static const char *hintMessage = NULL;
+static char hintText[64];
+
+// Performance overlay, toggled with F3
+static bool overlayShown = false;
+
 // -------------------- Function Prototypes --------------------
 
-// Board setup
-void InitializeBoard(Cell board[ROWS][COLS]);
-void PlaceMines(Cell board[ROWS][COLS]);
-void CountNearbyMines(Cell board[ROWS][COLS]);
+// Program modes
+int RunGame(bool noGuess);
+int RunEndless(void);
+int WatchReplay(const char *path);
+int VerifyReplay(const char *path);
+int GenerateBoards(long count, GeneratorRequest *request, int threadCount);
+void PrintUsage(const char *program);
+
+// Window and resources
+void OpenGameWindow(int rows, int cols);
+void CloseGameWindow(void);
 
-// Game actions
-void RevealEmptyCells(Cell board[ROWS][COLS], int row, int col);
-void RevealAllMines(Cell board[ROWS][COLS]);
+// Memory
+void ReserveGameMemory(Game *game, History *history, Replay *recording, Solver *solver, ProbabilityMap *chances);
+void CheckFrameAllocations(bool letOff);
+long WorldGrowth(const World *world, const ChunkPrefetcher *prefetcher);
 
 // Player interaction
-void HandleMouseInput(Cell board[ROWS][COLS], bool *gameOver);
-bool CheckWin(Cell board[ROWS][COLS]);
+MoveResult PlayMove(Game *game, Move move);
+void PlayMoveSound(MoveResult result);
+void HandleMouseInput(Game *game, InputEvent event, Replay *recording);
+void UndoLastMove(Game *game, Replay *recording);
+void RedoLastMove(Game *game, Replay *recording);
+void SaveGameReplay(Replay *recording, const Game *game);
+void SaveCurrentGame(const Game *game, Replay *recording);
+void LoadSavedGame(Game *game, History *history, Replay *recording);
+void ShowHint(Solver *solver, ProbabilityMap *chances, Game *game);
 
 // Rendering
-void DrawGame(Cell board[ROWS][COLS], bool gameOver, bool win);
+void DrawGame(const Game *game, const char *message);
+void DrawWorld(const World *world, double cameraX, double cameraY);
+void DrawTile(Rectangle cell, bool light, uint8_t display);
+void DrawPerformanceOverlay(void);
 
 // =============================================================
 //                         MAIN
 // =============================================================
 
-int main(void)
+int main(int argc, char **argv)
 {
-    // Create the game window
-    InitWindow(COLS * CELL_SIZE, ROWS * CELL_SIZE + 50,
-               "Minesweeper - Raylib Styled");
+    const char *replayPath = NULL;
+    bool headless = false;
+    bool noGuess = false;
+    bool endless = false;
+    int solverGames = 0;
+    int generatorBoards = 0;
+    int metricBoards = 0;
+    int environmentGames = 0;
+    long worldClicks = 0;
+    int layoutSize = 0;
+    int topologySize = 0;
+    int dealSize = 0;
+    long simulatedGames = 0;
+    long generatedBoards = 0;
+    int minBbbv = 0;
+    int maxBbbv = INT_MAX;
+    BotKind bot = BOT_LINEAR;
+    int boardRows = BENCH_EXPERT_ROWS;
+    int boardCols = BENCH_EXPERT_COLS;
+    int boardMines = BENCH_EXPERT_MINES;
+    int threadCount = 0;
+
+    // Read command line options
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--bench-solver") == 0)
+            solverGames = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 1000;
+        else if (strcmp(argv[i], "--bench-generator") == 0)
+            generatorBoards = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 20;
+        else if (strcmp(argv[i], "--bench-metrics") == 0)
+            metricBoards = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 100;
+        else if (strcmp(argv[i], "--bench-env") == 0)
+            environmentGames = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 4096;
+        else if (strcmp(argv[i], "--bench-world") == 0)
+            worldClicks = (i + 1 < argc && atol(argv[i + 1]) > 0) ? atol(argv[++i]) : 200000;
+        else if (strcmp(argv[i], "--bench-layout") == 0)
+            layoutSize = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 4096;
+        else if (strcmp(argv[i], "--bench-topology") == 0)
+            topologySize = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 2048;
+        else if (strcmp(argv[i], "--bench-deal") == 0)
+            dealSize = (i + 1 < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[++i]) : 10000;
+        else if (strcmp(argv[i], "--no-guess") == 0)
+            noGuess = true;
+        else if (strcmp(argv[i], "--endless") == 0)
+            endless = true;
+        else if (strcmp(argv[i], "--simulate") == 0)
+            simulatedGames = (i + 1 < argc && atol(argv[i + 1]) > 0) ? atol(argv[++i]) : 100000;
+        else if (strcmp(argv[i], "--bot") == 0 && i + 1 < argc && ParseBotName(argv[i + 1], &bot))
+            i++;
+        else if (strcmp(argv[i], "--board") == 0 && i + 1 < argc
+                 && sscanf(argv[i + 1], "%dx%dx%d", &boardRows, &boardCols, &boardMines) == 3)
+            i++;
+        else if (strcmp(argv[i], "--generate") == 0)
+            generatedBoards = (i + 1 < argc && atol(argv[i + 1]) > 0) ? atol(argv[++i]) : 10;
+        else if (strcmp(argv[i], "--bbbv") == 0 && i + 1 < argc
+                 && sscanf(argv[i + 1], "%d-%d", &minBbbv, &maxBbbv) == 2)
+            i++;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threadCount = atoi(argv[++i]);
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
 
-    // Set game speed
-    SetTargetFPS(MAX_FPS);
+    // Every parallel mode runs on the shared job system; size it
+    // before anything starts it
+    if (threadCount > 0)
+        SetSharedJobThreads(threadCount);
+
+    if (solverGames > 0)
+        return BenchmarkSolvers(solverGames);
+
+    if (generatorBoards > 0)
+        return BenchmarkGenerator(generatorBoards);
+
+    if (metricBoards > 0)
+        return BenchmarkMetrics(metricBoards);
+
+    if (environmentGames > 0)
+        return BenchmarkEnvironment(environmentGames, threadCount);
+
+    if (worldClicks > 0)
+        return BenchmarkWorld(worldClicks);
 
+    if (layoutSize > 0)
+        return BenchmarkLayouts(layoutSize);
+
+    if (topologySize > 0)
+        return BenchmarkTopologies(topologySize);
+
+    if (dealSize > 0)
+        return BenchmarkDealing(dealSize);
+
+    if (simulatedGames > 0)
+        return SimulateGames(simulatedGames, bot, boardRows, boardCols, boardMines, threadCount);
+
+    if (generatedBoards > 0)
+    {
+        uint64_t seed = (uint64_t)time(NULL);
+        GeneratorRequest request = {boardRows, boardCols, boardMines, noGuess, boardRows / 2, boardCols / 2,
+                                    minBbbv, maxBbbv, NextRandom(&seed), 0, GENERATOR_DEFAULT_ATTEMPTS};
+
+        return GenerateBoards(generatedBoards, &request, threadCount);
+    }
+
+    if (endless)
+        return RunEndless();
+
+    if (replayPath == NULL)
+        return RunGame(noGuess);
+
+    return headless ? VerifyReplay(replayPath) : WatchReplay(replayPath);
+}
+
+/*
+Explains the command line options.
+*/
+void PrintUsage(const char *program)
+{
+    printf("Usage:\n");
+    printf("  %s                               play a new game\n", program);
+    printf("  %s --no-guess                    play a board that never needs a guess\n", program);
+    printf("  %s --endless                     scroll through a board without edges\n", program);
+    printf("  %s --replay FILE                 watch a recorded game\n", program);
+    printf("  %s --replay FILE --headless      verify a recording at full speed\n", program);
+    printf("  %s --bench-solver [GAMES]        compare solver modes on expert boards\n", program);
+    printf("  %s --bench-generator [BOARDS]    measure no-guess board generation\n", program);
+    printf("  %s --bench-metrics [BOARDS]      measure 3BV and difficulty metrics\n", program);
+    printf("  %s --bench-env [GAMES]           measure batched environment steps\n", program);
+    printf("  %s --bench-world [CLICKS]        measure the endless world and its chunk store\n", program);
+    printf("  %s --bench-layout [SIZE]         compare board layouts on a SIZE x SIZE board\n", program);
+    printf("  %s --bench-topology [SIZE]       compare board topologies on a SIZE x SIZE board\n", program);
+    printf("  %s --bench-deal [SIZE]           deal a SIZE x SIZE board in bands on several threads\n", program);
+    printf("  %s --simulate [GAMES]            let a bot play games without a window\n", program);
+    printf("  %s --generate [COUNT]            print seeds of boards that pass the filters\n", program);
+    printf("      --bbbv MIN-MAX                          3BV band (default any)\n");
+    printf("      --no-guess                              winnable from the centre without guessing\n");
+    printf("  Options shared by --simulate, --generate and --bench-env:\n");
+    printf("      --bot random|rules|linear|probability   (default linear, --simulate only)\n");
+    printf("      --board ROWSxCOLSxMINES                 (default %dx%dx%d)\n",
+           BENCH_EXPERT_ROWS, BENCH_EXPERT_COLS, BENCH_EXPERT_MINES);
+    printf("      --threads N                             (default: every processor)\n");
+}
+
+// =============================================================
+//                       PROGRAM MODES
+// =============================================================
+
+/*
+Plays one interactive game and records it. With noGuess set the
+board is one the solver clears without guessing, and the centre
+tile it starts from is opened for the player.
+*/
+int RunGame(bool noGuess)
+{
     // Randomize mine placement
-    srand((unsigned)time(NULL));
+    uint64_t seed = (uint64_t)time(NULL);
+    seed = NextRandom(&seed);
 
-    // Initialize audio system
-    InitAudioDevice();
+    // Create the game board and place the mines
+    Game game;
 
-    // Load game sounds
-    numberSound = LoadSound("number.mp3");
-    boomSound = LoadSound("boom.mp3");
-    flagSound = LoadSound("flag.mp3");
-    gameOverSound = LoadSound("over.mp3");
-    winSound = LoadSound("win.mp3");
+    if (!InitGame(&game, ROWS, COLS, TOTAL_MINES, seed))
+        return 1;
 
-    // Load mine texture
-    boomTexture = LoadTexture("boomm.png");
+    // Swap in a board that never needs a guess from the centre
+    GeneratorResult generated;
+
+    if (noGuess && GenerateNoGuessSeed(ROWS, COLS, TOTAL_MINES, ROWS / 2, COLS / 2, seed,
+                                       GENERATOR_DEFAULT_ATTEMPTS, 0, &generated))
+        ResetGame(&game, generated.seed);
+    else if (noGuess)
+    {
+        fprintf(stderr, "No no-guess board found; playing a normal one\n");
+        noGuess = false;
+    }
 
-    // Create the game board
-    Cell board[ROWS][COLS];
+    // Journal of changed tiles for undo / redo
+    History history;
+    InitHistory(&history);
+    game.history = &history;
 
-    // Prepare the board and mines
-    InitializeBoard(board);
-    PlaceMines(board);
-    CountNearbyMines(board);
+    // Every game is recorded so it can be reproduced later
+    Replay recording;
+    BeginReplay(&recording, &game);
 
-    bool gameOver = false;
-    bool win = false;
+    OpenGameWindow(game.rows, game.cols);
+
+    // Clicks waiting to be applied
+    InputQueue inputQueue;
+    InitInputQueue(&inputQueue);
+
+    // Deductions for the H key, kept warm between hints
+    Solver solver;
+    InitSolver(&solver);
+    ProbabilityMap chances;
+    InitProbabilityMap(&chances);
+
+    // Everything play needs is allocated now, not during frames
+    ReserveGameMemory(&game, &history, &recording, &solver, &chances);
+
+    // Set game speed (frames are paced by the input sampler)
+    gameStartTime = GetTime();
+    double nextFrame = gameStartTime;
+    bool replaySaved = false;
+
+    // The no-guess guarantee holds only from the centre tile
+    if (noGuess)
+    {
+        Move firstMove = {MOVE_REVEAL, ROWS / 2, COLS / 2};
+
+        if (PlayMove(&game, firstMove) != MOVE_IGNORED)
+            RecordMove(&recording, &game, firstMove, 0);
+    }
+
+    CheckFrameAllocations(true);
 
     // Main game loop
     while (!WindowShouldClose())
     {
-        // Allow input only during active game
-        if (!gameOver && !win)
+        bool usedFiles = false;
+
+        // Collect every click until the next frame is due
+        nextFrame += 1.0 / MAX_FPS;
+        SampleInputUntil(&inputQueue, nextFrame);
+
+        // Do not try to catch up after a long stall
+        if (GetTime() > nextFrame + 1.0 / MAX_FPS)
+            nextFrame = GetTime();
+
+        // Apply queued input in order (clicks after the game ended are ignored)
+        InputEvent event;
+
+        while (PopInputEvent(&inputQueue, &event))
         {
-            HandleMouseInput(board, &gameOver);
+            // The overlay leaves everything else as it is
+            if (event.action == INPUT_OVERLAY)
+            {
+                overlayShown = !overlayShown;
+                continue;
+            }
 
-            // Check win condition
-            if (CheckWin(board))
+            // Any other action makes the hint stale
+            if (event.action != INPUT_HINT)
             {
-                win = true;
+                hintShown = false;
+                hintMessage = NULL;
+            }
 
-                if (!playedWin)
-                {
-                    PlaySound(winSound);
-                    playedWin = true;
-                }
+            if (event.action == INPUT_HINT)
+                ShowHint(&solver, &chances, &game);
+            else if (event.action == INPUT_UNDO)
+                UndoLastMove(&game, &recording);
+            else if (event.action == INPUT_REDO)
+                RedoLastMove(&game, &recording);
+            else if (event.action == INPUT_SAVE)
+            {
+                SaveCurrentGame(&game, &recording);
+                usedFiles = true;
             }
+            else if (event.action == INPUT_LOAD)
+            {
+                LoadSavedGame(&game, &history, &recording);
+                ReserveGameMemory(&game, &history, &recording, &solver, &chances);
+                usedFiles = true;
+            }
+            else
+                HandleMouseInput(&game, event, &recording);
+        }
+
+        // Save the replay whenever the game ends; undo can resume it
+        if (game.status == GAME_PLAYING)
+            replaySaved = false;
+        else if (!replaySaved)
+        {
+            SaveGameReplay(&recording, &game);
+            replaySaved = true;
+            usedFiles = true;
         }
 
         // Render game
-        DrawGame(board, gameOver, win);
-    }
+        DrawGame(&game, (game.status == GAME_LOST) ? "Z: Undo" : hintMessage);
 
-    // Release resources
-    UnloadSound(numberSound);
-    UnloadSound(boomSound);
-    UnloadSound(flagSound);
-    UnloadSound(gameOverSound);
-    UnloadSound(winSound);
+        CheckFrameAllocations(usedFiles);
+    }
 
-    UnloadTexture(boomTexture);
+    // Unfinished games are kept too
+    if (!replaySaved)
+        SaveGameReplay(&recording, &game);
 
-    CloseAudioDevice();
-    CloseWindow();
+    // Release resources
+    FreeProbabilityMap(&chances);
+    FreeSolver(&solver);
+    FreeReplay(&recording);
+    CloseGameWindow();
+    FreeGame(&game);
+    FreeHistory(&history);
 
     return 0;
 }
 
-// =============================================================
-//                    BOARD INITIALIZATION
-// =============================================================
-
 /*
-Resets the entire board for a new game.
+Plays on a board without edges. The view follows the arrow keys;
+the world only remembers the chunks that play has touched, and
+keeps the least recently used of them on disk. Chunks the view is
+heading for are prepared on background threads.
 */
-void InitializeBoard(Cell board[ROWS][COLS])
+int RunEndless(void)
 {
-    for (int r = 0; r < ROWS; r++)
+    uint64_t seed = (uint64_t)time(NULL);
+    seed = NextRandom(&seed);
+
+    World world;
+
+    if (!InitWorld(&world, seed, ENDLESS_DENSITY))
+    {
+        FreeWorld(&world);
+        return 1;
+    }
+
+    ChunkStore store;
+    bool stored = OpenChunkStore(&store, ENDLESS_SPILL_FILE, world.seed);
+
+    if (stored)
+        AttachChunkStore(&world, &store, ENDLESS_RESIDENT_CHUNKS);
+    else
+        fprintf(stderr, "Cannot create '%s'; the whole world stays in memory\n", ENDLESS_SPILL_FILE);
+
+    WorldPoint start = OpenWorldStart(&world);
+
+    // Without workers, chunks are simply made when first needed
+    ChunkPrefetcher prefetcher;
+    StartChunkPrefetcher(&prefetcher, &world, stored ? &store : NULL, NULL);
+
+    OpenGameWindow(ENDLESS_VIEW_ROWS, ENDLESS_VIEW_COLS);
+
+    InputQueue inputQueue;
+    InitInputQueue(&inputQueue);
+
+    // World pixel at the top left corner, starting on the opening
+    double cameraX = (start.x + 0.5) * CELL_SIZE - ENDLESS_VIEW_COLS * CELL_SIZE / 2.0;
+    double cameraY = (start.y + 0.5) * CELL_SIZE - ENDLESS_VIEW_ROWS * CELL_SIZE / 2.0;
+    double nextFrame = GetTime();
+
+    // Chunks are allocated as play reaches them, on this thread or
+    // by prefetch jobs between their request and their delivery
+    long growth = WorldGrowth(&world, &prefetcher);
+    bool chunksOut = false;
+
+    CheckFrameAllocations(true);
+
+    while (!WindowShouldClose())
     {
-        for (int c = 0; c < COLS; c++)
+        nextFrame += 1.0 / MAX_FPS;
+        SampleInputUntil(&inputQueue, nextFrame);
+
+        if (GetTime() > nextFrame + 1.0 / MAX_FPS)
+            nextFrame = GetTime();
+
+        // Scroll velocity in tiles per second
+        double velocityX = (IsKeyDown(KEY_RIGHT) - IsKeyDown(KEY_LEFT)) * ENDLESS_SCROLL_SPEED;
+        double velocityY = (IsKeyDown(KEY_DOWN) - IsKeyDown(KEY_UP)) * ENDLESS_SCROLL_SPEED;
+
+        cameraX += velocityX * CELL_SIZE / MAX_FPS;
+        cameraY += velocityY * CELL_SIZE / MAX_FPS;
+
+        // Only clicks and F3 matter here; keys of the normal game are dropped
+        InputEvent event;
+
+        while (PopInputEvent(&inputQueue, &event))
         {
-            board[r][c].revealed = false;
-            board[r][c].hasMine = false;
-            board[r][c].flagged = false;
-            board[r][c].nearbyMines = 0;
+            if (event.action == INPUT_OVERLAY)
+                overlayShown = !overlayShown;
+
+            bool click = (event.action == INPUT_REVEAL || event.action == INPUT_FLAG);
+
+            if (!click || event.x < 0 || event.y < 0 || event.y >= ENDLESS_VIEW_ROWS * CELL_SIZE)
+                continue;
+
+            Move move;
+            move.type = (event.action == INPUT_FLAG) ? MOVE_FLAG : MOVE_REVEAL;
+            move.col = (int)floor((cameraX + event.x) / CELL_SIZE);
+            move.row = (int)floor((cameraY + event.y) / CELL_SIZE);
+
+            PlayMoveSound(ApplyWorldMove(&world, move));
         }
+
+        UpdateChunkPrefetcher(&prefetcher, &world, cameraX / CELL_SIZE, cameraY / CELL_SIZE,
+                              ENDLESS_VIEW_COLS + 1, ENDLESS_VIEW_ROWS + 1, velocityX, velocityY);
+
+        // Evicted chunks the prefetcher did not bring back in time
+        int32_t left = (int32_t)floor(cameraX / CELL_SIZE);
+        int32_t top = (int32_t)floor(cameraY / CELL_SIZE);
+
+        LoadWorldArea(&world, left, top, left + ENDLESS_VIEW_COLS, top + ENDLESS_VIEW_ROWS);
+        DrawWorld(&world, cameraX, cameraY);
+
+        long grown = WorldGrowth(&world, &prefetcher);
+
+        CheckFrameAllocations(grown != growth || chunksOut);
+        growth = grown;
+        chunksOut = prefetcher.requested > prefetcher.delivered + prefetcher.discarded;
     }
+
+    CloseGameWindow();
+    StopChunkPrefetcher(&prefetcher);
+    FreeWorld(&world);
+
+    if (stored)
+        CloseChunkStore(&store);
+
+    return 0;
 }
 
 /*
-Randomly distributes mines across the board.
+Plays a recording back in real time on screen.
 */
-void PlaceMines(Cell board[ROWS][COLS])
+int WatchReplay(const char *path)
 {
-    int placed = 0;
+    Replay replay;
+    Game game;
+
+    if (!LoadReplay(&replay, path))
+    {
+        fprintf(stderr, "Cannot read replay '%s'\n", path);
+        return 1;
+    }
 
-    while (placed < TOTAL_MINES)
+    if (!StartReplayGame(&replay, &game))
     {
-        int r = rand() % ROWS;
-        int c = rand() % COLS;
+        fprintf(stderr, "Replay '%s' has an invalid board\n", path);
+        FreeReplay(&replay);
+        return 1;
+    }
+
+    // Older recordings carry no snapshots to seek with
+    if (replay.keyframeCount == 0 && replay.moveCount > REPLAY_KEYFRAME_INTERVAL)
+        BuildReplayKeyframes(&replay);
+
+    OpenGameWindow(game.rows, game.cols);
+    SetTargetFPS(MAX_FPS);
+
+    double startTime = GetTime();
+    int nextMove = 0;
+    const char *result = NULL;
 
-        if (!board[r][c].hasMine)
+    while (!WindowShouldClose())
+    {
+        // Arrow keys jump through the recording
+        int seekTarget = -1;
+
+        if (IsKeyPressed(KEY_RIGHT))
+            seekTarget = nextMove + REPLAY_SEEK_STEP;
+
+        if (IsKeyPressed(KEY_LEFT))
+            seekTarget = (nextMove > REPLAY_SEEK_STEP) ? nextMove - REPLAY_SEEK_STEP : 0;
+
+        if (seekTarget >= 0)
+        {
+            if (seekTarget > replay.moveCount)
+                seekTarget = replay.moveCount;
+
+            SeekReplay(&replay, &game, seekTarget);
+            nextMove = seekTarget;
+            result = NULL;
+
+            // Continue the clock from the time of the last applied move
+            double seekTime = (nextMove > 0) ? replay.moves[nextMove - 1].timeMs / 1000.0 : 0.0;
+            startTime = GetTime() - seekTime;
+        }
+
+        uint32_t elapsedMs = (uint32_t)((GetTime() - startTime) * 1000.0);
+
+        // Apply every move whose time has come
+        while (nextMove < replay.moveCount && replay.moves[nextMove].timeMs <= elapsedMs)
+            PlayMove(&game, GetReplayMove(&replay, nextMove++));
+
+        // Verify the board once the log is exhausted
+        if (nextMove == replay.moveCount && result == NULL)
         {
-            board[r][c].hasMine = true;
-            placed++;
+            result = (HashGameState(&game) == replay.finalHash)
+                         ? "Replay verified"
+                         : "Replay MISMATCH";
+
+            printf("%s\n", result);
         }
+
+        DrawGame(&game, (result != NULL)
+                            ? result
+                            : TextFormat("Replay: move %d / %d (Left/Right: seek)", nextMove, replay.moveCount));
     }
+
+    CloseGameWindow();
+    FreeGame(&game);
+    FreeReplay(&replay);
+
+    return 0;
 }
 
 /*
-Calculates the number displayed on each safe tile.
+Re-runs a recording without a window as fast as possible.
+Exit code is 0 if the final board matches the recording.
 */
-void CountNearbyMines(Cell board[ROWS][COLS])
+int VerifyReplay(const char *path)
 {
-    for (int r = 0; r < ROWS; r++)
+    Replay replay;
+    ReplayCheck check;
+
+    if (!LoadReplay(&replay, path))
     {
-        for (int c = 0; c < COLS; c++)
-        {
-            if (board[r][c].hasMine)
-                continue;
+        fprintf(stderr, "Cannot read replay '%s'\n", path);
+        return 1;
+    }
 
-            int count = 0;
+    if (!CheckReplay(&replay, &check))
+    {
+        fprintf(stderr, "Replay '%s' has an invalid board\n", path);
+        FreeReplay(&replay);
+        return 1;
+    }
 
-            for (int dr = -1; dr <= 1; dr++)
-            {
-                for (int dc = -1; dc <= 1; dc++)
-                {
-                    int nr = r + dr;
-                    int nc = c + dc;
-
-                    if (nr >= 0 && nr < ROWS && nc >= 0 && nc < COLS)
-                    {
-                        if (board[nr][nc].hasMine)
-                            count++;
-                    }
-                }
-            }
+    printf("Board:     %d x %d, %d mines, seed %016llx%s\n",
+           replay.rows, replay.cols, replay.totalMines,
+           (unsigned long long)replay.seed, (replay.deal == DEAL_IN_BANDS) ? ", dealt in bands" : "");
+    printf("Moves:     %d in %.3f ms (%.0f moves/s)\n",
+           check.movesApplied, check.seconds * 1000.0,
+           (check.seconds > 0.0) ? check.movesApplied / check.seconds : 0.0);
+    printf("Outcome:   %s\n",
+           (check.status == GAME_WON) ? "won" : (check.status == GAME_LOST) ? "lost" : "unfinished");
+    printf("Hash:      %016llx (recorded %016llx) %s\n",
+           (unsigned long long)check.finalHash,
+           (unsigned long long)replay.finalHash,
+           check.hashMatches ? "OK" : "MISMATCH");
+
+    FreeReplay(&replay);
+
+    return check.hashMatches ? 0 : 2;
+}
+
+/*
+Finds count boards that pass the request's filters, one after the
+other along its candidate sequence, and prints their seeds and
+metrics followed by the search throughput.
+*/
+int GenerateBoards(long count, GeneratorRequest *request, int threadCount)
+{
+    long attempts = 0;
+    long rejectedEarly = 0;
+    long solverRuns = 0;
+    long found = 0;
+    double seconds = 0.0;
+
+    printf("Boards of %d x %d with %d mines, 3BV %d-%d%s, candidates from %016llx\n",
+           request->rows, request->cols, request->totalMines, request->minBbbv, request->maxBbbv,
+           request->noGuess ? ", no guessing" : "", (unsigned long long)request->baseSeed);
+    printf("%-18s %6s %6s %12s\n", "seed", "3BV", "ZiNi", "candidate");
+
+    while (found < count)
+    {
+        GeneratorResult result;
+        bool ok = GenerateSeed(request, threadCount, &result);
 
-            board[r][c].nearbyMines = count;
+        attempts += result.attempts;
+        rejectedEarly += result.rejectedEarly;
+        solverRuns += result.solverRuns;
+        seconds += result.elapsedSeconds;
+
+        if (!ok)
+        {
+            fprintf(stderr, "No board found in %ld candidates\n", request->maxAttempts);
+            break;
         }
+
+        printf("%016llx   %6d %6d %12ld\n", (unsigned long long)result.seed,
+               result.bbbv, result.zini, result.candidate);
+
+        request->firstCandidate = result.candidate + 1;
+        found++;
     }
+
+    printf("%ld boards from %ld candidates in %.3f s: %.0f candidates/s, %.2f boards/s\n",
+           found, attempts, seconds, seconds > 0.0 ? attempts / seconds : 0.0,
+           seconds > 0.0 ? found / seconds : 0.0);
+    printf("%.1f%% stopped early by the 3BV band, %ld solver runs\n",
+           attempts ? 100.0 * rejectedEarly / attempts : 0.0, solverRuns);
+
+    return (found == count) ? 0 : 2;
 }
 
 // =============================================================
-//                     GAME MECHANICS
+//                    WINDOW AND RESOURCES
 // =============================================================
 
 /*
-Reveals connected empty tiles automatically.
+Creates a window sized for rows x cols tiles and loads sounds and images.
 */
-void RevealEmptyCells(Cell board[ROWS][COLS], int row, int col)
+void OpenGameWindow(int rows, int cols)
 {
-    for (int dr = -1; dr <= 1; dr++)
-    {
-        for (int dc = -1; dc <= 1; dc++)
-        {
-            int nr = row + dr;
-            int nc = col + dc;
+    // Create the game window
+    InitWindow(cols * CELL_SIZE, rows * CELL_SIZE + 50,
+               "Minesweeper - Raylib Styled");
 
-            if ((nr >= 0) && (nr < ROWS) && (nc >= 0) && (nc < COLS))
-            {
-                if (!board[nr][nc].revealed && !board[nr][nc].hasMine)
-                {
-                    board[nr][nc].revealed = true;
+    // Initialize audio system
+    InitAudioDevice();
 
-                    if (board[nr][nc].nearbyMines == 0)
-                        RevealEmptyCells(board, nr, nc);
-                }
-            }
-        }
-    }
+    // Load game sounds
+    numberSound = LoadSound("number.mp3");
+    boomSound = LoadSound("boom.mp3");
+    flagSound = LoadSound("flag.mp3");
+    gameOverSound = LoadSound("over.mp3");
+    winSound = LoadSound("win.mp3");
+
+    // Load mine texture
+    boomTexture = LoadTexture("boomm.png");
 }
 
 /*
-Shows all mines after losing.
+Releases sounds and images and closes the window.
 */
-void RevealAllMines(Cell board[ROWS][COLS])
+void CloseGameWindow(void)
 {
-    for (int r = 0; r < ROWS; r++)
-    {
-        for (int c = 0; c < COLS; c++)
-        {
-            if (board[r][c].hasMine)
-                board[r][c].revealed = true;
-        }
-    }
+    UnloadSound(numberSound);
+    UnloadSound(boomSound);
+    UnloadSound(flagSound);
+    UnloadSound(gameOverSound);
+    UnloadSound(winSound);
+
+    UnloadTexture(boomTexture);
+
+    CloseAudioDevice();
+    CloseWindow();
+}
+
+// =============================================================
+//                          MEMORY
+// =============================================================
+
+/*
+Sets aside what a game needs while it is played: room for
+RESERVED_MOVES more moves in the journal and the recording, the
+per-tile arrays of the solver and the mine chances, and room in the
+game's arena for flood fills and hints. Play that stays within that
+allocates nothing.
+*/
+void ReserveGameMemory(Game *game, History *history, Replay *recording, Solver *solver, ProbabilityMap *chances)
+{
+    int cellCount = game->rows * game->cols;
+    bool reserved = ReserveHistory(history, game, RESERVED_MOVES, RESERVED_MOVES + 2 * cellCount)
+                    && ReserveReplay(recording, recording->moveCount + RESERVED_MOVES)
+                    && ReserveSolver(solver, cellCount)
+                    && ReserveProbabilityMap(chances, cellCount)
+                    && ReserveArena(game->arena, RESERVED_SCRATCH);
+
+    if (!reserved)
+        fprintf(stderr, "Could not reserve memory for the game; it will allocate while played\n");
+}
+
+/*
+Debug builds: asserts that the frame since the previous call made no
+heap allocation of its own (see HeapAllocationCount()). Frames that
+read or write files or grow memory by design are let off. The first
+call only starts counting.
+*/
+void CheckFrameAllocations(bool letOff)
+{
+#ifndef NDEBUG
+    static long counted = -1;
+    long count = HeapAllocationCount();
+
+    assert(counted < 0 || letOff || count == counted);
+    counted = count;
+#else
+    (void)letOff;
+#endif
+}
+
+/*
+Sum of the endless world's counters that move whenever it allocates
+on the frame path: chunks made, read back, evicted or requested
+from the prefetcher, and the size of its flood stack. A frame that
+leaves it as it was allocated nothing for the world.
+*/
+long WorldGrowth(const World *world, const ChunkPrefetcher *prefetcher)
+{
+    return world->chunksCreated + world->chunksLoaded + world->chunksEvicted + world->worklistCapacity
+           + prefetcher->requested;
 }
 
 // =============================================================
@@ -279,169 +841,423 @@ void RevealAllMines(Cell board[ROWS][COLS])
 // =============================================================
 
 /*
-Handles player clicks and updates game state.
+Applies a move and plays the matching sound effects.
 */
-void HandleMouseInput(Cell board[ROWS][COLS], bool *gameOver)
+MoveResult PlayMove(Game *game, Move move)
 {
-    Vector2 mouse = GetMousePosition();
+    MoveResult result = ApplyMove(game, move);
 
-    int col = (int)(mouse.x / CELL_SIZE);
-    int row = (int)(mouse.y / CELL_SIZE);
+    PlayMoveSound(result);
 
-    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON))
+    if (game->status == GAME_WON && !playedWin)
     {
-        if ((row >= 0 && row < ROWS) && (col >= 0 && col < COLS))
-        {
-            if (!board[row][col].flagged && !board[row][col].revealed)
-            {
-                board[row][col].revealed = true;
-
-                if (board[row][col].hasMine)
-                {
-                    if (!playedBoom)
-                    {
-                        PlaySound(boomSound);
-                        playedBoom = true;
-                    }
-
-                    *gameOver = true;
-                    RevealAllMines(board);
-
-                    if (!playedGameOver)
-                    {
-                        PlaySound(gameOverSound);
-                        playedGameOver = true;
-                    }
-                }
-                else
-                {
-                    PlaySound(numberSound);
-
-                    if (board[row][col].nearbyMines == 0)
-                        RevealEmptyCells(board, row, col);
-                }
-            }
-        }
+        PlaySound(winSound);
+        playedWin = true;
     }
 
-    if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON))
+    return result;
+}
+
+/*
+Plays the sound effects of a move's result.
+*/
+void PlayMoveSound(MoveResult result)
+{
+    if (result == MOVE_OPENED)
+        PlaySound(numberSound);
+
+    else if (result == MOVE_FLAGGED || result == MOVE_UNFLAGGED)
+        PlaySound(flagSound);
+
+    else if (result == MOVE_EXPLODED)
     {
-        if ((row >= 0 && row < ROWS) && (col >= 0 && col < COLS))
+        if (!playedBoom)
         {
-            if (!board[row][col].revealed)
-            {
-                board[row][col].flagged = !board[row][col].flagged;
-                PlaySound(flagSound);
-            }
+            PlaySound(boomSound);
+            playedBoom = true;
+        }
+
+        if (!playedGameOver)
+        {
+            PlaySound(gameOverSound);
+            playedGameOver = true;
         }
     }
 }
 
 /*
-Checks whether all safe tiles are revealed.
+Applies one queued click and records it if it changed the board.
+*/
+void HandleMouseInput(Game *game, InputEvent event, Replay *recording)
+{
+    if (event.x < 0 || event.y < 0)
+        return;
+
+    Move move;
+    move.type = (event.action == INPUT_FLAG) ? MOVE_FLAG : MOVE_REVEAL;
+    move.col = (int)(event.x / CELL_SIZE);
+    move.row = (int)(event.y / CELL_SIZE);
+
+    if (PlayMove(game, move) != MOVE_IGNORED)
+        RecordMove(recording, game, move, (uint32_t)((event.time - gameStartTime) * 1000.0));
+}
+
+/*
+Takes back the last move and drops it from the recording.
 */
-bool CheckWin(Cell board[ROWS][COLS])
+void UndoLastMove(Game *game, Replay *recording)
 {
-    int revealedCount = 0;
+    if (!UndoMove(game))
+        return;
 
-    for (int r = 0; r < ROWS; r++)
+    UnrecordMove(recording);
+
+    // Let the end-of-game sounds play again if the game is lost again
+    if (game->status == GAME_PLAYING)
     {
-        for (int c = 0; c < COLS; c++)
-        {
-            if (board[r][c].revealed && !board[r][c].hasMine)
-                revealedCount++;
-        }
+        playedBoom = false;
+        playedGameOver = false;
+        playedWin = false;
     }
+}
 
-    return (revealedCount == ROWS * COLS - TOTAL_MINES);
+/*
+Applies the last undone move again and restores it in the recording.
+*/
+void RedoLastMove(Game *game, Replay *recording)
+{
+    if (RedoMove(game))
+        RestoreRecordedMove(recording, game);
+}
+
+/*
+Saves the game in progress together with its recording.
+*/
+void SaveCurrentGame(const Game *game, Replay *recording)
+{
+    uint32_t elapsedMs = (uint32_t)((GetTime() - gameStartTime) * 1000.0);
+
+    FinishReplay(recording, game);
+
+    if (!SaveGameState(game, elapsedMs, SAVE_FILE) || !SaveReplay(recording, SAVE_REPLAY_FILE))
+        fprintf(stderr, "Could not save the game to '%s'\n", SAVE_FILE);
+}
+
+/*
+Replaces the current game with the one saved by SaveCurrentGame().
+The current game is kept if the save is missing or damaged.
+*/
+void LoadSavedGame(Game *game, History *history, Replay *recording)
+{
+    Game loaded;
+    uint32_t elapsedMs = 0;
+
+    if (!LoadGameState(&loaded, &elapsedMs, SAVE_FILE))
+    {
+        fprintf(stderr, "Could not load a saved game from '%s'\n", SAVE_FILE);
+        return;
+    }
+
+    bool resized = (loaded.rows != game->rows) || (loaded.cols != game->cols);
+
+    FreeGame(game);
+    *game = loaded;
+
+    // Moves made before the save cannot be undone; the journal
+    // was in the arena of the game just freed
+    FreeHistory(history);
+    game->history = history;
+
+    // Continue the recording that belongs to the saved game
+    Replay savedRecording;
+    FreeReplay(recording);
+
+    if (LoadReplay(&savedRecording, SAVE_REPLAY_FILE) && savedRecording.seed == game->seed
+        && savedRecording.deal == game->deal
+        && savedRecording.rows == game->rows && savedRecording.cols == game->cols)
+        *recording = savedRecording;
+    else
+    {
+        FreeReplay(&savedRecording);
+        BeginReplay(recording, game);
+        fprintf(stderr, "Saved game has no matching recording; its replay will not verify\n");
+    }
+
+    // Resume the clock where it stopped
+    gameStartTime = GetTime() - elapsedMs / 1000.0;
+
+    playedBoom = (game->status == GAME_LOST);
+    playedGameOver = (game->status == GAME_LOST);
+    playedWin = (game->status == GAME_WON);
+
+    if (resized)
+        SetWindowSize(game->cols * CELL_SIZE, game->rows * CELL_SIZE + 50);
+}
+
+/*
+Writes the recording of the current game next to the executable,
+named after its seed.
+*/
+void SaveGameReplay(Replay *recording, const Game *game)
+{
+    char path[64];
+
+    FinishReplay(recording, game);
+    snprintf(path, sizeof(path), "replay_%016llx.msr", (unsigned long long)game->seed);
+
+    if (!SaveReplay(recording, path))
+        fprintf(stderr, "Could not save replay '%s'\n", path);
 }
 
 // =============================================================
 //                        RENDERING
 // =============================================================
 
+/*
+Highlights a move the solver proves correct, or else the tile
+least likely to hold a mine.
+*/
+void ShowHint(Solver *solver, ProbabilityMap *chances, Game *game)
+{
+    hintShown = FindHint(solver, game, &hintMove);
+
+    if (!hintShown)
+    {
+        hintShown = ComputeMineProbabilities(chances, game, HINT_PROBABILITY_BUDGET, 0)
+                    && FindSafestGuess(chances, game, &hintMove);
+
+        if (hintShown)
+        {
+            float chance = chances->mineChance[hintMove.row * game->cols + hintMove.col];
+
+            snprintf(hintText, sizeof(hintText), "Best guess: %.0f%% mine chance%s",
+                     chance * 100.0f, chances->exact ? "" : " (estimate)");
+            hintMessage = hintText;
+        }
+        else
+            hintMessage = "No certain move: a guess is needed";
+    }
+    else if (hintMove.type == MOVE_FLAG)
+        hintMessage = "Hint: the marked tile is a mine";
+    else
+        hintMessage = "Hint: the marked tile is safe";
+}
+
 /*
 Draws the full game interface on the screen.
+The message replaces the help line, or follows the result once the game ends.
 */
-void DrawGame(Cell board[ROWS][COLS], bool gameOver, bool win)
+void DrawGame(const Game *game, const char *message)
 {
     BeginDrawing();
 
     ClearBackground((Color){48, 99, 47, 255});
 
-    for (int r = 0; r < ROWS; r++)
+    for (int r = 0; r < game->rows; r++)
     {
-        for (int c = 0; c < COLS; c++)
+        for (int c = 0; c < game->cols; c++)
         {
             Rectangle cell = {c * CELL_SIZE, r * CELL_SIZE,
                               CELL_SIZE, CELL_SIZE};
 
-            Color hiddenColor = ((r + c) % 2 == 0)
-                                    ? (Color){190, 224, 145, 255}
-                                    : (Color){170, 214, 135, 255};
+            DrawTile(cell, (r + c) % 2 == 0, game->display[r * game->cols + c]);
 
-            Color revealedColor = ((r + c) % 2 == 0)
-                                      ? (Color){240, 210, 170, 255}
-                                      : (Color){225, 195, 150, 255};
+            if (hintShown && hintMove.row == r && hintMove.col == c)
+                DrawRectangleLinesEx(cell, 4, (hintMove.type == MOVE_FLAG) ? RED : BLUE);
+        }
+    }
 
-            if (board[r][c].revealed)
-                DrawRectangleRec(cell, revealedColor);
-            else
-            {
-                DrawRectangleRec(cell, hiddenColor);
-                DrawRectangleLinesEx(cell, 1, (Color){110, 110, 110, 255});
-            }
+    int statusY = game->rows * CELL_SIZE;
 
-            if (board[r][c].revealed)
-            {
-                if (board[r][c].hasMine)
-                {
-                    Rectangle src = {0, 0,
-                                     (float)boomTexture.width,
-                                     (float)boomTexture.height};
-
-                    Rectangle dest = {cell.x, cell.y,
-                                      CELL_SIZE, CELL_SIZE};
-
-                    DrawTexturePro(boomTexture, src, dest,
-                                   (Vector2){0, 0}, 0, WHITE);
-                }
-                else if (board[r][c].nearbyMines > 0)
-                {
-                    DrawText(TextFormat("%d", board[r][c].nearbyMines),
-                             cell.x + CELL_SIZE / 2 - 8,
-                             cell.y + CELL_SIZE / 2 - 12,
-                             25, BLUE);
-                }
-            }
-            else if (board[r][c].flagged)
-            {
-                DrawTriangle(
-                    (Vector2){cell.x + CELL_SIZE / 2 - 8,
-                              cell.y + CELL_SIZE / 2 + 8},
+    if (game->status == GAME_LOST)
+        DrawText("GAME OVER!", 10, statusY + 10, 30, RED);
+
+    else if (game->status == GAME_WON)
+        DrawText("YOU WIN!", 10, statusY + 10, 30, GREEN);
 
-                    (Vector2){cell.x + CELL_SIZE / 2 - 8,
-                              cell.y + CELL_SIZE / 2 - 12},
+    else
+        DrawText((message != NULL) ? message : "Click: Reveal/Flag | Z/Y Undo/Redo | S/L Save/Load | H Hint",
+                 10, statusY + 17, 16, RAYWHITE);
 
-                    (Vector2){cell.x + CELL_SIZE / 2 + 8,
-                              cell.y + CELL_SIZE / 2 - 2},
+    if (game->status != GAME_PLAYING && message != NULL)
+        DrawText(message, 220, statusY + 15, 20, RAYWHITE);
 
-                    RED);
-            }
+    if (overlayShown)
+        DrawPerformanceOverlay();
+
+    EndDrawing();
+}
+
+/*
+Draws the part of an endless world under the camera (the world
+pixel at the top left corner of the window) and its status line.
+*/
+void DrawWorld(const World *world, double cameraX, double cameraY)
+{
+    BeginDrawing();
+
+    ClearBackground((Color){48, 99, 47, 255});
+
+    int32_t firstX = (int32_t)floor(cameraX / CELL_SIZE);
+    int32_t firstY = (int32_t)floor(cameraY / CELL_SIZE);
+
+    // One extra row and column for tiles cut by the window edges
+    for (int r = 0; r <= ENDLESS_VIEW_ROWS; r++)
+    {
+        for (int c = 0; c <= ENDLESS_VIEW_COLS; c++)
+        {
+            int32_t x = firstX + c;
+            int32_t y = firstY + r;
+            uint8_t tile = PeekWorldTile(world, x, y);
+
+            Rectangle cell = {(float)(x * (double)CELL_SIZE - cameraX), (float)(y * (double)CELL_SIZE - cameraY),
+                              CELL_SIZE, CELL_SIZE};
+
+            uint8_t display = DISPLAY_HIDDEN;
+
+            if (tile & WORLD_TILE_REVEALED)
+                display = (tile & WORLD_TILE_MINE) ? DISPLAY_EXPLODED : (tile & WORLD_TILE_COUNT);
+            else if (tile & WORLD_TILE_FLAGGED)
+                display = DISPLAY_FLAGGED;
+
+            DrawTile(cell, ((x + y) & 1) == 0, display);
         }
     }
 
-    if (gameOver)
-        DrawText("GAME OVER!", 10, ROWS * CELL_SIZE + 10, 30, RED);
+    int statusY = ENDLESS_VIEW_ROWS * CELL_SIZE;
 
-    else if (win)
-        DrawText("YOU WIN!", 10, ROWS * CELL_SIZE + 10, 30, GREEN);
+    DrawRectangle(0, statusY, ENDLESS_VIEW_COLS * CELL_SIZE, 50, (Color){48, 99, 47, 255});
 
+    if (world->status == GAME_LOST)
+        DrawText("GAME OVER!", 10, statusY + 10, 30, RED);
     else
-        DrawText("Left-click: Reveal | Right-click: Flag",
-                 10, ROWS * CELL_SIZE + 15, 20, RAYWHITE);
+        DrawText("Click: Reveal/Flag | Arrows: Scroll", 10, statusY + 17, 16, RAYWHITE);
+
+    long lookups = world->chunkHits + world->chunkMisses;
+    long written = (world->store != NULL) ? (long)(world->store->bytesWritten / 1024) : 0;
+
+    DrawText(TextFormat("Opened %ld | %d chunks, %d KB | %.1f%% hits, %ld KB out",
+                        world->revealedSafe, world->chunkCount, (int)(WorldMemoryBytes(world) / 1024),
+                        lookups ? 100.0 * world->chunkHits / lookups : 100.0, written),
+             ENDLESS_VIEW_COLS * CELL_SIZE - 480, statusY + 17, 16, RAYWHITE);
+
+    if (overlayShown)
+        DrawPerformanceOverlay();
 
     EndDrawing();
 }
 
+/*
+Draws frame time and the shared job system's counters over the top
+of the window: workers, jobs queued now and at most, and the steals
+and worker idle time of the last OVERLAY_INTERVAL.
+*/
+void DrawPerformanceOverlay(void)
+{
+    static JobStats last;
+    static double lastTime = -1.0;
+    static double stealRate = 0.0;
+    static double idleShare = 0.0;
+
+    JobStats stats;
+    ReadJobStats(NULL, &stats);
+
+    double now = GetTime();
+
+    if (lastTime < 0.0)
+    {
+        last = stats;
+        lastTime = now;
+    }
+    else if (now - lastTime >= OVERLAY_INTERVAL)
+    {
+        double seconds = now - lastTime;
+
+        stealRate = (stats.steals - last.steals) / seconds;
+        idleShare = (stats.workerCount > 0)
+                        ? (stats.idleSeconds - last.idleSeconds) / (seconds * stats.workerCount)
+                        : 0.0;
+        last = stats;
+        lastTime = now;
+    }
+
+    DrawRectangle(0, 0, 560, 48, (Color){0, 0, 0, 170});
+    DrawText(TextFormat("Frame %.1f ms | %d FPS", 1000.0f * GetFrameTime(), GetFPS()), 8, 6, 16, RAYWHITE);
+    DrawText(TextFormat("Jobs: %d workers | %d queued (peak %d) | %.0f steals/s | %.0f%% idle | %ld run",
+                        stats.workerCount, stats.queued, stats.peakQueued, stealRate, 100.0 * idleShare,
+                        stats.executed),
+             8, 26, 16, RAYWHITE);
+}
+
+/*
+Draws one tile from its DISPLAY_* state: its checker colour, and a
+mine, number or flag.
+*/
+void DrawTile(Rectangle cell, bool light, uint8_t display)
+{
+    bool revealed = display <= 8 || display == DISPLAY_MINE || display == DISPLAY_EXPLODED;
+
+    Color hiddenColor = light
+                            ? (Color){190, 224, 145, 255}
+                            : (Color){170, 214, 135, 255};
 
+    Color revealedColor = light
+                              ? (Color){240, 210, 170, 255}
+                              : (Color){225, 195, 150, 255};
+
+    if (display == DISPLAY_EXPLODED)
+        DrawRectangleRec(cell, RED);
+    else if (revealed)
+        DrawRectangleRec(cell, revealedColor);
+    else
+    {
+        DrawRectangleRec(cell, hiddenColor);
+        DrawRectangleLinesEx(cell, 1, (Color){110, 110, 110, 255});
+    }
+
+    if (revealed)
+    {
+        if (display == DISPLAY_MINE || display == DISPLAY_EXPLODED)
+        {
+            Rectangle src = {0, 0,
+                             (float)boomTexture.width,
+                             (float)boomTexture.height};
+
+            Rectangle dest = {cell.x, cell.y,
+                              CELL_SIZE, CELL_SIZE};
+
+            DrawTexturePro(boomTexture, src, dest,
+                           (Vector2){0, 0}, 0, WHITE);
+        }
+        else if (display > 0)
+        {
+            DrawText(TextFormat("%d", display),
+                     cell.x + CELL_SIZE / 2 - 8,
+                     cell.y + CELL_SIZE / 2 - 12,
+                     25, BLUE);
+        }
+    }
+    else if (display == DISPLAY_FLAGGED || display == DISPLAY_WRONG_FLAG)
+    {
+        DrawTriangle(
+            (Vector2){cell.x + CELL_SIZE / 2 - 8,
+                      cell.y + CELL_SIZE / 2 + 8},
+
+            (Vector2){cell.x + CELL_SIZE / 2 - 8,
+                      cell.y + CELL_SIZE / 2 - 12},
+
+            (Vector2){cell.x + CELL_SIZE / 2 + 8,
+                      cell.y + CELL_SIZE / 2 - 2},
+
+            RED);
+
+        // Crossed out once a lost game shows the flag was wrong
+        if (display == DISPLAY_WRONG_FLAG)
+        {
+            DrawLineEx((Vector2){cell.x + 8, cell.y + 8},
+                       (Vector2){cell.x + CELL_SIZE - 8, cell.y + CELL_SIZE - 8}, 3, BLACK);
+            DrawLineEx((Vector2){cell.x + CELL_SIZE - 8, cell.y + 8},
+                       (Vector2){cell.x + 8, cell.y + CELL_SIZE - 8}, 3, BLACK);
+        }
+    }
+}
@@ -0,0 +1,460 @@
+
+// =============================================================
+// Board metrics
+//
+// Empty tiles and isolated numbers (numbers with no empty
+// neighbour) are labelled in one row-major union-find pass:
+// each tile is joined with its already visited neighbours of
+// the same kind, and every join that merges two trees removes
+// one component. Openings and islands are what is left, and 3BV
+// is the openings plus the isolated numbers.
+//
+// ZiNi replays the board once more in row-major order, chording
+// every number whose chord opens more 3BV units than the clicks
+// it costs (opening it, flagging its mines, the chord itself).
+// Units still closed afterwards cost one click each. Full ZiNi
+// picks the best chord over the whole board each time; the
+// one-way sweep is a close upper bound that stays linear.
+//
+// When only boards inside a 3BV band are wanted, the labelling
+// pass stops early: units found so far can only merge, and every
+// safe tile not scanned yet adds at most one, which bounds the
+// final 3BV from both sides after each row.
+// =============================================================
+
+#include "metrics.h"
+#include <limits.h>
+#include <stdlib.h>
+
+// ZiNi replay flags
+#define TILE_OPENED 1       // Tile opened by a click or a chord
+#define TILE_FLAGGED 2      // Mine flagged before a chord
+#define UNIT_OPENED 4       // On a root: the whole opening is open
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Prepares empty metrics that allocate on first use.
+*/
+void InitBoardMetrics(BoardMetrics *metrics)
+{
+    metrics->bbbv = 0;
+    metrics->openings = 0;
+    metrics->isolatedNumbers = 0;
+    metrics->islands = 0;
+    metrics->zini = 0;
+
+    metrics->cellCapacity = 0;
+    metrics->parent = NULL;
+    metrics->state = NULL;
+}
+
+/*
+Releases the scratch space.
+*/
+void FreeBoardMetrics(BoardMetrics *metrics)
+{
+    free(metrics->parent);
+    free(metrics->state);
+
+    InitBoardMetrics(metrics);
+}
+
+/*
+Grows the scratch space to hold cellCount tiles.
+Returns false if memory runs out.
+*/
+bool ReserveBoardMetrics(BoardMetrics *metrics, int cellCount)
+{
+    if (cellCount <= metrics->cellCapacity)
+        return true;
+
+    int *parent = realloc(metrics->parent, (size_t)cellCount * sizeof(int));
+
+    if (parent == NULL)
+        return false;
+
+    metrics->parent = parent;
+
+    uint8_t *state = realloc(metrics->state, (size_t)cellCount);
+
+    if (state == NULL)
+        return false;
+
+    metrics->state = state;
+    metrics->cellCapacity = cellCount;
+
+    return true;
+}
+
+// =============================================================
+//                          LABELLING
+// =============================================================
+
+/*
+Tells if a safe tile shows no number.
+*/
+static inline bool IsEmptyTile(const Cell *cell)
+{
+    return !cell->hasMine && cell->nearbyMines == 0;
+}
+
+/*
+Finds the root of a tile, halving the path on the way.
+*/
+static int FindRoot(int *parent, int index)
+{
+    while (parent[index] != index)
+    {
+        parent[index] = parent[parent[index]];
+        index = parent[index];
+    }
+
+    return index;
+}
+
+/*
+Joins the trees of two tiles. Returns true if they were separate.
+*/
+static bool JoinTiles(int *parent, int a, int b)
+{
+    a = FindRoot(parent, a);
+    b = FindRoot(parent, b);
+
+    if (a == b)
+        return false;
+
+    // The earlier tile stays the root, which keeps trees shallow
+    // for a row-major scan
+    if (a < b)
+        parent[b] = a;
+    else
+        parent[a] = b;
+
+    return true;
+}
+
+/*
+Checks whether a number has an empty neighbour.
+*/
+static bool TouchesEmptyTile(const Game *game, int row, int col)
+{
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (InsideBoard(game, row + dr, col + dc) && IsEmptyTile(GameCell(game, row + dr, col + dc)))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+Labels openings and isolated numbers and counts both kinds of
+component. Afterwards every labelled tile points at its root and
+tiles outside both kinds have parent -1.
+Returns false as soon as the 3BV is certain to fall outside
+minBbbv..maxBbbv, leaving the labels unfinished and bbbv at -1.
+*/
+static bool LabelComponents(BoardMetrics *metrics, const Game *game, int minBbbv, int maxBbbv)
+{
+    // Neighbours already visited in a row-major scan
+    static const int earlier[4][2] = {{0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+
+    int *parent = metrics->parent;
+
+    int minesLeft = game->totalMines;
+    bool banded = (minBbbv > 0 || maxBbbv < INT_MAX);
+
+    metrics->openings = 0;
+    metrics->isolatedNumbers = 0;
+    metrics->islands = 0;
+
+    for (int r = 0; r < game->rows; r++)
+    {
+        for (int c = 0; c < game->cols; c++)
+        {
+            int index = r * game->cols + c;
+            const Cell *cell = &game->cells[index];
+            bool empty = IsEmptyTile(cell);
+
+            minesLeft -= cell->hasMine;
+
+            if (cell->hasMine || (!empty && TouchesEmptyTile(game, r, c)))
+            {
+                parent[index] = -1;
+                continue;
+            }
+
+            parent[index] = index;
+
+            if (empty)
+                metrics->openings++;
+            else
+            {
+                metrics->isolatedNumbers++;
+                metrics->islands++;
+            }
+
+            for (int k = 0; k < 4; k++)
+            {
+                int nr = r + earlier[k][0];
+                int nc = c + earlier[k][1];
+
+                if (!InsideBoard(game, nr, nc))
+                    continue;
+
+                int other = nr * game->cols + nc;
+
+                if (parent[other] < 0 || IsEmptyTile(&game->cells[other]) != empty)
+                    continue;
+
+                if (JoinTiles(parent, index, other))
+                {
+                    if (empty)
+                        metrics->openings--;
+                    else
+                        metrics->islands--;
+                }
+            }
+        }
+
+        // Units found so far can only merge; each safe tile left adds at most one
+        int safeLeft = (game->rows - r - 1) * game->cols - minesLeft;
+
+        if (banded && (metrics->isolatedNumbers > maxBbbv
+                       || metrics->openings + metrics->isolatedNumbers + safeLeft < minBbbv))
+        {
+            metrics->bbbv = -1;
+            return false;
+        }
+    }
+
+    metrics->bbbv = metrics->openings + metrics->isolatedNumbers;
+
+    // Point every tile straight at its root for the ZiNi replay
+    for (int i = 0; i < game->rows * game->cols; i++)
+    {
+        if (parent[i] >= 0)
+            parent[i] = parent[parent[i]];
+    }
+
+    return metrics->bbbv >= minBbbv && metrics->bbbv <= maxBbbv;
+}
+
+// =============================================================
+//                            ZINI
+// =============================================================
+
+/*
+Tells if a number is open in the ZiNi replay.
+*/
+static bool IsReplayOpen(BoardMetrics *metrics, const Game *game, int row, int col)
+{
+    int index = row * game->cols + col;
+
+    // Isolated numbers open only when clicked or chorded
+    if ((metrics->state[index] & TILE_OPENED) || metrics->parent[index] >= 0)
+        return (metrics->state[index] & TILE_OPENED) != 0;
+
+    // Other numbers also open with a neighbouring opening
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (!InsideBoard(game, row + dr, col + dc))
+                continue;
+
+            int other = (row + dr) * game->cols + (col + dc);
+
+            if (IsEmptyTile(&game->cells[other])
+                && (metrics->state[metrics->parent[other]] & UNIT_OPENED))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+Opens a tile in the ZiNi replay. Returns the 3BV units this
+opened (1 for a closed isolated number or a closed opening).
+*/
+static int OpenReplayTile(BoardMetrics *metrics, const Game *game, int index)
+{
+    if (IsEmptyTile(&game->cells[index]))
+    {
+        int root = metrics->parent[index];
+
+        if (metrics->state[root] & UNIT_OPENED)
+            return 0;
+
+        metrics->state[root] |= UNIT_OPENED;
+        return 1;
+    }
+
+    bool unit = metrics->parent[index] >= 0 && !(metrics->state[index] & TILE_OPENED);
+    metrics->state[index] |= TILE_OPENED;
+
+    return unit;
+}
+
+/*
+Units a chord on a number would open, and the flags it needs.
+Each new opening is counted once even if several neighbours
+belong to it.
+*/
+static int CountChordGain(BoardMetrics *metrics, const Game *game, int row, int col, int *flags)
+{
+    int roots[8];
+    int rootCount = 0;
+    int gain = 0;
+
+    *flags = 0;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            int r = row + dr;
+            int c = col + dc;
+
+            if ((dr == 0 && dc == 0) || !InsideBoard(game, r, c))
+                continue;
+
+            int index = r * game->cols + c;
+            const Cell *cell = &game->cells[index];
+
+            if (cell->hasMine)
+            {
+                *flags += !(metrics->state[index] & TILE_FLAGGED);
+                continue;
+            }
+
+            if (!IsEmptyTile(cell))
+            {
+                gain += metrics->parent[index] >= 0 && !(metrics->state[index] & TILE_OPENED);
+                continue;
+            }
+
+            int root = metrics->parent[index];
+            bool seen = (metrics->state[root] & UNIT_OPENED) != 0;
+
+            for (int k = 0; k < rootCount && !seen; k++)
+                seen = (roots[k] == root);
+
+            if (!seen)
+            {
+                roots[rootCount++] = root;
+                gain++;
+            }
+        }
+    }
+
+    return gain;
+}
+
+/*
+Replays the board with the one-way greedy sweep and returns the
+clicks it used, flags included.
+*/
+static int EstimateZini(BoardMetrics *metrics, const Game *game)
+{
+    int cellCount = game->rows * game->cols;
+    int clicks = 0;
+    int unitsLeft = metrics->bbbv;
+
+    for (int i = 0; i < cellCount; i++)
+        metrics->state[i] = 0;
+
+    for (int r = 0; r < game->rows; r++)
+    {
+        for (int c = 0; c < game->cols; c++)
+        {
+            int index = r * game->cols + c;
+            const Cell *cell = &game->cells[index];
+
+            if (cell->hasMine || cell->nearbyMines == 0)
+                continue;
+
+            bool open = IsReplayOpen(metrics, game, r, c);
+            int flags;
+            int gain = CountChordGain(metrics, game, r, c, &flags);
+            int cost = flags + 1 + !open;
+
+            // Opening an isolated number settles its own unit too
+            if (!open && metrics->parent[index] >= 0)
+                gain++;
+
+            if (gain <= cost)
+                continue;
+
+            clicks += cost;
+
+            if (!open)
+                unitsLeft -= OpenReplayTile(metrics, game, index);
+
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    if (!InsideBoard(game, r + dr, c + dc))
+                        continue;
+
+                    int other = (r + dr) * game->cols + (c + dc);
+
+                    if (game->cells[other].hasMine)
+                        metrics->state[other] |= TILE_FLAGGED;
+                    else
+                        unitsLeft -= OpenReplayTile(metrics, game, other);
+                }
+            }
+        }
+    }
+
+    return clicks + unitsLeft;
+}
+
+// =============================================================
+//                        COMPUTATION
+// =============================================================
+
+/*
+Computes every metric of a dealt board (after CountNearbyMines).
+Only the mines and numbers are read, so the player's progress on
+the board does not matter.
+Returns false if memory runs out or the board is not square
+(game->adjacency is set).
+*/
+bool ComputeBoardMetrics(BoardMetrics *metrics, const Game *game)
+{
+    if (game->adjacency != NULL || !ReserveBoardMetrics(metrics, game->rows * game->cols))
+        return false;
+
+    LabelComponents(metrics, game, 0, INT_MAX);
+    metrics->zini = EstimateZini(metrics, game);
+
+    return true;
+}
+
+/*
+Computes the metrics of a dealt board only if its 3BV lies within
+minBbbv..maxBbbv, giving up as soon as it cannot. The scratch space
+must already hold the board (ReserveBoardMetrics).
+Returns true if the board is in the band; the metrics are only
+complete in that case. bbbv is -1 if the scan stopped early.
+Boards that are not square are never in the band.
+*/
+bool ScoreBoardInBand(BoardMetrics *metrics, const Game *game, int minBbbv, int maxBbbv)
+{
+    if (game->adjacency != NULL || !LabelComponents(metrics, game, minBbbv, maxBbbv))
+        return false;
+
+    metrics->zini = EstimateZini(metrics, game);
+
+    return true;
+}
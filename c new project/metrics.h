@@ -0,0 +1,46 @@
+
+// =============================================================
+// Board metrics
+// Difficulty figures of a dealt board: 3BV (least clicks to
+// clear it), openings, islands and a ZiNi click estimate
+// =============================================================
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "engine.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Data Structures --------------------
+
+/*
+Metrics of one board, with scratch space reused between boards
+so bulk evaluation does not allocate.
+*/
+typedef struct
+{
+    int bbbv;               // 3BV: openings plus numbers no opening reveals,
+                            // -1 if a banded scan stopped early
+    int openings;           // Connected areas of empty tiles
+    int isolatedNumbers;    // Numbers that need a click of their own
+    int islands;            // Connected groups of those numbers
+    int zini;               // Clicks with flags and chords, greedy estimate
+
+    int cellCapacity;
+    int *parent;            // Union-find forest, -1 outside both kinds
+    uint8_t *state;         // ZiNi replay: opened and flagged tiles
+} BoardMetrics;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+void InitBoardMetrics(BoardMetrics *metrics);
+void FreeBoardMetrics(BoardMetrics *metrics);
+bool ReserveBoardMetrics(BoardMetrics *metrics, int cellCount);
+
+// Computation
+bool ComputeBoardMetrics(BoardMetrics *metrics, const Game *game);
+bool ScoreBoardInBand(BoardMetrics *metrics, const Game *game, int minBbbv, int maxBbbv);
+
+#endif
@@ -0,0 +1,225 @@
+
+// =============================================================
+// Chunk prefetcher
+//
+// Every frame the owner of the world passes in the view and the
+// camera velocity (both in tiles). Chunks under the view and under
+// where the view will be PREFETCH_LOOKAHEAD seconds later, plus a
+// margin, are requested unless they are in memory or already on
+// their way. Each request is a job on the job system that deals the
+// chunk from the hash and lays its stored record over it, which
+// needs nothing of the world but its seed; the finished chunks are
+// handed to the world by the owner at the next update.
+//
+// A chunk may change hands while a job builds it: the player
+// can open it, or it can be evicted and written again. The world
+// refuses a delivered copy whose store version is out of date or
+// whose chunk is already in memory, so a late copy never
+// overwrites newer state.
+// =============================================================
+
+#include "prefetch.h"
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Seconds on a monotonic clock.
+*/
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*
+Position in the owner's list of requests not yet delivered, or -1.
+*/
+static int FindPending(const ChunkPrefetcher *prefetcher, int32_t chunkX, int32_t chunkY)
+{
+    for (int i = 0; i < prefetcher->pendingCount; i++)
+    {
+        if (prefetcher->pending[i].x == chunkX && prefetcher->pending[i].y == chunkY)
+            return i;
+    }
+
+    return -1;
+}
+
+// =============================================================
+//                            JOBS
+// =============================================================
+
+/*
+Job: builds the chunk at (chunkX, chunkY), passed as the item
+range, and leaves it with the finished ones.
+*/
+static void BuildChunk(void *argument, int chunkX, int chunkY)
+{
+    ChunkPrefetcher *prefetcher = argument;
+    double start = Now();
+    WorldChunk *chunk = CountedMalloc(sizeof(WorldChunk));
+    bool loaded = false;
+
+    if (chunk != NULL)
+    {
+        chunk->chunkX = chunkX;
+        chunk->chunkY = chunkY;
+        FillWorldChunk(prefetcher->world, chunk);
+
+        loaded = (prefetcher->store != NULL) && ReadStoredChunk(prefetcher->store, chunk);
+    }
+
+    double seconds = Now() - start;
+
+    pthread_mutex_lock(&prefetcher->lock);
+
+    prefetcher->ready[prefetcher->readyCount++] = (PrefetchResult){{chunkX, chunkY}, chunk};
+    prefetcher->workerSeconds += seconds;
+
+    if (loaded)
+        prefetcher->loaded++;
+    else if (chunk != NULL)
+        prefetcher->dealt++;
+
+    pthread_mutex_unlock(&prefetcher->lock);
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Prepares a prefetcher for a world and its store, which may be NULL,
+running its jobs on a pool (NULL for the shared one). Returns false
+if the pool has no workers, so chunks would only be built when the
+prefetcher stops; it must be stopped all the same.
+*/
+bool StartChunkPrefetcher(ChunkPrefetcher *prefetcher, const World *world, ChunkStore *store, JobSystem *jobs)
+{
+    *prefetcher = (ChunkPrefetcher){0};
+
+    prefetcher->world = world;
+    prefetcher->store = store;
+    prefetcher->jobs = (jobs != NULL) ? jobs : SharedJobSystem();
+    prefetcher->running = prefetcher->jobs->workerCount > 0;
+
+    pthread_mutex_init(&prefetcher->lock, NULL);
+
+    return prefetcher->running;
+}
+
+/*
+Waits for the chunk jobs and frees chunks that were never delivered.
+*/
+void StopChunkPrefetcher(ChunkPrefetcher *prefetcher)
+{
+    WaitForJobs(prefetcher->jobs, &prefetcher->inFlight);
+
+    for (int i = 0; i < prefetcher->readyCount; i++)
+        free(prefetcher->ready[i].chunk);
+
+    pthread_mutex_destroy(&prefetcher->lock);
+
+    prefetcher->running = false;
+    prefetcher->readyCount = 0;
+    prefetcher->pendingCount = 0;
+}
+
+// =============================================================
+//                          UPDATES
+// =============================================================
+
+/*
+Hands finished chunks to the world.
+*/
+static void DeliverChunks(ChunkPrefetcher *prefetcher, World *world)
+{
+    PrefetchResult ready[PREFETCH_MAX_PENDING];
+
+    pthread_mutex_lock(&prefetcher->lock);
+
+    int count = prefetcher->readyCount;
+
+    for (int i = 0; i < count; i++)
+        ready[i] = prefetcher->ready[i];
+
+    prefetcher->readyCount = 0;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    for (int i = 0; i < count; i++)
+    {
+        int slot = FindPending(prefetcher, ready[i].position.x, ready[i].position.y);
+
+        if (slot >= 0)
+            prefetcher->pending[slot] = prefetcher->pending[--prefetcher->pendingCount];
+
+        if (ready[i].chunk != NULL && AdoptWorldChunk(world, ready[i].chunk))
+            prefetcher->delivered++;
+        else
+        {
+            free(ready[i].chunk);
+            prefetcher->discarded++;
+        }
+    }
+}
+
+/*
+Requests the chunks covering a rectangle of tiles that are neither
+in memory nor on their way, while there is room.
+*/
+static void RequestArea(ChunkPrefetcher *prefetcher, const World *world,
+                        double left, double top, double right, double bottom)
+{
+    int32_t firstX = (int32_t)floor(left / WORLD_CHUNK_SIZE);
+    int32_t firstY = (int32_t)floor(top / WORLD_CHUNK_SIZE);
+    int32_t lastX = (int32_t)floor(right / WORLD_CHUNK_SIZE);
+    int32_t lastY = (int32_t)floor(bottom / WORLD_CHUNK_SIZE);
+
+    for (int32_t chunkY = firstY; chunkY <= lastY; chunkY++)
+    {
+        for (int32_t chunkX = firstX; chunkX <= lastX; chunkX++)
+        {
+            if (prefetcher->pendingCount == PREFETCH_MAX_PENDING)
+                break;
+
+            if (IsWorldChunkLoaded(world, chunkX, chunkY) || FindPending(prefetcher, chunkX, chunkY) >= 0)
+                continue;
+
+            prefetcher->pending[prefetcher->pendingCount++] = (WorldPoint){chunkX, chunkY};
+            prefetcher->requested++;
+
+            SubmitJob(prefetcher->jobs, BuildChunk, prefetcher, chunkX, chunkY, NULL, &prefetcher->inFlight);
+        }
+    }
+}
+
+/*
+Delivers finished chunks, then requests those under the view
+(left, top, width, height in tiles) and under where it will be
+after PREFETCH_LOOKAHEAD seconds at the velocity given in tiles
+per second. Call it from the thread that owns the world.
+*/
+void UpdateChunkPrefetcher(ChunkPrefetcher *prefetcher, World *world, double left, double top,
+                           double width, double height, double velocityX, double velocityY)
+{
+    if (!prefetcher->running)
+        return;
+
+    DeliverChunks(prefetcher, world);
+
+    // What is visible now comes first
+    RequestArea(prefetcher, world, left, top, left + width, top + height);
+
+    double aheadX = left + velocityX * PREFETCH_LOOKAHEAD;
+    double aheadY = top + velocityY * PREFETCH_LOOKAHEAD;
+
+    RequestArea(prefetcher, world, fmin(left, aheadX) - PREFETCH_MARGIN, fmin(top, aheadY) - PREFETCH_MARGIN,
+                fmax(left, aheadX) + width + PREFETCH_MARGIN, fmax(top, aheadY) + height + PREFETCH_MARGIN);
+}
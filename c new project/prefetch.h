@@ -0,0 +1,78 @@
+
+// =============================================================
+// Chunk prefetcher
+// Background jobs that deal or load the chunks of an endless
+// world the camera is heading for, so they are in memory before
+// they come into view
+// =============================================================
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "chunkstore.h"
+#include "jobs.h"
+#include "world.h"
+#include <pthread.h>
+#include <stdbool.h>
+
+// -------------------- Constants --------------------
+
+// Most chunks requested and not yet handed to the world
+#define PREFETCH_MAX_PENDING 64
+
+// How far ahead the camera is followed (seconds), and the tiles
+// added around the view on every side
+#define PREFETCH_LOOKAHEAD 0.25
+#define PREFETCH_MARGIN 16
+
+// -------------------- Data Structures --------------------
+
+/*
+A chunk finished by a job, or NULL if memory ran out.
+*/
+typedef struct
+{
+    WorldPoint position;    // In chunks
+    WorldChunk *chunk;
+} PrefetchResult;
+
+/*
+Chunk jobs in flight and the chunks they finished. The world
+itself is only touched by the thread that owns it.
+*/
+typedef struct
+{
+    const World *world;     // Read for the seed and density only
+    ChunkStore *store;      // Or NULL
+    JobSystem *jobs;        // Pool the chunk jobs run on
+    JobCounter inFlight;    // Jobs not finished yet
+    bool running;
+
+    pthread_mutex_t lock;   // Guards the finished chunks and counters below
+    PrefetchResult ready[PREFETCH_MAX_PENDING];
+    int readyCount;
+
+    // Owner's side: requested and not yet delivered
+    WorldPoint pending[PREFETCH_MAX_PENDING];
+    int pendingCount;
+
+    // Metrics
+    long requested;
+    long delivered;         // Adopted by the world
+    long discarded;         // Already in memory or changed meanwhile
+    long dealt;             // Made by jobs from the hash
+    long loaded;            // Made by jobs from the store
+    double workerSeconds;
+} ChunkPrefetcher;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool StartChunkPrefetcher(ChunkPrefetcher *prefetcher, const World *world, ChunkStore *store, JobSystem *jobs);
+void StopChunkPrefetcher(ChunkPrefetcher *prefetcher);
+
+// Once per frame
+void UpdateChunkPrefetcher(ChunkPrefetcher *prefetcher, World *world, double left, double top,
+                           double width, double height, double velocityX, double velocityY);
+
+#endif
@@ -0,0 +1,1388 @@
+
+// =============================================================
+// Mine probabilities
+//
+// Hidden tiles next to a number form the frontier; the others
+// are the interior. Frontier tiles linked through shared numbers
+// form independent components, found with a breadth-first walk.
+// Each component is enumerated by backtracking (in worker
+// jobs), counting its solutions and, per tile, the solutions
+// with a mine there, separately for every number of mines used.
+// A layout that puts m mines on the frontier leaves
+// C(interior, total - m) ways for the interior; that weight is
+// tabulated once per call in log space, each entry from the one
+// before by a single ratio (no lgamma(), whose signgam would race
+// between threads). Components are combined
+// with prefix and suffix convolutions of their mine counts, so
+// every tile gets an exact chance without enumerating the board.
+//
+// When a component is too large to enumerate in time, the whole
+// frontier is sampled instead: each job runs its own Markov
+// chain (with its own random stream) over consistent layouts,
+// and per-tile mine counts from all chains are merged. The spread
+// between time slices of the chains gives a confidence interval.
+// =============================================================
+
+#include "probability.h"
+#include "jobs.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Backtracking steps between two looks at the clock (minus one)
+#define CLOCK_CHECK_MASK 0x3FFF
+
+// Most suffix table entries kept for the exact combination
+#define MAX_SUFFIX_ENTRIES (1 << 24)
+
+// Sampler blocks: most tiles grown along shared numbers, and the most
+// layouts listed for one block (more means the block is skipped)
+#define SAMPLE_BLOCK_SIZE 16
+#define SAMPLE_MAX_LAYOUTS 4096
+
+// Sampler steps between two looks at the clock (minus one)
+#define SAMPLE_CLOCK_MASK 0x3FF
+
+// -------------------- Data Structures --------------------
+
+/*
+Frontier tiles linked by shared numbers, with their solution counts.
+*/
+typedef struct
+{
+    int *cells;             // Tile indices in enumeration order
+    int cellCount;
+    int *numbers;           // Tile indices of the numbers touching them
+    int numberCount;
+
+    double *ways;           // Solutions using k mines, k = 0..cellCount
+    double *cellMines;      // [k * cellCount + i]: those with a mine on cell i
+    bool finished;
+} Component;
+
+/*
+Work shared by the enumeration jobs.
+*/
+typedef struct
+{
+    Game *game;             // Its arena holds the scratch
+    Component *components;
+    int componentCount;
+    const int *localIndex;  // Tile -> position among its component's cells or numbers
+    int nextComponent;      // Next component to hand out
+    double deadline;
+} EnumerationJob;
+
+/*
+Backtracking state of one component.
+*/
+typedef struct
+{
+    Component *component;
+    int *need;              // Mines still missing around each number
+    int *left;              // Unassigned cells around each number
+    int *links;             // [cell * 8 + j]: numbers around each cell
+    int *linkCount;
+    unsigned char *assigned;
+    long steps;
+    double deadline;
+    bool timedOut;
+} Enumeration;
+
+/*
+Mine-count distribution: value[k] weighs low + k mines.
+*/
+typedef struct
+{
+    int low;
+    int count;
+    double *value;
+} Distribution;
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Seconds on a monotonic clock.
+*/
+static double Now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*
+Fills weight[m], m = 0..frontierCount, with the log of the ways
+C(interior, total - m) to place the other mines in the interior,
+up to a constant; impossible counts get -INFINITY. Going from m to
+m + 1 takes one mine off the interior, which multiplies the ways by
+rest / (interior - rest + 1), rest being the mines left at m.
+*/
+static void FillInteriorWeights(double *weight, int frontierCount, int interiorCount, int totalMines)
+{
+    double current = 0.0;
+
+    for (int m = 0; m <= frontierCount; m++)
+    {
+        int rest = totalMines - m;
+
+        if (rest < 0 || rest > interiorCount)
+        {
+            weight[m] = -INFINITY;
+            continue;
+        }
+
+        weight[m] = current;
+
+        if (rest > 0)
+            current += log((double)rest / (double)(interiorCount - rest + 1));
+    }
+}
+
+/*
+Tells if a tile is an opened number with hidden neighbours.
+*/
+static bool IsFrontierNumber(const Game *game, int row, int col)
+{
+    const Cell *cell = GameCell(game, row, col);
+
+    if (!cell->revealed || cell->hasMine)
+        return false;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (InsideBoard(game, row + dr, col + dc) && !GameCell(game, row + dr, col + dc)->revealed)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+Tells if a hidden tile touches an opened tile.
+*/
+static bool IsFrontierCell(const Game *game, int row, int col)
+{
+    if (GameCell(game, row, col)->revealed)
+        return false;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (InsideBoard(game, row + dr, col + dc) && GameCell(game, row + dr, col + dc)->revealed)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Prepares an empty map.
+*/
+void InitProbabilityMap(ProbabilityMap *map)
+{
+    memset(map, 0, sizeof(*map));
+}
+
+/*
+Releases the map memory.
+*/
+void FreeProbabilityMap(ProbabilityMap *map)
+{
+    free(map->mineChance);
+    free(map->margin);
+    memset(map, 0, sizeof(*map));
+}
+
+// =============================================================
+//                        COMPONENTS
+// =============================================================
+
+/*
+Walks the frontier from each unvisited tile, collecting connected
+cells in breadth-first order (which keeps numbers closing early
+during backtracking) together with the numbers that join them.
+Returns the number of components.
+*/
+static int FindComponents(const Game *game, Component *components, int *cellBuffer,
+                          int *numberBuffer, int *localIndex)
+{
+    int cellCount = game->rows * game->cols;
+    int componentCount = 0;
+    int cellsUsed = 0;
+    int numbersUsed = 0;
+
+    for (int i = 0; i < cellCount; i++)
+        localIndex[i] = -1;
+
+    for (int seed = 0; seed < cellCount; seed++)
+    {
+        if (localIndex[seed] >= 0 || !IsFrontierCell(game, seed / game->cols, seed % game->cols))
+            continue;
+
+        Component *component = &components[componentCount++];
+
+        component->cells = cellBuffer + cellsUsed;
+        component->numbers = numberBuffer + numbersUsed;
+        component->cellCount = 1;
+        component->numberCount = 0;
+        component->cells[0] = seed;
+        localIndex[seed] = 0;
+
+        for (int head = 0; head < component->cellCount; head++)
+        {
+            int row = component->cells[head] / game->cols;
+            int col = component->cells[head] % game->cols;
+
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    int nr = row + dr;
+                    int nc = col + dc;
+
+                    if (!InsideBoard(game, nr, nc) || localIndex[nr * game->cols + nc] >= 0
+                        || !IsFrontierNumber(game, nr, nc))
+                        continue;
+
+                    localIndex[nr * game->cols + nc] = component->numberCount;
+                    component->numbers[component->numberCount++] = nr * game->cols + nc;
+
+                    // Hidden tiles around the new number join the component
+                    for (int er = -1; er <= 1; er++)
+                    {
+                        for (int ec = -1; ec <= 1; ec++)
+                        {
+                            int hidden = (nr + er) * game->cols + (nc + ec);
+
+                            if (!InsideBoard(game, nr + er, nc + ec) || localIndex[hidden] >= 0
+                                || game->cells[hidden].revealed)
+                                continue;
+
+                            localIndex[hidden] = component->cellCount;
+                            component->cells[component->cellCount++] = hidden;
+                        }
+                    }
+                }
+            }
+        }
+
+        cellsUsed += component->cellCount;
+        numbersUsed += component->numberCount;
+    }
+
+    return componentCount;
+}
+
+/*
+Orders components from largest to smallest so the slow ones start first.
+*/
+static int CompareComponents(const void *a, const void *b)
+{
+    return ((const Component *)b)->cellCount - ((const Component *)a)->cellCount;
+}
+
+// =============================================================
+//                        ENUMERATION
+// =============================================================
+
+/*
+Gives a cell a value if every number around it still allows it.
+*/
+static bool Assign(Enumeration *state, int cell, int value)
+{
+    const int *links = state->links + cell * 8;
+    int linkCount = state->linkCount[cell];
+
+    for (int j = 0; j < linkCount; j++)
+    {
+        int number = links[j];
+
+        if (value == 1 && state->need[number] == 0)
+            return false;
+
+        if (value == 0 && state->need[number] == state->left[number])
+            return false;
+    }
+
+    for (int j = 0; j < linkCount; j++)
+    {
+        state->need[links[j]] -= value;
+        state->left[links[j]]--;
+    }
+
+    state->assigned[cell] = (unsigned char)value;
+
+    return true;
+}
+
+/*
+Takes back an accepted Assign.
+*/
+static void Unassign(Enumeration *state, int cell, int value)
+{
+    const int *links = state->links + cell * 8;
+
+    for (int j = 0; j < state->linkCount[cell]; j++)
+    {
+        state->need[links[j]] += value;
+        state->left[links[j]]++;
+    }
+}
+
+/*
+Tries both values for the cell at depth and counts the complete layouts.
+*/
+static void Enumerate(Enumeration *state, int depth, int mines)
+{
+    if (state->timedOut)
+        return;
+
+    if ((++state->steps & CLOCK_CHECK_MASK) == 0 && Now() > state->deadline)
+    {
+        state->timedOut = true;
+        return;
+    }
+
+    Component *component = state->component;
+    int cellCount = component->cellCount;
+
+    if (depth == cellCount)
+    {
+        double *row = component->cellMines + (size_t)mines * cellCount;
+
+        component->ways[mines] += 1.0;
+
+        for (int i = 0; i < cellCount; i++)
+            row[i] += state->assigned[i];
+
+        return;
+    }
+
+    for (int value = 0; value <= 1; value++)
+    {
+        if (Assign(state, depth, value))
+        {
+            Enumerate(state, depth + 1, mines + value);
+            Unassign(state, depth, value);
+        }
+    }
+}
+
+/*
+Counts every layout of one component. Leaves finished false if memory
+runs out, the component is too large or the deadline passes.
+*/
+static void EnumerateComponent(const EnumerationJob *job, Component *component)
+{
+    const Game *game = job->game;
+    int cellCount = component->cellCount;
+    int numberCount = component->numberCount;
+
+    component->finished = false;
+
+    if (cellCount > PROBABILITY_MAX_COMPONENT)
+        return;
+
+    Arena *arena = game->arena;
+
+    component->ways = ArenaAllocZero(arena, ((size_t)cellCount + 1) * sizeof(double));
+    component->cellMines = ArenaAllocZero(arena, ((size_t)cellCount + 1) * cellCount * sizeof(double));
+
+    Enumeration state = {0};
+    state.component = component;
+    state.deadline = job->deadline;
+    state.need = ArenaAlloc(arena, (size_t)numberCount * sizeof(int));
+    state.left = ArenaAlloc(arena, (size_t)numberCount * sizeof(int));
+    state.links = ArenaAlloc(arena, (size_t)cellCount * 8 * sizeof(int));
+    state.linkCount = ArenaAlloc(arena, (size_t)cellCount * sizeof(int));
+    state.assigned = ArenaAlloc(arena, (size_t)cellCount);
+
+    if (component->ways && component->cellMines && state.need && state.left
+        && state.links && state.linkCount && state.assigned)
+    {
+        for (int j = 0; j < numberCount; j++)
+        {
+            int row = component->numbers[j] / game->cols;
+            int col = component->numbers[j] % game->cols;
+
+            state.need[j] = GameCell(game, row, col)->nearbyMines;
+            state.left[j] = 0;
+        }
+
+        // Every opened neighbour of a frontier cell is one of its numbers
+        for (int i = 0; i < cellCount; i++)
+        {
+            int row = component->cells[i] / game->cols;
+            int col = component->cells[i] % game->cols;
+
+            state.linkCount[i] = 0;
+
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    if (!InsideBoard(game, row + dr, col + dc) || !GameCell(game, row + dr, col + dc)->revealed)
+                        continue;
+
+                    int number = job->localIndex[(row + dr) * game->cols + (col + dc)];
+
+                    state.links[i * 8 + state.linkCount[i]++] = number;
+                    state.left[number]++;
+                }
+            }
+        }
+
+        Enumerate(&state, 0, 0);
+        component->finished = !state.timedOut;
+    }
+}
+
+/*
+Worker job: takes components until none are left.
+*/
+static void EnumerationWorker(void *argument, int first, int end)
+{
+    EnumerationJob *job = argument;
+
+    (void)first;
+    (void)end;
+
+    for (;;)
+    {
+        int index = __atomic_fetch_add(&job->nextComponent, 1, __ATOMIC_RELAXED);
+
+        if (index >= job->componentCount)
+            break;
+
+        EnumerateComponent(job, &job->components[index]);
+    }
+}
+
+/*
+Enumerates every component with up to threadCount worker jobs on
+the shared job system; the calling thread works too while it waits.
+*/
+static void EnumerateAll(EnumerationJob *job, int threadCount)
+{
+    if (threadCount > job->componentCount)
+        threadCount = job->componentCount;
+
+    ParallelFor(NULL, EnumerationWorker, job, 0, threadCount, 1);
+}
+
+// =============================================================
+//                        COMBINATION
+// =============================================================
+
+/*
+Convolves two distributions and scales the result to a peak of 1.
+The result is stored in the arena.
+*/
+static bool Convolve(Arena *arena, const Distribution *a, const Distribution *b, Distribution *out)
+{
+    out->low = a->low + b->low;
+    out->count = a->count + b->count - 1;
+    out->value = ArenaAllocZero(arena, (size_t)out->count * sizeof(double));
+
+    if (out->value == NULL)
+        return false;
+
+    double peak = 0.0;
+
+    for (int i = 0; i < a->count; i++)
+    {
+        if (a->value[i] == 0.0)
+            continue;
+
+        for (int j = 0; j < b->count; j++)
+            out->value[i + j] += a->value[i] * b->value[j];
+    }
+
+    for (int k = 0; k < out->count; k++)
+    {
+        if (out->value[k] > peak)
+            peak = out->value[k];
+    }
+
+    if (peak > 0.0)
+    {
+        for (int k = 0; k < out->count; k++)
+            out->value[k] /= peak;
+    }
+
+    return true;
+}
+
+/*
+Writes the chance of each cell of a component given the weight of
+every mine count it can use.
+*/
+static void WriteComponentChances(ProbabilityMap *map, const Component *component, const double *weight)
+{
+    int cellCount = component->cellCount;
+    double total = 0.0;
+
+    for (int k = 0; k <= cellCount; k++)
+        total += component->ways[k] * weight[k];
+
+    for (int i = 0; i < cellCount; i++)
+    {
+        double mines = 0.0;
+
+        for (int k = 0; k <= cellCount; k++)
+            mines += component->cellMines[(size_t)k * cellCount + i] * weight[k];
+
+        map->mineChance[component->cells[i]] = (total > 0.0) ? (float)(mines / total) : 0.0f;
+    }
+}
+
+/*
+Combines finished components exactly. For component j the others
+give a distribution Q(c) of mines, and k mines in j have weight
+sum_c Q(c) * W(c + k), W being the interior weight table.
+Returns false (leaving estimates to the caller) if the deadline
+passes or memory runs out.
+*/
+static bool CombineExactly(ProbabilityMap *map, Arena *arena, Component *components, int componentCount,
+                           int interiorCount, int totalMines, double deadline)
+{
+    int frontierCount = 0;
+    int largest = 0;
+    size_t suffixEntries = 0;
+
+    for (int j = componentCount - 1; j >= 0; j--)
+    {
+        frontierCount += components[j].cellCount;
+        suffixEntries += (size_t)frontierCount + 1;
+
+        if (components[j].cellCount > largest)
+            largest = components[j].cellCount;
+    }
+
+    if (suffixEntries > MAX_SUFFIX_ENTRIES)
+        return false;
+
+    // Interior weights C(interior, total - m) in log space, relative to the largest
+    double *weight = ArenaAlloc(arena, ((size_t)frontierCount + 1) * sizeof(double));
+    double *kWeight = ArenaAlloc(arena, ((size_t)largest + 1) * sizeof(double));
+    Distribution *suffix = ArenaAllocZero(arena, ((size_t)componentCount + 1) * sizeof(Distribution));
+    double one = 1.0;
+    bool ok = (weight != NULL && kWeight != NULL && suffix != NULL);
+    double peak = -INFINITY;
+
+    if (ok)
+        FillInteriorWeights(weight, frontierCount, interiorCount, totalMines);
+
+    for (int m = 0; ok && m <= frontierCount; m++)
+    {
+        if (weight[m] > peak)
+            peak = weight[m];
+    }
+
+    for (int m = 0; ok && m <= frontierCount; m++)
+        weight[m] = exp(weight[m] - peak);
+
+    ok = ok && (peak > -INFINITY);
+
+    // Suffix products of the component distributions
+    if (ok)
+        suffix[componentCount] = (Distribution){0, 1, NULL};
+
+    for (int j = componentCount - 1; ok && j >= 0; j--)
+    {
+        Distribution own = {0, components[j].cellCount + 1, components[j].ways};
+        Distribution after = suffix[j + 1];
+
+        if (after.value == NULL)
+            after.value = &one;
+
+        ok = Convolve(arena, &own, &after, &suffix[j]);
+    }
+
+    // Walk forward with the prefix product
+    Distribution prefix = {0, 1, NULL};
+
+    for (int j = 0; ok && j < componentCount; j++)
+    {
+        if (Now() > deadline)
+        {
+            ok = false;
+            break;
+        }
+
+        Distribution before = prefix;
+        Distribution after = suffix[j + 1];
+        Distribution others;
+
+        if (before.value == NULL)
+            before.value = &one;
+        if (after.value == NULL)
+            after.value = &one;
+
+        if (!Convolve(arena, &before, &after, &others))
+        {
+            ok = false;
+            break;
+        }
+
+        for (int k = 0; k <= components[j].cellCount; k++)
+        {
+            kWeight[k] = 0.0;
+
+            for (int c = 0; c < others.count; c++)
+                kWeight[k] += others.value[c] * weight[others.low + c + k];
+        }
+
+        WriteComponentChances(map, &components[j], kWeight);
+
+        Distribution own = {0, components[j].cellCount + 1, components[j].ways};
+        Distribution next;
+
+        ok = Convolve(arena, &before, &own, &next);
+        prefix = next;
+    }
+
+    // Interior chance from the distribution of all frontier mines
+    if (ok && interiorCount > 0)
+    {
+        double total = 0.0;
+        double mines = 0.0;
+
+        for (int m = 0; m < prefix.count; m++)
+        {
+            double w = (prefix.value ? prefix.value[m] : 1.0) * weight[prefix.low + m];
+
+            total += w;
+            mines += w * (totalMines - prefix.low - m) / (double)interiorCount;
+        }
+
+        map->interiorChance = (total > 0.0) ? (float)(mines / total) : 0.0f;
+    }
+
+    return ok;
+}
+
+// =============================================================
+//                          SAMPLING
+// =============================================================
+
+/*
+Backtracking state reused by the sampler: the same need and left
+counts as Enumeration, over the whole frontier.
+*/
+typedef struct
+{
+    Game *game;             // Its arena holds the scratch
+    int cellCount;          // Frontier tiles
+    const int *cells;       // Tile index of each frontier tile
+    int numberCount;
+    const int *numbers;     // Tile index of each number
+    int *links;             // [cell * 8 + j]: numbers around each frontier tile
+    int *linkCount;
+    int *nearby;            // [cell * 8 + j]: frontier tiles around each frontier tile
+    int *nearbyCount;
+    int *wallCount;         // Frontier tiles around each number
+    int *wall;              // [number * 8 + k]: those tiles
+    double *logWeight;      // Interior weight of m frontier mines, m = 0..cellCount
+
+    int threadCount;
+    double burnInEnd;
+    double deadline;
+
+    uint32_t *counts;       // [chain][batch][cell]: chain steps with a mine there
+    long *samples;          // [chain][batch]: chain steps
+    double *interiorSums;   // [chain][batch]: sum of the interior density per step
+    bool *started;          // Chain found a starting layout in time
+} SamplingJob;
+
+/*
+Finds a first consistent layout, trying the values of each tile in
+random order. Iterative, since the frontier can be very long.
+Returns false if the deadline passes first.
+*/
+static bool FindStartingLayout(Enumeration *state, int cellCount, uint64_t *rng,
+                               signed char *tried, unsigned char *firstValue)
+{
+    int depth = 0;
+
+    if (cellCount == 0)
+        return true;
+
+    tried[0] = -1;
+    firstValue[0] = (unsigned char)(NextRandom(rng) & 1);
+
+    while (depth < cellCount)
+    {
+        if ((++state->steps & CLOCK_CHECK_MASK) == 0 && Now() > state->deadline)
+            return false;
+
+        int attempt = tried[depth] + 1;
+
+        // Undo the previous value of this tile before trying the next
+        if (tried[depth] >= 0)
+            Unassign(state, depth, state->assigned[depth]);
+
+        bool placed = false;
+
+        for (; attempt < 2; attempt++)
+        {
+            int value = firstValue[depth] ^ attempt;
+
+            if (Assign(state, depth, value))
+            {
+                tried[depth] = (signed char)attempt;
+                placed = true;
+                break;
+            }
+        }
+
+        if (placed)
+        {
+            if (++depth < cellCount)
+            {
+                tried[depth] = -1;
+                firstValue[depth] = (unsigned char)(NextRandom(rng) & 1);
+            }
+        }
+        else if (--depth < 0)
+            return false;
+    }
+
+    return true;
+}
+
+/*
+Lists every way to fill the block that keeps all numbers satisfied,
+the rest of the frontier staying as it is.
+*/
+static void ListBlockLayouts(Enumeration *state, const int *block, int blockSize, int depth,
+                             int layout, int *layouts, int *layoutCount)
+{
+    if (*layoutCount > SAMPLE_MAX_LAYOUTS)
+        return;
+
+    if (depth == blockSize)
+    {
+        if (*layoutCount < SAMPLE_MAX_LAYOUTS)
+            layouts[*layoutCount] = layout;
+
+        (*layoutCount)++;
+        return;
+    }
+
+    for (int value = 0; value <= 1; value++)
+    {
+        if (Assign(state, block[depth], value))
+        {
+            ListBlockLayouts(state, block, blockSize, depth + 1, layout | (value << depth),
+                             layouts, layoutCount);
+            Unassign(state, block[depth], value);
+        }
+    }
+}
+
+/*
+One Markov chain over consistent frontier layouts, with its own
+random stream and its own rows of counts.
+Each step redraws a block (a tile and its frontier neighbours, or a
+chain of tiles linked by numbers) among all its consistent layouts, weighted
+by how many ways the interior can hold the remaining mines, which
+leaves the chain's stationary distribution equal to the true one.
+Every step counts as a sample: a tile's mine time is added up when
+it changes and when a time slice (batch) ends.
+*/
+static void RunSamplingChain(SamplingJob *job, int chain)
+{
+    int cellCount = job->cellCount;
+    uint64_t rng = 0x5DEECE66Dull ^ ((uint64_t)(chain + 1) * 0x9E3779B97F4A7C15ull);
+
+    Enumeration state = {0};
+    state.deadline = job->deadline;
+    state.links = job->links;
+    state.linkCount = job->linkCount;
+    Arena *arena = job->game->arena;
+
+    state.need = ArenaAlloc(arena, (size_t)job->numberCount * sizeof(int));
+    state.left = ArenaAlloc(arena, (size_t)job->numberCount * sizeof(int));
+    state.assigned = ArenaAlloc(arena, (size_t)cellCount);
+
+    signed char *tried = ArenaAlloc(arena, (size_t)cellCount);
+    unsigned char *firstValue = ArenaAlloc(arena, (size_t)cellCount);
+    bool ready = state.need && state.left && state.assigned && tried && firstValue;
+
+    for (int j = 0; ready && j < job->numberCount; j++)
+    {
+        state.need[j] = job->game->cells[job->numbers[j]].nearbyMines;
+        state.left[j] = job->wallCount[j];
+    }
+
+    ready = ready && FindStartingLayout(&state, cellCount, &rng, tried, firstValue);
+    job->started[chain] = ready;
+
+    int mines = 0;
+
+    for (int i = 0; ready && i < cellCount; i++)
+        mines += state.assigned[i];
+
+    uint32_t *counts = job->counts + (size_t)chain * PROBABILITY_BATCHES * cellCount;
+    long *samples = job->samples + chain * PROBABILITY_BATCHES;
+    double *interiorSums = job->interiorSums + chain * PROBABILITY_BATCHES;
+    int interiorCount = job->game->rows * job->game->cols - job->game->revealedSafe - cellCount;
+    int *layouts = ArenaAlloc(arena, SAMPLE_MAX_LAYOUTS * sizeof(int));
+    double *weights = ArenaAlloc(arena, SAMPLE_MAX_LAYOUTS * sizeof(double));
+    long *since = ArenaAlloc(arena, (size_t)cellCount * sizeof(long));
+    unsigned char *inBlock = ArenaAllocZero(arena, (size_t)cellCount + 1);
+    bool counting = false;
+    int batch = -1;
+    long step = 0;
+    long checks = 0;
+
+    ready = ready && layouts && weights && since && inBlock;
+
+    while (ready)
+    {
+        int cell = (int)RandomBelow(&rng, (uint32_t)cellCount);
+        int block[SAMPLE_BLOCK_SIZE];
+        int blockSize = 0;
+
+        block[blockSize++] = cell;
+        inBlock[cell] = 1;
+
+        // Alternate between a tile with its neighbours and a chain grown
+        // through shared numbers, which follows the frontier
+        if (checks & 1)
+        {
+            for (int j = 0; j < job->nearbyCount[cell] && blockSize < SAMPLE_BLOCK_SIZE; j++)
+            {
+                block[blockSize++] = job->nearby[cell * 8 + j];
+                inBlock[block[blockSize - 1]] = 1;
+            }
+        }
+        else
+        {
+            for (int head = 0; head < blockSize; head++)
+            {
+                for (int j = 0; j < job->linkCount[block[head]]; j++)
+                {
+                    int number = job->links[block[head] * 8 + j];
+
+                    for (int k = 0; k < job->wallCount[number] && blockSize < SAMPLE_BLOCK_SIZE; k++)
+                    {
+                        int other = job->wall[number * 8 + k];
+
+                        if (!inBlock[other])
+                        {
+                            inBlock[other] = 1;
+                            block[blockSize++] = other;
+                        }
+                    }
+                }
+            }
+        }
+
+        for (int b = 0; b < blockSize; b++)
+            inBlock[block[b]] = 0;
+
+        int previous = 0;
+
+        for (int b = 0; b < blockSize; b++)
+        {
+            previous |= state.assigned[block[b]] << b;
+            mines -= state.assigned[block[b]];
+            Unassign(&state, block[b], state.assigned[block[b]]);
+        }
+
+        int layoutCount = 0;
+        ListBlockLayouts(&state, block, blockSize, 0, 0, layouts, &layoutCount);
+
+        // Too many layouts: keep the block as it was. This depends only on
+        // the tiles around the block, so the chain stays balanced.
+        if (layoutCount > SAMPLE_MAX_LAYOUTS)
+        {
+            layouts[0] = previous;
+            layoutCount = 1;
+        }
+
+        // Weigh each layout by the interior ways left for the other mines
+        double peak = -INFINITY;
+
+        for (int k = 0; k < layoutCount; k++)
+        {
+            weights[k] = job->logWeight[mines + __builtin_popcount((unsigned)layouts[k])];
+
+            if (weights[k] > peak)
+                peak = weights[k];
+        }
+
+        double total = 0.0;
+
+        for (int k = 0; k < layoutCount; k++)
+        {
+            weights[k] = (peak == -INFINITY) ? 1.0 : exp(weights[k] - peak);
+            total += weights[k];
+        }
+
+        double pick = (double)(NextRandom(&rng) >> 11) * (1.0 / 9007199254740992.0) * total;
+        int chosen = 0;
+
+        while (chosen < layoutCount - 1 && pick >= weights[chosen])
+            pick -= weights[chosen++];
+
+        // Close the mine time of each block tile before it changes
+        for (int b = 0; b < blockSize; b++)
+        {
+            int value = (layouts[chosen] >> b) & 1;
+
+            if (counting)
+            {
+                counts[(size_t)batch * cellCount + block[b]] += (uint32_t)((previous >> b) & 1) * (uint32_t)(step - since[block[b]]);
+                since[block[b]] = step;
+            }
+
+            Assign(&state, block[b], value);
+            mines += value;
+        }
+
+        if (counting)
+        {
+            step++;
+            samples[batch]++;
+
+            if (interiorCount > 0)
+                interiorSums[batch] += (double)(job->game->totalMines - mines) / interiorCount;
+        }
+
+        if ((++checks & SAMPLE_CLOCK_MASK) != 0)
+            continue;
+
+        double now = Now();
+        int nextBatch = (int)((now - job->burnInEnd) / (job->deadline - job->burnInEnd) * PROBABILITY_BATCHES);
+
+        if (now < job->burnInEnd || nextBatch == batch)
+            continue;
+
+        // Flush every tile into the batch that is ending
+        if (counting)
+        {
+            for (int i = 0; i < cellCount; i++)
+                counts[(size_t)batch * cellCount + i] += state.assigned[i] * (uint32_t)(step - since[i]);
+        }
+
+        if (now > job->deadline || nextBatch >= PROBABILITY_BATCHES)
+            break;
+
+        for (int i = 0; i < cellCount; i++)
+            since[i] = 0;
+
+        step = 0;
+        batch = nextBatch;
+        counting = true;
+    }
+}
+
+/*
+Sampling job: runs chains first..end-1.
+*/
+static void SamplingWorker(void *argument, int first, int end)
+{
+    for (int chain = first; chain < end; chain++)
+        RunSamplingChain(argument, chain);
+}
+
+/*
+Mean and 95% half-width from batch means. Batches without samples
+are skipped; fewer than two usable batches give a half-width of 1.
+*/
+static void SummarizeBatches(const double *sums, const long *samples, int batchCount,
+                             float *mean, float *margin)
+{
+    double totalSum = 0.0;
+    long totalSamples = 0;
+    int used = 0;
+
+    for (int b = 0; b < batchCount; b++)
+    {
+        totalSum += sums[b];
+        totalSamples += samples[b];
+        used += (samples[b] > 0);
+    }
+
+    double average = (totalSamples > 0) ? totalSum / totalSamples : 0.0;
+    double spread = 0.0;
+
+    for (int b = 0; b < batchCount; b++)
+    {
+        if (samples[b] > 0)
+        {
+            double difference = sums[b] / samples[b] - average;
+            spread += difference * difference;
+        }
+    }
+
+    *mean = (float)average;
+    *margin = (used >= 2) ? (float)(1.96 * sqrt(spread / (used - 1) / used)) : 1.0f;
+}
+
+/*
+Estimates the chances of every tile by sampling frontier layouts in
+threadCount chains until the deadline; the first tenth of the time
+is burn-in. Returns false if no chain found a starting layout.
+*/
+static bool SampleFrontier(ProbabilityMap *map, Game *game, const int *cells, int cellCount,
+                           const int *numbers, int numberCount, double deadline, int threadCount)
+{
+    int tileCount = game->rows * game->cols;
+    int hiddenCount = tileCount - game->revealedSafe;
+    int interiorCount = hiddenCount - cellCount;
+    int batchTotal = threadCount * PROBABILITY_BATCHES;
+
+    SamplingJob job = {0};
+    job.game = game;
+    job.cellCount = cellCount;
+    job.cells = cells;
+    job.numberCount = numberCount;
+    job.numbers = numbers;
+    job.threadCount = threadCount;
+    job.deadline = deadline;
+    job.burnInEnd = Now() + 0.1 * (deadline - Now());
+
+    Arena *arena = game->arena;
+    int *indexOf = ArenaAlloc(arena, (size_t)tileCount * sizeof(int));
+    job.links = ArenaAlloc(arena, (size_t)cellCount * 8 * sizeof(int));
+    job.linkCount = ArenaAlloc(arena, (size_t)cellCount * sizeof(int));
+    job.nearby = ArenaAlloc(arena, (size_t)cellCount * 8 * sizeof(int));
+    job.nearbyCount = ArenaAlloc(arena, (size_t)cellCount * sizeof(int));
+    job.wallCount = ArenaAllocZero(arena, ((size_t)numberCount + 1) * sizeof(int));
+    job.wall = ArenaAlloc(arena, ((size_t)numberCount + 1) * 8 * sizeof(int));
+    job.logWeight = ArenaAlloc(arena, ((size_t)cellCount + 1) * sizeof(double));
+    job.counts = ArenaAllocZero(arena, ((size_t)batchTotal * cellCount + 1) * sizeof(uint32_t));
+    job.samples = ArenaAllocZero(arena, (size_t)batchTotal * sizeof(long));
+    job.interiorSums = ArenaAllocZero(arena, (size_t)batchTotal * sizeof(double));
+    job.started = ArenaAllocZero(arena, (size_t)threadCount * sizeof(bool));
+
+    bool ok = indexOf && job.links && job.linkCount && job.nearby && job.nearbyCount && job.wallCount
+              && job.wall && job.logWeight && job.counts && job.samples && job.interiorSums && job.started;
+
+    if (ok)
+    {
+        // Frontier tiles and numbers share one index space
+        for (int i = 0; i < tileCount; i++)
+            indexOf[i] = -1;
+        for (int i = 0; i < cellCount; i++)
+            indexOf[cells[i]] = i;
+        for (int j = 0; j < numberCount; j++)
+            indexOf[numbers[j]] = j;
+
+        for (int i = 0; i < cellCount; i++)
+        {
+            int row = cells[i] / game->cols;
+            int col = cells[i] % game->cols;
+
+            job.linkCount[i] = 0;
+            job.nearbyCount[i] = 0;
+
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    if ((dr == 0 && dc == 0) || !InsideBoard(game, row + dr, col + dc))
+                        continue;
+
+                    int tile = (row + dr) * game->cols + (col + dc);
+
+                    if (indexOf[tile] < 0)
+                        continue;
+
+                    if (game->cells[tile].revealed)
+                    {
+                        int number = indexOf[tile];
+
+                        job.links[i * 8 + job.linkCount[i]++] = number;
+                        job.wall[number * 8 + job.wallCount[number]++] = i;
+                    }
+                    else
+                        job.nearby[i * 8 + job.nearbyCount[i]++] = indexOf[tile];
+                }
+            }
+        }
+
+        FillInteriorWeights(job.logWeight, cellCount, interiorCount, game->totalMines);
+
+        // One job per chain; the calling thread runs chains too
+        ParallelFor(NULL, SamplingWorker, &job, 0, threadCount, 1);
+
+        ok = false;
+
+        for (int t = 0; t < threadCount; t++)
+            ok = ok || job.started[t];
+    }
+
+    if (ok)
+    {
+        double *sums = ArenaAlloc(arena, (size_t)batchTotal * sizeof(double));
+        long sampled = 0;
+
+        for (int b = 0; b < batchTotal; b++)
+            sampled += job.samples[b];
+
+        ok = (sums != NULL && sampled > 0);
+
+        for (int i = 0; ok && i < cellCount; i++)
+        {
+            for (int b = 0; b < batchTotal; b++)
+                sums[b] = job.counts[(size_t)b * cellCount + i];
+
+            SummarizeBatches(sums, job.samples, batchTotal, &map->mineChance[cells[i]], &map->margin[cells[i]]);
+        }
+
+        if (ok && interiorCount > 0)
+            SummarizeBatches(job.interiorSums, job.samples, batchTotal, &map->interiorChance, &map->interiorMargin);
+
+        map->samples = sampled;
+    }
+
+    // Everything that is not frontier
+    for (int i = 0; ok && i < tileCount; i++)
+    {
+        if (game->cells[i].revealed)
+        {
+            map->mineChance[i] = PROBABILITY_OPENED;
+            map->margin[i] = 0.0f;
+        }
+        else if (indexOf[i] < 0)
+        {
+            map->mineChance[i] = map->interiorChance;
+            map->margin[i] = map->interiorMargin;
+        }
+    }
+
+    return ok;
+}
+
+// =============================================================
+//                        COMPUTATION
+// =============================================================
+
+/*
+Makes sure the map can hold the given board, so computing its
+chances allocates nothing beyond the game's arena. Returns false
+if memory runs out.
+*/
+bool ReserveProbabilityMap(ProbabilityMap *map, int cellCount)
+{
+    if (cellCount <= map->cellCapacity)
+        return true;
+
+    float *chance = CountedRealloc(map->mineChance, (size_t)cellCount * sizeof(float));
+
+    if (chance != NULL)
+        map->mineChance = chance;
+
+    float *margin = CountedRealloc(map->margin, (size_t)cellCount * sizeof(float));
+
+    if (margin != NULL)
+        map->margin = margin;
+
+    if (chance == NULL || margin == NULL)
+        return false;
+
+    map->cellCapacity = cellCount;
+
+    return true;
+}
+
+/*
+Fills map with the mine chance of every tile. Components are
+enumerated for up to PROBABILITY_EXACT_SHARE of the budget; if one
+is too large or runs out of time, the frontier is sampled for the
+rest of it and map->exact is false. Should sampling fail too, the
+chances are estimated from the mine density. Scratch comes from
+the game's arena and is given back before returning.
+threadCount 0 uses every thread of the shared job system.
+Returns false if the game is over, the board is not square
+(game->adjacency is set) or memory runs out.
+*/
+bool ComputeMineProbabilities(ProbabilityMap *map, Game *game,
+                              double budgetSeconds, int threadCount)
+{
+    double start = Now();
+    int cellCount = game->rows * game->cols;
+
+    if (game->status != GAME_PLAYING || game->adjacency != NULL || !ReserveProbabilityMap(map, cellCount))
+        return false;
+
+    // Scratch comes from the game's arena and goes back to it at the end
+    ArenaMark scratch = ArenaPosition(game->arena);
+    Component *components = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(Component));
+    int *cellBuffer = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(int));
+    int *numberBuffer = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(int));
+    int *localIndex = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(int));
+
+    if (!components || !cellBuffer || !numberBuffer || !localIndex)
+    {
+        RewindArena(game->arena, scratch);
+        return false;
+    }
+
+    int componentCount = FindComponents(game, components, cellBuffer, numberBuffer, localIndex);
+    int frontierTotal = 0;
+    int numberTotal = 0;
+
+    for (int j = 0; j < componentCount; j++)
+    {
+        frontierTotal += components[j].cellCount;
+        numberTotal += components[j].numberCount;
+        components[j].ways = NULL;
+        components[j].cellMines = NULL;
+    }
+
+    qsort(components, (size_t)componentCount, sizeof(Component), CompareComponents);
+
+    // Count the layouts of every component
+    if (threadCount <= 0 || threadCount > CountJobThreads(NULL))
+        threadCount = CountJobThreads(NULL);
+    if (threadCount > PROBABILITY_MAX_THREADS)
+        threadCount = PROBABILITY_MAX_THREADS;
+
+    double deadline = start + budgetSeconds;
+    EnumerationJob job = {game, components, componentCount, localIndex, 0,
+                          start + budgetSeconds * PROBABILITY_EXACT_SHARE};
+    EnumerateAll(&job, threadCount);
+
+    int hiddenCount = cellCount - game->revealedSafe;
+    int finishedCount = 0;
+
+    for (int j = 0; j < componentCount; j++)
+        finishedCount += components[j].finished;
+
+    map->componentCount = componentCount;
+    map->unfinishedCount = componentCount - finishedCount;
+    map->interiorChance = (float)game->totalMines / (float)hiddenCount;
+    map->interiorMargin = 0.0f;
+    map->samples = 0;
+    map->exact = (finishedCount == componentCount)
+                 && CombineExactly(map, game->arena, components, componentCount, hiddenCount - frontierTotal,
+                                   game->totalMines, deadline);
+
+    if (map->exact)
+    {
+        for (int i = 0; i < cellCount; i++)
+        {
+            map->margin[i] = 0.0f;
+
+            if (game->cells[i].revealed)
+                map->mineChance[i] = PROBABILITY_OPENED;
+            else if (localIndex[i] < 0)
+                map->mineChance[i] = map->interiorChance;
+        }
+    }
+    else if (!SampleFrontier(map, game, cellBuffer, frontierTotal, numberBuffer, numberTotal,
+                             deadline, threadCount))
+    {
+        // Nothing better in time: the average density everywhere
+        map->interiorChance = (float)game->totalMines / (float)hiddenCount;
+
+        for (int i = 0; i < cellCount; i++)
+        {
+            map->mineChance[i] = game->cells[i].revealed ? PROBABILITY_OPENED : map->interiorChance;
+            map->margin[i] = game->cells[i].revealed ? 0.0f : 1.0f;
+        }
+    }
+
+    map->elapsedSeconds = Now() - start;
+    RewindArena(game->arena, scratch);
+
+    return true;
+}
+
+/*
+Like ComputeMineProbabilities, but always samples for the whole
+budget. Returns false if the game is over, the board is not
+square, memory runs out or no consistent layout is found in time.
+*/
+bool SampleMineProbabilities(ProbabilityMap *map, Game *game,
+                             double budgetSeconds, int threadCount)
+{
+    double start = Now();
+    int cellCount = game->rows * game->cols;
+
+    if (game->status != GAME_PLAYING || game->adjacency != NULL || !ReserveProbabilityMap(map, cellCount))
+        return false;
+
+    ArenaMark scratch = ArenaPosition(game->arena);
+    Component *components = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(Component));
+    int *cellBuffer = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(int));
+    int *numberBuffer = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(int));
+    int *localIndex = ArenaAlloc(game->arena, (size_t)cellCount * sizeof(int));
+    bool ok = (components && cellBuffer && numberBuffer && localIndex);
+
+    if (ok)
+    {
+        int componentCount = FindComponents(game, components, cellBuffer, numberBuffer, localIndex);
+        int frontierTotal = 0;
+        int numberTotal = 0;
+
+        for (int j = 0; j < componentCount; j++)
+        {
+            frontierTotal += components[j].cellCount;
+            numberTotal += components[j].numberCount;
+        }
+
+        if (threadCount <= 0 || threadCount > CountJobThreads(NULL))
+            threadCount = CountJobThreads(NULL);
+        if (threadCount > PROBABILITY_MAX_THREADS)
+            threadCount = PROBABILITY_MAX_THREADS;
+
+        map->componentCount = componentCount;
+        map->unfinishedCount = componentCount;
+        map->interiorChance = 0.0f;
+        map->interiorMargin = 0.0f;
+        map->exact = false;
+        map->samples = 0;
+
+        ok = SampleFrontier(map, game, cellBuffer, frontierTotal, numberBuffer, numberTotal,
+                            start + budgetSeconds, threadCount);
+    }
+
+    map->elapsedSeconds = Now() - start;
+    RewindArena(game->arena, scratch);
+
+    return ok;
+}
+
+/*
+Picks the hidden, unflagged tile least likely to hold a mine.
+Returns false if there is none.
+*/
+bool FindSafestGuess(const ProbabilityMap *map, const Game *game, Move *guess)
+{
+    int cellCount = game->rows * game->cols;
+    float best = 2.0f;
+
+    for (int i = 0; i < cellCount; i++)
+    {
+        if (game->cells[i].revealed || game->cells[i].flagged || map->mineChance[i] >= best)
+            continue;
+
+        best = map->mineChance[i];
+        guess->type = MOVE_REVEAL;
+        guess->row = i / game->cols;
+        guess->col = i % game->cols;
+    }
+
+    return best <= 1.0f;
+}
@@ -0,0 +1,66 @@
+
+// =============================================================
+// Mine probabilities
+// Exact chance of every hidden tile holding a mine, given only
+// the numbers the player can see and the total mine count
+// =============================================================
+
+#ifndef PROBABILITY_H
+#define PROBABILITY_H
+
+#include "engine.h"
+#include <stdbool.h>
+
+// -------------------- Constants --------------------
+
+// Chance reported for tiles that are already open
+#define PROBABILITY_OPENED -1.0f
+
+// Frontier groups larger than this are not enumerated
+#define PROBABILITY_MAX_COMPONENT 1024
+
+// Upper limit for the worker jobs of one computation
+#define PROBABILITY_MAX_THREADS 16
+
+// Share of the budget given to exact enumeration before sampling
+#define PROBABILITY_EXACT_SHARE 0.5
+
+// Time slices per sampling chain used to estimate the error
+#define PROBABILITY_BATCHES 8
+
+// -------------------- Data Structures --------------------
+
+/*
+Per-tile mine chances and how they were obtained.
+Reused between calls so the map does not reallocate every move.
+*/
+typedef struct
+{
+    int cellCapacity;
+    float *mineChance;          // Per tile, PROBABILITY_OPENED if open
+    float *margin;              // Half-width of the 95% interval, 0 if exact
+
+    float interiorChance;       // Hidden tiles that touch no number
+    float interiorMargin;
+    int componentCount;         // Independent groups of frontier tiles
+    int unfinishedCount;        // Groups the time budget cut short
+    bool exact;                 // False if the chances were sampled or estimated
+    long samples;               // Chain steps behind sampled chances
+    double elapsedSeconds;
+} ProbabilityMap;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+void InitProbabilityMap(ProbabilityMap *map);
+void FreeProbabilityMap(ProbabilityMap *map);
+bool ReserveProbabilityMap(ProbabilityMap *map, int cellCount);
+
+// Computation
+bool ComputeMineProbabilities(ProbabilityMap *map, Game *game,
+                              double budgetSeconds, int threadCount);
+bool SampleMineProbabilities(ProbabilityMap *map, Game *game,
+                             double budgetSeconds, int threadCount);
+bool FindSafestGuess(const ProbabilityMap *map, const Game *game, Move *guess);
+
+#endif
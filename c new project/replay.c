@@ -0,0 +1,843 @@
+
+// =============================================================
+// Replay recording and playback
+//
+// File layout (all integers little-endian):
+//   u32 magic, u16 version, u16 deal method (DealMethod; 0 before
+//   version 3, whose boards were all dealt over the whole board)
+//   u32 rows, u32 cols, u32 mines
+//   u64 seed, u64 final hash, u32 move count
+//   moves: varint time delta (ms), varint (cell << 1 | type)
+//   u32 keyframe count, then for each keyframe:
+//     u32 move index, u8 status, u32 revealed, u32 flagged,
+//     u32 size, size bytes of varint (run << 2 | cell state)
+// =============================================================
+
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Size of the fixed header in bytes
+#define REPLAY_HEADER_SIZE 40
+
+// Longest encoding of one move (two 32-bit varints)
+#define REPLAY_MOVE_MAX_BYTES 10
+
+// Fixed part of a stored keyframe
+#define REPLAY_KEYFRAME_HEADER_SIZE 17
+
+// Cell states used inside snapshots
+#define SNAPSHOT_HIDDEN 0
+#define SNAPSHOT_REVEALED 1
+#define SNAPSHOT_FLAGGED 2
+
+// =============================================================
+//                      BYTE ENCODING
+// =============================================================
+
+static void PutU16(uint8_t *out, uint16_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static void PutU32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void PutU64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint16_t GetU16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t GetU32(const uint8_t *in)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)in[i] << (8 * i);
+
+    return value;
+}
+
+static uint64_t GetU64(const uint8_t *in)
+{
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)in[i] << (8 * i);
+
+    return value;
+}
+
+/*
+Writes a variable-length integer (7 bits per byte).
+Returns the number of bytes used.
+*/
+static int PutVarint(uint8_t *out, uint32_t value)
+{
+    int length = 0;
+
+    while (value >= 0x80)
+    {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+
+    out[length++] = (uint8_t)value;
+
+    return length;
+}
+
+/*
+Reads a variable-length integer. Returns false on truncated
+or oversized input.
+*/
+static bool GetVarint(const uint8_t *in, size_t size, size_t *pos, uint32_t *value)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (*pos >= size)
+            return false;
+
+        uint8_t byte = in[(*pos)++];
+        result |= (uint32_t)(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// =============================================================
+//                         SNAPSHOTS
+// =============================================================
+
+/*
+Returns the snapshot state of one tile.
+*/
+static uint32_t SnapshotState(const Cell *cell)
+{
+    if (cell->revealed)
+        return SNAPSHOT_REVEALED;
+
+    return cell->flagged ? SNAPSHOT_FLAGGED : SNAPSHOT_HIDDEN;
+}
+
+/*
+Run-length encodes the revealed/flagged state of every tile.
+With out == NULL only the encoded size is computed.
+*/
+static uint32_t EncodeSnapshot(const Game *game, uint8_t *out)
+{
+    uint8_t scratch[5];
+    int total = game->rows * game->cols;
+    uint32_t size = 0;
+    int start = 0;
+
+    while (start < total)
+    {
+        uint32_t state = SnapshotState(&game->cells[start]);
+        int end = start + 1;
+
+        // Keep runs short enough for the varint to hold run << 2
+        while (end < total && end - start < (1 << 29)
+               && SnapshotState(&game->cells[end]) == state)
+            end++;
+
+        uint32_t packed = ((uint32_t)(end - start) << 2) | state;
+        size += PutVarint((out != NULL) ? out + size : scratch, packed);
+
+        start = end;
+    }
+
+    return size;
+}
+
+/*
+Checks an encoded snapshot and, if game is not NULL, writes it
+onto the board. Returns false if the runs do not cover the board.
+*/
+static bool DecodeSnapshot(const uint8_t *data, uint32_t size, int cellCount, Game *game)
+{
+    size_t pos = 0;
+    int index = 0;
+
+    while (pos < size)
+    {
+        uint32_t packed = 0;
+
+        if (!GetVarint(data, size, &pos, &packed))
+            return false;
+
+        uint32_t run = packed >> 2;
+        uint32_t state = packed & 3;
+
+        if (run == 0 || state > SNAPSHOT_FLAGGED || run > (uint32_t)(cellCount - index))
+            return false;
+
+        if (game != NULL)
+        {
+            for (uint32_t i = 0; i < run; i++)
+            {
+                game->cells[index + i].revealed = (state == SNAPSHOT_REVEALED);
+                game->cells[index + i].flagged = (state == SNAPSHOT_FLAGGED);
+                SyncTile(game, index + (int)i);
+            }
+        }
+
+        index += (int)run;
+    }
+
+    return index == cellCount;
+}
+
+/*
+Makes room for needed more keyframes holding bytes more snapshot
+bytes between them.
+*/
+static bool GrowKeyframes(Replay *replay, int needed, size_t bytes)
+{
+    if (replay->keyframeCount + needed > replay->keyframeCapacity)
+    {
+        int capacity = (replay->keyframeCapacity > 0) ? replay->keyframeCapacity * 2 : 16;
+
+        while (capacity < replay->keyframeCount + needed)
+            capacity *= 2;
+
+        ReplayKeyframe *grown = CountedRealloc(replay->keyframes, (size_t)capacity * sizeof(ReplayKeyframe));
+
+        if (grown == NULL)
+            return false;
+
+        replay->keyframes = grown;
+        replay->keyframeCapacity = capacity;
+    }
+
+    if (replay->snapshotSize + bytes > replay->snapshotCapacity)
+    {
+        size_t capacity = (replay->snapshotCapacity > 0) ? replay->snapshotCapacity * 2 : 4096;
+
+        while (capacity < replay->snapshotSize + bytes)
+            capacity *= 2;
+
+        uint8_t *grown = CountedRealloc(replay->snapshots, capacity);
+
+        if (grown == NULL)
+            return false;
+
+        replay->snapshots = grown;
+        replay->snapshotCapacity = capacity;
+    }
+
+    return true;
+}
+
+/*
+Stores a snapshot of the board as it is after moveIndex moves.
+*/
+static bool AppendKeyframe(Replay *replay, const Game *game, uint32_t moveIndex)
+{
+    uint32_t size = EncodeSnapshot(game, NULL);
+
+    if (!GrowKeyframes(replay, 1, size))
+        return false;
+
+    ReplayKeyframe *keyframe = &replay->keyframes[replay->keyframeCount++];
+
+    keyframe->moveIndex = moveIndex;
+    keyframe->status = (uint8_t)game->status;
+    keyframe->revealedSafe = (uint32_t)game->revealedSafe;
+    keyframe->flaggedCount = (uint32_t)game->flaggedCount;
+    keyframe->offset = replay->snapshotSize;
+    keyframe->size = size;
+
+    EncodeSnapshot(game, replay->snapshots + replay->snapshotSize);
+    replay->snapshotSize += size;
+
+    return true;
+}
+
+/*
+Releases all stored snapshots.
+*/
+static void FreeKeyframes(Replay *replay)
+{
+    free(replay->keyframes);
+    free(replay->snapshots);
+
+    replay->keyframes = NULL;
+    replay->keyframeCount = 0;
+    replay->keyframeCapacity = 0;
+
+    replay->snapshots = NULL;
+    replay->snapshotSize = 0;
+    replay->snapshotCapacity = 0;
+}
+
+// =============================================================
+//                         RECORDING
+// =============================================================
+
+/*
+Starts an empty recording for the game that was just dealt.
+*/
+void BeginReplay(Replay *replay, const Game *game)
+{
+    replay->rows = game->rows;
+    replay->cols = game->cols;
+    replay->totalMines = game->totalMines;
+    replay->seed = game->seed;
+    replay->deal = game->deal;
+    replay->finalHash = 0;
+
+    replay->moves = NULL;
+    replay->moveCount = 0;
+    replay->moveCapacity = 0;
+    replay->undoneMoves = 0;
+
+    replay->keyframes = NULL;
+    replay->keyframeCount = 0;
+    replay->keyframeCapacity = 0;
+
+    replay->snapshots = NULL;
+    replay->snapshotSize = 0;
+    replay->snapshotCapacity = 0;
+}
+
+/*
+Makes room for moveCount moves and their snapshots, so a game that
+stays within that is recorded without allocating. Returns false if
+memory runs out.
+*/
+bool ReserveReplay(Replay *replay, int moveCount)
+{
+    if (moveCount > replay->moveCapacity)
+    {
+        ReplayMove *grown = CountedRealloc(replay->moves, (size_t)moveCount * sizeof(ReplayMove));
+
+        if (grown == NULL)
+            return false;
+
+        replay->moves = grown;
+        replay->moveCapacity = moveCount;
+    }
+
+    // An encoded snapshot takes at most one byte per tile
+    int keyframes = moveCount / REPLAY_KEYFRAME_INTERVAL + 1 - replay->keyframeCount;
+
+    return keyframes <= 0
+           || GrowKeyframes(replay, keyframes, (size_t)keyframes * replay->rows * replay->cols);
+}
+
+/*
+Appends a move that changed the board. The game is the board
+after the move, used for the periodic snapshots.
+*/
+bool RecordMove(Replay *replay, const Game *game, Move move, uint32_t timeMs)
+{
+    if (replay->moveCount == replay->moveCapacity)
+    {
+        int capacity = (replay->moveCapacity > 0) ? replay->moveCapacity * 2 : 256;
+        ReplayMove *grown = CountedRealloc(replay->moves, (size_t)capacity * sizeof(ReplayMove));
+
+        if (grown == NULL)
+            return false;
+
+        replay->moves = grown;
+        replay->moveCapacity = capacity;
+    }
+
+    ReplayMove *entry = &replay->moves[replay->moveCount++];
+    replay->undoneMoves = 0;
+
+    entry->timeMs = timeMs;
+    entry->cell = (uint32_t)(move.row * replay->cols + move.col);
+    entry->type = (uint8_t)move.type;
+
+    if (replay->moveCount % REPLAY_KEYFRAME_INTERVAL == 0)
+        return AddReplayKeyframe(replay, game);
+
+    return true;
+}
+
+/*
+Drops the last move after the player undid it, so the log always
+describes the game as it stands. The move stays in memory until
+another move is recorded, so a redo can restore it.
+*/
+void UnrecordMove(Replay *replay)
+{
+    if (replay->moveCount == 0)
+        return;
+
+    replay->moveCount--;
+    replay->undoneMoves++;
+
+    while (replay->keyframeCount > 0
+           && replay->keyframes[replay->keyframeCount - 1].moveIndex > (uint32_t)replay->moveCount)
+        replay->snapshotSize = replay->keyframes[--replay->keyframeCount].offset;
+}
+
+/*
+Puts back the move most recently dropped by UnrecordMove().
+*/
+bool RestoreRecordedMove(Replay *replay, const Game *game)
+{
+    if (replay->undoneMoves == 0)
+        return false;
+
+    replay->moveCount++;
+    replay->undoneMoves--;
+
+    if (replay->moveCount % REPLAY_KEYFRAME_INTERVAL == 0)
+        return AddReplayKeyframe(replay, game);
+
+    return true;
+}
+
+/*
+Stores the fingerprint of the board as it was left.
+*/
+void FinishReplay(Replay *replay, const Game *game)
+{
+    replay->finalHash = HashGameState(game);
+}
+
+/*
+Releases the move log and snapshots.
+*/
+void FreeReplay(Replay *replay)
+{
+    free(replay->moves);
+
+    replay->moves = NULL;
+    replay->moveCount = 0;
+    replay->moveCapacity = 0;
+    replay->undoneMoves = 0;
+
+    FreeKeyframes(replay);
+}
+
+// =============================================================
+//                          STORAGE
+// =============================================================
+
+/*
+Writes a replay file. Returns false on I/O failure.
+*/
+bool SaveReplay(const Replay *replay, const char *path)
+{
+    size_t capacity = REPLAY_HEADER_SIZE + (size_t)replay->moveCount * REPLAY_MOVE_MAX_BYTES + 4;
+
+    for (int i = 0; i < replay->keyframeCount; i++)
+        capacity += REPLAY_KEYFRAME_HEADER_SIZE + replay->keyframes[i].size;
+
+    uint8_t *buffer = CountedMalloc(capacity);
+
+    if (buffer == NULL)
+        return false;
+
+    PutU32(buffer + 0, REPLAY_MAGIC);
+    PutU16(buffer + 4, REPLAY_VERSION);
+    PutU16(buffer + 6, (uint16_t)replay->deal);
+    PutU32(buffer + 8, (uint32_t)replay->rows);
+    PutU32(buffer + 12, (uint32_t)replay->cols);
+    PutU32(buffer + 16, (uint32_t)replay->totalMines);
+    PutU64(buffer + 20, replay->seed);
+    PutU64(buffer + 28, replay->finalHash);
+    PutU32(buffer + 36, (uint32_t)replay->moveCount);
+
+    size_t size = REPLAY_HEADER_SIZE;
+    uint32_t previousTime = 0;
+
+    for (int i = 0; i < replay->moveCount; i++)
+    {
+        const ReplayMove *entry = &replay->moves[i];
+
+        size += PutVarint(buffer + size, entry->timeMs - previousTime);
+        size += PutVarint(buffer + size, (entry->cell << 1) | entry->type);
+
+        previousTime = entry->timeMs;
+    }
+
+    PutU32(buffer + size, (uint32_t)replay->keyframeCount);
+    size += 4;
+
+    for (int i = 0; i < replay->keyframeCount; i++)
+    {
+        const ReplayKeyframe *keyframe = &replay->keyframes[i];
+
+        PutU32(buffer + size, keyframe->moveIndex);
+        buffer[size + 4] = keyframe->status;
+        PutU32(buffer + size + 5, keyframe->revealedSafe);
+        PutU32(buffer + size + 9, keyframe->flaggedCount);
+        PutU32(buffer + size + 13, keyframe->size);
+        size += REPLAY_KEYFRAME_HEADER_SIZE;
+
+        memcpy(buffer + size, replay->snapshots + keyframe->offset, keyframe->size);
+        size += keyframe->size;
+    }
+
+    FILE *file = fopen(path, "wb");
+    bool ok = (file != NULL) && (fwrite(buffer, 1, size, file) == size);
+
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+
+    free(buffer);
+
+    return ok;
+}
+
+/*
+Reads the snapshot section that follows the move log.
+*/
+static bool LoadKeyframes(Replay *replay, const uint8_t *buffer, size_t size, size_t pos)
+{
+    if (size - pos < 4)
+        return false;
+
+    uint32_t count = GetU32(buffer + pos);
+    pos += 4;
+
+    if (count > (size - pos) / REPLAY_KEYFRAME_HEADER_SIZE)
+        return false;
+
+    int cellCount = replay->rows * replay->cols;
+    uint32_t previousIndex = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (size - pos < REPLAY_KEYFRAME_HEADER_SIZE)
+            return false;
+
+        ReplayKeyframe keyframe;
+
+        keyframe.moveIndex = GetU32(buffer + pos);
+        keyframe.status = buffer[pos + 4];
+        keyframe.revealedSafe = GetU32(buffer + pos + 5);
+        keyframe.flaggedCount = GetU32(buffer + pos + 9);
+        keyframe.size = GetU32(buffer + pos + 13);
+        pos += REPLAY_KEYFRAME_HEADER_SIZE;
+
+        bool valid = keyframe.size <= size - pos
+                     && keyframe.moveIndex >= previousIndex
+                     && keyframe.moveIndex <= (uint32_t)replay->moveCount
+                     && keyframe.status <= GAME_WON
+                     && keyframe.revealedSafe <= (uint32_t)cellCount
+                     && keyframe.flaggedCount <= (uint32_t)cellCount
+                     && DecodeSnapshot(buffer + pos, keyframe.size, cellCount, NULL);
+
+        if (!valid)
+            return false;
+
+        if (!GrowKeyframes(replay, 1, keyframe.size))
+            return false;
+
+        keyframe.offset = replay->snapshotSize;
+        memcpy(replay->snapshots + replay->snapshotSize, buffer + pos, keyframe.size);
+        replay->snapshotSize += keyframe.size;
+        pos += keyframe.size;
+
+        replay->keyframes[replay->keyframeCount++] = keyframe;
+        previousIndex = keyframe.moveIndex;
+    }
+
+    return pos == size;
+}
+
+/*
+Reads and validates a replay file.
+Returns false if it is missing, truncated or inconsistent.
+Version 1 files have no snapshots; see BuildReplayKeyframes().
+*/
+bool LoadReplay(Replay *replay, const char *path)
+{
+    replay->moves = NULL;
+    replay->moveCount = 0;
+    replay->moveCapacity = 0;
+    replay->undoneMoves = 0;
+
+    replay->keyframes = NULL;
+    replay->keyframeCount = 0;
+    replay->keyframeCapacity = 0;
+
+    replay->snapshots = NULL;
+    replay->snapshotSize = 0;
+    replay->snapshotCapacity = 0;
+
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (fileSize < REPLAY_HEADER_SIZE)
+    {
+        fclose(file);
+        return false;
+    }
+
+    size_t size = (size_t)fileSize;
+    uint8_t *buffer = CountedMalloc(size);
+    bool ok = (buffer != NULL) && (fread(buffer, 1, size, file) == size);
+
+    fclose(file);
+
+    uint16_t version = ok ? GetU16(buffer + 4) : 0;
+
+    ok = ok && GetU32(buffer + 0) == REPLAY_MAGIC
+            && version >= 1 && version <= REPLAY_VERSION
+            && GetU16(buffer + 6) <= DEAL_IN_BANDS;
+
+    if (ok)
+    {
+        replay->rows = (int)GetU32(buffer + 8);
+        replay->cols = (int)GetU32(buffer + 12);
+        replay->totalMines = (int)GetU32(buffer + 16);
+        replay->seed = GetU64(buffer + 20);
+        replay->deal = (DealMethod)GetU16(buffer + 6);
+        replay->finalHash = GetU64(buffer + 28);
+
+        uint32_t moveCount = GetU32(buffer + 36);
+        long long cellCount = (long long)replay->rows * replay->cols;
+
+        // Every move takes at least two bytes
+        ok = replay->rows > 0 && replay->cols > 0 && cellCount <= 0x7fffffff
+             && moveCount <= (size - REPLAY_HEADER_SIZE) / 2;
+
+        if (ok && moveCount > 0)
+        {
+            replay->moves = CountedMalloc((size_t)moveCount * sizeof(ReplayMove));
+            ok = (replay->moves != NULL);
+        }
+
+        size_t pos = REPLAY_HEADER_SIZE;
+        uint32_t time = 0;
+
+        for (uint32_t i = 0; ok && i < moveCount; i++)
+        {
+            uint32_t delta = 0;
+            uint32_t packed = 0;
+
+            ok = GetVarint(buffer, size, &pos, &delta)
+                 && GetVarint(buffer, size, &pos, &packed)
+                 && (packed >> 1) < (uint32_t)cellCount;
+
+            time += delta;
+
+            if (ok)
+            {
+                replay->moves[i].timeMs = time;
+                replay->moves[i].cell = packed >> 1;
+                replay->moves[i].type = (uint8_t)(packed & 1);
+            }
+        }
+
+        if (ok)
+        {
+            replay->moveCount = (int)moveCount;
+            replay->moveCapacity = (int)moveCount;
+        }
+
+        if (ok && version >= 2)
+            ok = LoadKeyframes(replay, buffer, size, pos);
+        else if (ok)
+            ok = (pos == size);
+    }
+
+    free(buffer);
+
+    if (!ok)
+        FreeReplay(replay);
+
+    return ok;
+}
+
+// =============================================================
+//                          PLAYBACK
+// =============================================================
+
+/*
+Returns the recorded move at the given position of the log.
+*/
+Move GetReplayMove(const Replay *replay, int index)
+{
+    const ReplayMove *entry = &replay->moves[index];
+
+    Move move;
+    move.type = (MoveType)entry->type;
+    move.row = (int)(entry->cell / (uint32_t)replay->cols);
+    move.col = (int)(entry->cell % (uint32_t)replay->cols);
+
+    return move;
+}
+
+/*
+Deals the recorded board so moves can be played back on it.
+*/
+bool StartReplayGame(const Replay *replay, Game *game)
+{
+    if (!AllocateGame(game, replay->rows, replay->cols, replay->totalMines))
+        return false;
+
+    ResetGameWithDeal(game, replay->seed, replay->deal);
+
+    return true;
+}
+
+/*
+Re-runs the whole log as fast as possible without rendering and
+compares the resulting board with the recorded fingerprint.
+*/
+bool CheckReplay(const Replay *replay, ReplayCheck *check)
+{
+    Game game;
+
+    if (!StartReplayGame(replay, &game))
+        return false;
+
+    clock_t start = clock();
+
+    for (int i = 0; i < replay->moveCount; i++)
+        ApplyMove(&game, GetReplayMove(replay, i));
+
+    check->seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    check->finalHash = HashGameState(&game);
+    check->hashMatches = (check->finalHash == replay->finalHash);
+    check->status = game.status;
+    check->movesApplied = replay->moveCount;
+
+    FreeGame(&game);
+
+    return true;
+}
+
+// =============================================================
+//                          SEEKING
+// =============================================================
+
+/*
+Snapshots the board after the moves recorded so far.
+*/
+bool AddReplayKeyframe(Replay *replay, const Game *game)
+{
+    return AppendKeyframe(replay, game, (uint32_t)replay->moveCount);
+}
+
+/*
+Recreates the snapshots of a log that has none (older files)
+by simulating it once from the start.
+*/
+bool BuildReplayKeyframes(Replay *replay)
+{
+    Game game;
+
+    if (!StartReplayGame(replay, &game))
+        return false;
+
+    FreeKeyframes(replay);
+
+    bool ok = true;
+
+    for (int i = 0; ok && i < replay->moveCount; i++)
+    {
+        ApplyMove(&game, GetReplayMove(replay, i));
+
+        if ((i + 1) % REPLAY_KEYFRAME_INTERVAL == 0)
+            ok = AppendKeyframe(replay, &game, (uint32_t)(i + 1));
+    }
+
+    FreeGame(&game);
+
+    return ok;
+}
+
+/*
+Puts a game dealt from this replay into the state it had after
+moveIndex moves: one snapshot load plus at most one interval of moves.
+*/
+bool SeekReplay(const Replay *replay, Game *game, int moveIndex)
+{
+    if (game->rows != replay->rows || game->cols != replay->cols || game->seed != replay->seed
+        || game->deal != replay->deal)
+        return false;
+
+    if (moveIndex < 0)
+        moveIndex = 0;
+
+    if (moveIndex > replay->moveCount)
+        moveIndex = replay->moveCount;
+
+    // Find the last snapshot at or before the target
+    int low = 0;
+    int high = replay->keyframeCount;
+
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+
+        if (replay->keyframes[mid].moveIndex <= (uint32_t)moveIndex)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    int start = 0;
+
+    if (low > 0)
+    {
+        const ReplayKeyframe *keyframe = &replay->keyframes[low - 1];
+
+        // The status goes first: the tiles' display state depends on it
+        game->status = (GameStatus)keyframe->status;
+        game->revealedSafe = (int)keyframe->revealedSafe;
+        game->flaggedCount = (int)keyframe->flaggedCount;
+        game->explodedIndex = -1;
+
+        DecodeSnapshot(replay->snapshots + keyframe->offset, keyframe->size, game->rows * game->cols, game);
+
+        start = (int)keyframe->moveIndex;
+
+        // Snapshots don't keep the exploded mine, but no move follows
+        // a loss, so it is the tile the last recorded move revealed
+        if (game->status == GAME_LOST && start > 0)
+        {
+            Move last = GetReplayMove(replay, start - 1);
+            int index = last.row * game->cols + last.col;
+
+            if (last.type == MOVE_REVEAL && game->cells[index].hasMine)
+            {
+                game->explodedIndex = index;
+                SyncTile(game, index);
+            }
+        }
+    }
+    else
+        ResetGameWithDeal(game, replay->seed, replay->deal);
+
+    for (int i = start; i < moveIndex; i++)
+        ApplyMove(game, GetReplayMove(replay, i));
+
+    return true;
+}
@@ -0,0 +1,114 @@
+
+// =============================================================
+// Replay recording and playback
+// A replay stores the seed, deal method, board parameters and a compact
+// log of timestamped moves, plus the hash of the final board
+// and periodic board snapshots for fast seeking
+// =============================================================
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "engine.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// File identification
+#define REPLAY_MAGIC 0x5052534Du   // "MSRP" read as little-endian
+#define REPLAY_VERSION 3
+
+// Moves between two stored board snapshots
+#define REPLAY_KEYFRAME_INTERVAL 256
+
+// -------------------- Data Structures --------------------
+
+/*
+One recorded move.
+*/
+typedef struct
+{
+    uint32_t timeMs;    // Milliseconds since the game started
+    uint32_t cell;      // row * cols + col
+    uint8_t type;       // MoveType
+} ReplayMove;
+
+/*
+Snapshot of the player-visible board after a given move.
+Mines are not stored since they follow from the seed.
+*/
+typedef struct
+{
+    uint32_t moveIndex;     // Number of moves applied before the snapshot
+    uint8_t status;         // GameStatus
+    uint32_t revealedSafe;
+    uint32_t flaggedCount;
+    size_t offset;          // Where its run-length encoded cell states
+    uint32_t size;          // start in Replay.snapshots, and their length
+} ReplayKeyframe;
+
+/*
+A recorded game.
+*/
+typedef struct
+{
+    int rows;
+    int cols;
+    int totalMines;
+    uint64_t seed;
+    DealMethod deal;        // How the mines follow from the seed
+    uint64_t finalHash;     // HashGameState() after the last move
+
+    ReplayMove *moves;
+    int moveCount;
+    int moveCapacity;
+    int undoneMoves;        // Moves dropped by undo that a redo can restore
+
+    ReplayKeyframe *keyframes;  // Sorted by moveIndex
+    int keyframeCount;
+    int keyframeCapacity;
+
+    uint8_t *snapshots;     // Encoded states of every keyframe, in order
+    size_t snapshotSize;
+    size_t snapshotCapacity;
+} Replay;
+
+/*
+Outcome of a headless playback run.
+*/
+typedef struct
+{
+    bool hashMatches;
+    uint64_t finalHash;
+    GameStatus status;
+    int movesApplied;
+    double seconds;         // Time spent simulating
+} ReplayCheck;
+
+// -------------------- Function Prototypes --------------------
+
+// Recording
+void BeginReplay(Replay *replay, const Game *game);
+bool ReserveReplay(Replay *replay, int moveCount);
+bool RecordMove(Replay *replay, const Game *game, Move move, uint32_t timeMs);
+void UnrecordMove(Replay *replay);
+bool RestoreRecordedMove(Replay *replay, const Game *game);
+void FinishReplay(Replay *replay, const Game *game);
+void FreeReplay(Replay *replay);
+
+// Storage
+bool SaveReplay(const Replay *replay, const char *path);
+bool LoadReplay(Replay *replay, const char *path);
+
+// Playback
+Move GetReplayMove(const Replay *replay, int index);
+bool StartReplayGame(const Replay *replay, Game *game);
+bool CheckReplay(const Replay *replay, ReplayCheck *check);
+
+// Seeking
+bool AddReplayKeyframe(Replay *replay, const Game *game);
+bool BuildReplayKeyframes(Replay *replay);
+bool SeekReplay(const Replay *replay, Game *game, int moveIndex);
+
+#endif
@@ -0,0 +1,614 @@
+
+// =============================================================
+// Saved games
+//
+// File layout (all integers little-endian):
+//   0  u32 magic        4  u16 version      6  u16 header size
+//   8  u32 rows        12  u32 cols        16  u32 mines
+//  20  u32 status      24  u64 seed
+//  32  u32 revealed    36  u32 flagged     40  u32 elapsed ms
+//  44  u32 deal        48  u64 plane size  56  u64 checksum
+//  then three bit planes (mines, revealed, flagged), one bit per
+//  tile in row-major order, each padded to whole 64-bit words.
+// Numbers on the tiles are not stored; they follow from the mines.
+// The deal method (DealMethod) is kept for the game's recording;
+// version 1 files hold 0 there, the whole-board deal of their time.
+// =============================================================
+
+#include "savegame.h"
+#include "jobs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+// Rows per job when a loaded board is expanded
+#define EXPAND_BAND_ROWS 64
+
+// -------------------- Data Structures --------------------
+
+/*
+A read-only view of a whole file.
+*/
+typedef struct
+{
+    const uint8_t *data;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+/*
+Planes being written onto a board by the band jobs.
+*/
+typedef struct
+{
+    Game *game;
+    const uint8_t *mines;
+    const uint8_t *revealed;
+    const uint8_t *flagged;
+    size_t words;           // Per plane
+} ExpandJob;
+
+// =============================================================
+//                        FILE MAPPING
+// =============================================================
+
+/*
+Maps a file into memory. Returns false if it cannot be opened.
+*/
+static bool MapFile(const char *path, MappedFile *mapped)
+{
+    mapped->data = NULL;
+    mapped->size = 0;
+
+#if defined(_WIN32)
+    mapped->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (mapped->file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(mapped->file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(mapped->file);
+        return false;
+    }
+
+    mapped->mapping = CreateFileMappingA(mapped->file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (mapped->mapping == NULL)
+    {
+        CloseHandle(mapped->file);
+        return false;
+    }
+
+    mapped->data = MapViewOfFile(mapped->mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (mapped->data == NULL)
+    {
+        CloseHandle(mapped->mapping);
+        CloseHandle(mapped->file);
+        return false;
+    }
+
+    mapped->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    mapped->data = data;
+    mapped->size = (size_t)info.st_size;
+#endif
+
+    return true;
+}
+
+/*
+Releases a mapping made by MapFile().
+*/
+static void UnmapFile(MappedFile *mapped)
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(mapped->data);
+    CloseHandle(mapped->mapping);
+    CloseHandle(mapped->file);
+#else
+    munmap((void *)mapped->data, mapped->size);
+#endif
+
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+
+// =============================================================
+//                      BYTE ENCODING
+// =============================================================
+
+static void PutU32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static void PutU64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out[i] = (uint8_t)(value >> (8 * i));
+}
+
+static uint32_t GetU32(const uint8_t *in)
+{
+    uint32_t value = 0;
+
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)in[i] << (8 * i);
+
+    return value;
+}
+
+static uint64_t GetU64(const uint8_t *in)
+{
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)in[i] << (8 * i);
+
+    return value;
+}
+
+/*
+Mixes the three planes into one 64-bit checksum, a word at a time.
+*/
+static uint64_t ChecksumPlanes(const uint8_t *planes, size_t words)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+
+    for (size_t i = 0; i < words; i++)
+    {
+        hash ^= GetU64(planes + i * 8);
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+
+    return hash;
+}
+
+// =============================================================
+//                          SAVING
+// =============================================================
+
+/*
+Writes the game to a file. Returns false on I/O failure.
+*/
+bool SaveGameState(const Game *game, uint32_t elapsedMs, const char *path)
+{
+    size_t cellCount = (size_t)game->rows * game->cols;
+    size_t words = (cellCount + 63) / 64;
+    size_t planeBytes = words * 8;
+    size_t size = SAVE_HEADER_SIZE + 3 * planeBytes;
+
+    uint8_t *buffer = CountedMalloc(size);
+
+    if (buffer == NULL)
+        return false;
+
+    uint8_t *mines = buffer + SAVE_HEADER_SIZE;
+    uint8_t *revealed = mines + planeBytes;
+    uint8_t *flagged = revealed + planeBytes;
+
+    // Pack 64 tiles into each word of the three planes
+    for (size_t w = 0; w < words; w++)
+    {
+        uint64_t mineBits = 0;
+        uint64_t revealedBits = 0;
+        uint64_t flaggedBits = 0;
+
+        size_t first = w * 64;
+        size_t count = (cellCount - first < 64) ? cellCount - first : 64;
+
+        for (size_t b = 0; b < count; b++)
+        {
+            const Cell *cell = &game->cells[first + b];
+
+            mineBits |= (uint64_t)cell->hasMine << b;
+            revealedBits |= (uint64_t)cell->revealed << b;
+            flaggedBits |= (uint64_t)cell->flagged << b;
+        }
+
+        PutU64(mines + w * 8, mineBits);
+        PutU64(revealed + w * 8, revealedBits);
+        PutU64(flagged + w * 8, flaggedBits);
+    }
+
+    PutU32(buffer + 0, SAVE_MAGIC);
+    PutU32(buffer + 4, SAVE_VERSION | ((uint32_t)SAVE_HEADER_SIZE << 16));
+    PutU32(buffer + 8, (uint32_t)game->rows);
+    PutU32(buffer + 12, (uint32_t)game->cols);
+    PutU32(buffer + 16, (uint32_t)game->totalMines);
+    PutU32(buffer + 20, (uint32_t)game->status);
+    PutU64(buffer + 24, game->seed);
+    PutU32(buffer + 32, (uint32_t)game->revealedSafe);
+    PutU32(buffer + 36, (uint32_t)game->flaggedCount);
+    PutU32(buffer + 40, elapsedMs);
+    PutU32(buffer + 44, (uint32_t)game->deal);
+    PutU64(buffer + 48, planeBytes);
+    PutU64(buffer + 56, ChecksumPlanes(mines, 3 * words));
+
+    FILE *file = fopen(path, "wb");
+    bool ok = (file != NULL) && (fwrite(buffer, 1, size, file) == size);
+
+    if (file != NULL && fclose(file) != 0)
+        ok = false;
+
+    free(buffer);
+
+    return ok;
+}
+
+// =============================================================
+//                          LOADING
+// =============================================================
+
+/*
+Checks that the planes describe a reachable game: the right number
+of mines, no tile both revealed and flagged, counters that match,
+and a status that agrees with them. A game in play has no mine
+open and safe tiles still hidden, a won game every safe tile open
+and no mine, and a lost game every mine open.
+Works on whole words, so it costs a fraction of one pass over the board.
+*/
+static bool ValidatePlanes(const uint8_t *mines, const uint8_t *revealed, const uint8_t *flagged,
+                           size_t words, size_t cellCount, const uint8_t *header)
+{
+    uint64_t mineTotal = 0;
+    uint64_t revealedSafe = 0;
+    uint64_t revealedMines = 0;
+    uint64_t flagTotal = 0;
+
+    uint64_t lastMask = (cellCount % 64 == 0) ? ~0ull : ((1ull << (cellCount % 64)) - 1);
+
+    for (size_t w = 0; w < words; w++)
+    {
+        uint64_t m = GetU64(mines + w * 8);
+        uint64_t r = GetU64(revealed + w * 8);
+        uint64_t f = GetU64(flagged + w * 8);
+
+        // Padding bits past the last tile must stay clear
+        uint64_t outside = (w == words - 1) ? ~lastMask : 0;
+
+        if ((r & f) != 0 || ((m | r | f) & outside) != 0)
+            return false;
+
+        mineTotal += (uint64_t)__builtin_popcountll(m);
+        revealedSafe += (uint64_t)__builtin_popcountll(r & ~m);
+        revealedMines += (uint64_t)__builtin_popcountll(r & m);
+        flagTotal += (uint64_t)__builtin_popcountll(f);
+    }
+
+    bool counted = mineTotal == GetU32(header + 16)
+                   && revealedSafe == GetU32(header + 32)
+                   && flagTotal == GetU32(header + 36);
+
+    switch (GetU32(header + 20))
+    {
+    case GAME_PLAYING:
+        return counted && revealedMines == 0 && revealedSafe < cellCount - mineTotal;
+    case GAME_WON:
+        return counted && revealedMines == 0 && revealedSafe == cellCount - mineTotal;
+    case GAME_LOST:
+        return counted && mineTotal > 0 && revealedMines == mineTotal;
+    default:
+        return false;
+    }
+}
+
+/*
+Reads 64 tiles of a plane from tile first on: bit j is tile
+first + j. Tiles past the end of the plane read as 0.
+*/
+static inline uint64_t PlaneBits(const uint8_t *plane, size_t words, size_t first)
+{
+    size_t w = first >> 6;
+    unsigned shift = (unsigned)(first & 63);
+    uint64_t bits = GetU64(plane + w * 8) >> shift;
+
+    if (shift != 0 && w + 1 < words)
+        bits |= GetU64(plane + (w + 1) * 8) << (64 - shift);
+
+    return bits;
+}
+
+/*
+One byte per bit of the low eight bits: byte k of the result (as
+PutU64() writes it) is bit k of bits.
+*/
+static inline uint64_t SpreadByte(unsigned bits)
+{
+    // Shifts of 7 keep bits 0-6 apart; bit 7 would land on bit 0 of
+    // the next copy, so it is placed on its own
+    return (((uint64_t)(bits & 0x7F) * 0x0002040810204081ull) & 0x0101010101010101ull)
+           | ((uint64_t)(bits >> 7 & 1) << 56);
+}
+
+/*
+Writes one row of the planes onto the cells and the padded board,
+eight tiles (a byte of each plane) at a time. Numbers and display
+state come later, from CountPlaneRow().
+*/
+static void ExpandPlaneRow(Game *game, int row, const uint8_t *mines, const uint8_t *revealed,
+                           const uint8_t *flagged, size_t words)
+{
+    int cols = game->cols;
+    size_t base = (size_t)row * cols;
+    Cell *cells = &game->cells[base];
+    uint8_t *padded = &game->padded[PaddedIndex(game, row, 0)];
+
+    // The ghost border of the padded board stops every flood
+    padded[-1] = PADDED_STOP;
+    padded[cols] = PADDED_STOP;
+
+    for (int c = 0; c < cols; c += 64)
+    {
+        int count = (cols - c < 64) ? cols - c : 64;
+        uint64_t m = PlaneBits(mines, words, base + c);
+        uint64_t v = PlaneBits(revealed, words, base + c);
+        uint64_t f = PlaneBits(flagged, words, base + c);
+
+        for (int j = 0; j < count; j += 8)
+        {
+            unsigned mineByte = (unsigned)(m >> j) & 0xFF;
+            unsigned revealedByte = (unsigned)(v >> j) & 0xFF;
+            unsigned flaggedByte = (unsigned)(f >> j) & 0xFF;
+            Cell *eight = &cells[c + j];
+
+            if (count - j < 8)
+            {
+                for (int b = 0; b < count - j; b++)
+                {
+                    eight[b] = (Cell){(revealedByte >> b) & 1u, (mineByte >> b) & 1u, (flaggedByte >> b) & 1u, 0};
+                    padded[c + j + b] = (uint8_t)(((mineByte >> b) & 1u) * PADDED_MINE
+                                                  | ((revealedByte >> b) & 1u) * PADDED_STOP);
+                }
+
+                break;
+            }
+
+            PutU64(&padded[c + j], SpreadByte(mineByte) * PADDED_MINE | SpreadByte(revealedByte) * PADDED_STOP);
+
+            // Hidden tiles without mines or flags, most of a saved board
+            if ((mineByte | revealedByte | flaggedByte) == 0)
+            {
+                memset(eight, 0, 8 * sizeof(Cell));
+                continue;
+            }
+
+            for (int b = 0; b < 8; b++)
+                eight[b] = (Cell){(revealedByte >> b) & 1u, (mineByte >> b) & 1u, (flaggedByte >> b) & 1u, 0};
+        }
+    }
+}
+
+/*
+Fills in the numbers and display state of one row expanded by
+ExpandPlaneRow(), once the rows above and below it are expanded too.
+The mine bits of the padded rows around the row are added up eight
+tiles at a time; the bytes of each sum never carry into each other.
+*/
+static void CountPlaneRow(Game *game, int row, const uint8_t *revealed, const uint8_t *flagged, size_t words)
+{
+    const uint64_t mineBits = 0x0101010101010101ull * PADDED_MINE;
+
+    int cols = game->cols;
+    int stride = cols + 2;
+    size_t base = (size_t)row * cols;
+    Cell *cells = &game->cells[base];
+    uint8_t *display = &game->display[base];
+    const uint8_t *middle = &game->padded[PaddedIndex(game, row, 0)];
+    const uint8_t *above = middle - stride;
+    const uint8_t *below = middle + stride;
+
+    int c = 0;
+
+    for (; c + 8 <= cols; c += 8)
+    {
+        uint64_t word[9];
+
+        memcpy(&word[0], above + c - 1, 8);
+        memcpy(&word[1], above + c, 8);
+        memcpy(&word[2], above + c + 1, 8);
+        memcpy(&word[3], middle + c - 1, 8);
+        memcpy(&word[4], middle + c + 1, 8);
+        memcpy(&word[5], below + c - 1, 8);
+        memcpy(&word[6], below + c, 8);
+        memcpy(&word[7], below + c + 1, 8);
+        memcpy(&word[8], middle + c, 8);
+
+        uint64_t sum = 0;
+
+        for (int k = 0; k < 8; k++)
+            sum += word[k] & mineBits;
+
+        // Mines show no number
+        sum &= ~((word[8] & mineBits) / PADDED_MINE * 0xFF);
+
+        uint8_t counts[8];
+        memcpy(counts, &sum, 8);
+
+        for (int b = 0; b < 8; b++)
+            cells[c + b].nearbyMines = counts[b];
+    }
+
+    for (; c < cols; c++)
+    {
+        int around = 0;
+
+        for (int dr = -1; dr <= 1; dr++)
+        {
+            for (int dc = -1; dc <= 1; dc++)
+                around += middle[dr * stride + c + dc] & PADDED_MINE;
+        }
+
+        cells[c].nearbyMines = (middle[c] & PADDED_MINE) ? 0 : (unsigned char)around;
+    }
+
+    // Hidden tiles without a flag, again eight at a time
+    for (c = 0; c < cols; c += 64)
+    {
+        int count = (cols - c < 64) ? cols - c : 64;
+        uint64_t shown = PlaneBits(revealed, words, base + c) | PlaneBits(flagged, words, base + c);
+
+        for (int j = 0; j < count; j += 8)
+        {
+            int run = (count - j < 8) ? count - j : 8;
+
+            if (((shown >> j) & 0xFF) == 0)
+            {
+                memset(&display[c + j], DISPLAY_HIDDEN, (size_t)run);
+                continue;
+            }
+
+            for (int b = 0; b < run; b++)
+                display[c + j + b] = TileDisplay(game, (int)(base + c + j + b));
+        }
+    }
+}
+
+/*
+Job: expands the rows of bands first..end-1.
+*/
+static void ExpandBands(void *argument, int first, int end)
+{
+    const ExpandJob *job = argument;
+    int endRow = (end * EXPAND_BAND_ROWS < job->game->rows) ? end * EXPAND_BAND_ROWS : job->game->rows;
+
+    for (int r = first * EXPAND_BAND_ROWS; r < endRow; r++)
+        ExpandPlaneRow(job->game, r, job->mines, job->revealed, job->flagged, job->words);
+}
+
+/*
+Job: counts the rows of bands first..end-1. Rows on a seam read the
+next band, so it runs once every band is expanded.
+*/
+static void CountBands(void *argument, int first, int end)
+{
+    const ExpandJob *job = argument;
+    int endRow = (end * EXPAND_BAND_ROWS < job->game->rows) ? end * EXPAND_BAND_ROWS : job->game->rows;
+
+    for (int r = first * EXPAND_BAND_ROWS; r < endRow; r++)
+        CountPlaneRow(job->game, r, job->revealed, job->flagged, job->words);
+}
+
+/*
+Writes the planes onto the board in bands of rows on the shared job
+system: every band is expanded, then every band is counted.
+*/
+static void ExpandPlanes(Game *game, const uint8_t *mines, const uint8_t *revealed,
+                         const uint8_t *flagged, size_t words)
+{
+    ExpandJob job = {game, mines, revealed, flagged, words};
+    int bandCount = (game->rows + EXPAND_BAND_ROWS - 1) / EXPAND_BAND_ROWS;
+    size_t stride = (size_t)game->cols + 2;
+
+    // The ghost border of the padded board stops every flood
+    memset(game->padded, PADDED_STOP, stride);
+    memset(game->padded + (size_t)(game->rows + 1) * stride, PADDED_STOP, stride);
+
+    JobCounter expanded = {0};
+    JobCounter counted = {0};
+
+    SubmitParallelFor(NULL, ExpandBands, &job, 0, bandCount, 1, NULL, &expanded);
+    SubmitParallelFor(NULL, CountBands, &job, 0, bandCount, 1, &expanded, &counted);
+    WaitForJobs(NULL, &counted);
+}
+
+/*
+Loads a game written by SaveGameState() into an unallocated Game.
+The file is mapped rather than read, validated word by word and
+expanded straight into the board, in bands on the shared job system.
+Returns false on any mismatch.
+*/
+bool LoadGameState(Game *game, uint32_t *elapsedMs, const char *path)
+{
+    MappedFile mapped;
+
+    if (!MapFile(path, &mapped))
+        return false;
+
+    const uint8_t *header = mapped.data;
+    bool ok = mapped.size >= SAVE_HEADER_SIZE
+              && GetU32(header + 0) == SAVE_MAGIC
+              && GetU32(header + 4) >> 16 == SAVE_HEADER_SIZE
+              && (GetU32(header + 4) & 0xFFFF) >= 1 && (GetU32(header + 4) & 0xFFFF) <= SAVE_VERSION
+              && GetU32(header + 44) <= DEAL_IN_BANDS;
+
+    int rows = ok ? (int)GetU32(header + 8) : 0;
+    int cols = ok ? (int)GetU32(header + 12) : 0;
+    uint32_t status = ok ? GetU32(header + 20) : 0;
+
+    size_t cellCount = (size_t)(rows > 0 ? rows : 0) * (size_t)(cols > 0 ? cols : 0);
+    size_t words = (cellCount + 63) / 64;
+
+    ok = ok && rows > 0 && cols > 0 && status <= GAME_WON
+         && GetU64(header + 48) == words * 8
+         && mapped.size == SAVE_HEADER_SIZE + 3 * words * 8;
+
+    const uint8_t *mines = header + SAVE_HEADER_SIZE;
+    const uint8_t *revealed = mines + words * 8;
+    const uint8_t *flagged = revealed + words * 8;
+
+    ok = ok && ChecksumPlanes(mines, 3 * words) == GetU64(header + 56)
+            && ValidatePlanes(mines, revealed, flagged, words, cellCount, header);
+
+    ok = ok && AllocateGame(game, rows, cols, (int)GetU32(header + 16));
+
+    if (!ok)
+    {
+        UnmapFile(&mapped);
+        return false;
+    }
+
+    // Before the tiles, whose display state depends on it
+    game->status = (GameStatus)status;
+
+    ExpandPlanes(game, mines, revealed, flagged, words);
+
+    game->seed = GetU64(header + 24);
+    game->deal = (DealMethod)GetU32(header + 44);
+    game->revealedSafe = (int)GetU32(header + 32);
+    game->flaggedCount = (int)GetU32(header + 36);
+    *elapsedMs = GetU32(header + 40);
+
+    UnmapFile(&mapped);
+
+    return true;
+}
@@ -0,0 +1,29 @@
+
+// =============================================================
+// Saved games
+// Versioned, bit-packed snapshot of a game in progress that is
+// memory-mapped on load, so even huge boards restore quickly
+// =============================================================
+
+#ifndef SAVEGAME_H
+#define SAVEGAME_H
+
+#include "engine.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// File identification
+#define SAVE_MAGIC 0x5653534Du     // "MSSV" read as little-endian
+#define SAVE_VERSION 2
+
+// Size of the fixed header; the bit planes follow it
+#define SAVE_HEADER_SIZE 64
+
+// -------------------- Function Prototypes --------------------
+
+bool SaveGameState(const Game *game, uint32_t elapsedMs, const char *path);
+bool LoadGameState(Game *game, uint32_t *elapsedMs, const char *path);
+
+#endif
@@ -0,0 +1,1327 @@
+
+// =============================================================
+// Solver
+//
+// Every opened number gives a constraint over its hidden
+// neighbours. Two rules are applied until nothing changes:
+//   - single: a number whose mines are all placed (or whose
+//     hidden neighbours are all mines) settles every neighbour
+//   - pair: two numbers up to two tiles apart share neighbours;
+//     bounding the mines in the shared part settles the rest
+//     (this covers the subset rule and patterns like 1-2)
+// Neighbour sets of both numbers are placed in one 8x8 window
+// as 64-bit masks, so a pair test is a few AND and popcounts.
+// Before the pair rule, a row of 3 or 4 numbers against a wall
+// of hidden tiles (1-2-1, 1-2-2-1 and the like) is resolved with
+// one lookup in a table generated by tools/generate_patterns.c,
+// which also writes the table spreading 3x3 masks into the window.
+// Between calls on the same game only numbers near newly opened
+// tiles are rechecked; everything else is already at a fixpoint.
+//
+// The linear pass goes further: the numbers of a frontier region
+// become rows of a matrix over its hidden tiles, reduced by
+// Gaussian elimination. A row is kept as two bitsets (tiles with
+// coefficient +1 and -1) and its total; a reduction that would
+// need a coefficient of 2 is skipped, so every row stays a true
+// equation. A reduced row whose total equals the sum of its
+// positive part (or minus the sum of its negative part) can only
+// be met one way, which settles every tile in it.
+//
+// Boards of other topologies (see topology.h) run both rules over
+// their adjacency lists instead: a constraint's mask indexes its
+// tile's neighbour list, and the pair rule finds shared tiles by
+// marking the hidden neighbours of one number. The wall patterns
+// and the linear pass assume the square grid and are skipped.
+// =============================================================
+
+#include "solver.h"
+#include "pattern_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Window position of the constraint being examined (the spread table
+// in pattern_table.h is generated for the same window)
+#define WINDOW_CENTER 3
+#define WINDOW_STRIDE 8
+
+// Ways a strip of numbers can run: step along it, then side of its wall
+static const int stripDirections[4][4] = {
+    {0, 1, -1, 0},      // Row of numbers, wall above
+    {0, 1, 1, 0},       // Row of numbers, wall below
+    {1, 0, 0, -1},      // Column of numbers, wall on the left
+    {1, 0, 0, 1}        // Column of numbers, wall on the right
+};
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Prepares an empty solver.
+*/
+void InitSolver(Solver *solver)
+{
+    memset(solver, 0, sizeof(*solver));
+}
+
+/*
+Releases the solver memory.
+*/
+void FreeSolver(Solver *solver)
+{
+    free(solver->knowledge);
+    free(solver->constraintAt);
+    free(solver->tileMark);
+    free(solver->constraints);
+    free(solver->pending);
+    free(solver->queued);
+    free(solver->safe);
+    free(solver->mines);
+    free(solver->variableOf);
+    free(solver->groupCells);
+    free(solver->groupNumbers);
+    free(solver->grouped);
+
+    memset(solver, 0, sizeof(*solver));
+}
+
+/*
+Makes sure the per-tile arrays can hold the given board, so solving
+it needs no heap allocation. Returns false if memory runs out.
+*/
+bool ReserveSolver(Solver *solver, int cellCount)
+{
+    if (cellCount <= solver->cellCapacity)
+        return true;
+
+    FreeSolver(solver);
+
+    solver->knowledge = CountedMalloc((size_t)cellCount);
+    solver->constraintAt = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->tileMark = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->constraints = CountedMalloc((size_t)cellCount * sizeof(SolverConstraint));
+    solver->pending = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->queued = CountedMalloc((size_t)cellCount * sizeof(bool));
+    solver->safe = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->mines = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->variableOf = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->groupCells = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->groupNumbers = CountedMalloc((size_t)cellCount * sizeof(int));
+    solver->grouped = CountedMalloc((size_t)cellCount * sizeof(bool));
+
+    if (!solver->knowledge || !solver->constraintAt || !solver->tileMark || !solver->constraints || !solver->pending
+        || !solver->queued || !solver->safe || !solver->mines || !solver->variableOf
+        || !solver->groupCells || !solver->groupNumbers || !solver->grouped)
+    {
+        FreeSolver(solver);
+        return false;
+    }
+
+    for (int i = 0; i < cellCount; i++)
+        solver->variableOf[i] = -1;
+
+    solver->cellCapacity = cellCount;
+    solver->constraintCapacity = cellCount;
+
+    return true;
+}
+
+// =============================================================
+//                        BOOKKEEPING
+// =============================================================
+
+/*
+Schedules a constraint to be examined again.
+*/
+static void Enqueue(Solver *solver, int index)
+{
+    if (index >= 0 && !solver->queued[index])
+    {
+        solver->queued[index] = true;
+        solver->pending[solver->pendingCount++] = index;
+    }
+}
+
+/*
+Records a deduction and wakes up the numbers around the tile.
+*/
+static void Settle(Solver *solver, const Game *game, int row, int col, uint8_t value)
+{
+    int index = row * game->cols + col;
+
+    if (solver->knowledge[index] != SOLVER_UNKNOWN)
+        return;
+
+    solver->knowledge[index] = value;
+
+    if (value == SOLVER_SAFE)
+        solver->safe[solver->safeCount++] = index;
+    else
+        solver->mines[solver->mineCount++] = index;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (InsideBoard(game, row + dr, col + dc))
+                Enqueue(solver, solver->constraintAt[index + dr * game->cols + dc]);
+        }
+    }
+}
+
+/*
+Drops neighbours that have been settled since the constraint was
+last looked at, counting newly known mines against it.
+*/
+static void Refresh(Solver *solver, const Game *game, SolverConstraint *constraint)
+{
+    uint16_t mask = constraint->mask;
+
+    while (mask != 0)
+    {
+        int bit = __builtin_ctz(mask);
+        mask &= (uint16_t)(mask - 1);
+
+        int index = (constraint->row + bit / 3 - 1) * game->cols + (constraint->col + bit % 3 - 1);
+        uint8_t known = solver->knowledge[index];
+
+        if (known != SOLVER_UNKNOWN)
+        {
+            constraint->mask &= (uint16_t)~(1u << bit);
+
+            if (known == SOLVER_MINE)
+                constraint->mines--;
+        }
+    }
+}
+
+/*
+Settles every tile of a window mask.
+*/
+static void SettleWindow(Solver *solver, const Game *game, const SolverConstraint *origin,
+                         uint64_t window, uint8_t value)
+{
+    while (window != 0)
+    {
+        int bit = __builtin_ctzll(window);
+        window &= window - 1;
+
+        int row = origin->row + bit / WINDOW_STRIDE - WINDOW_CENTER;
+        int col = origin->col + bit % WINDOW_STRIDE - WINDOW_CENTER;
+
+        Settle(solver, game, row, col, value);
+    }
+}
+
+// =============================================================
+//                           RULES
+// =============================================================
+
+/*
+Single-number rule.
+*/
+static void ApplySingleRule(Solver *solver, const Game *game, const SolverConstraint *constraint)
+{
+    int hidden = __builtin_popcount(constraint->mask);
+
+    if (hidden == 0 || (constraint->mines != 0 && constraint->mines != hidden))
+        return;
+
+    uint8_t value = (constraint->mines == 0) ? SOLVER_SAFE : SOLVER_MINE;
+
+    SettleWindow(solver, game, constraint, spreadTable[constraint->mask], value);
+}
+
+/*
+Pair rule between constraint a and a nearby constraint b.
+The shared part holds between low and high mines; whatever that
+forces on the parts owned by only one of them is settled.
+*/
+static void ApplyPairRule(Solver *solver, const Game *game,
+                          const SolverConstraint *a, const SolverConstraint *b)
+{
+    int shift = (b->row - a->row) * WINDOW_STRIDE + (b->col - a->col);
+
+    uint64_t maskA = spreadTable[a->mask];
+    uint64_t maskB = (shift >= 0) ? spreadTable[b->mask] << shift
+                                  : spreadTable[b->mask] >> -shift;
+
+    uint64_t shared = maskA & maskB;
+
+    if (shared == 0)
+        return;
+
+    uint64_t onlyA = maskA & ~maskB;
+    uint64_t onlyB = maskB & ~maskA;
+
+    int sizeShared = __builtin_popcountll(shared);
+    int sizeA = __builtin_popcountll(onlyA);
+    int sizeB = __builtin_popcountll(onlyB);
+
+    int low = 0;
+    int high = sizeShared;
+
+    if (a->mines - sizeA > low)
+        low = a->mines - sizeA;
+    if (b->mines - sizeB > low)
+        low = b->mines - sizeB;
+    if (a->mines < high)
+        high = a->mines;
+    if (b->mines < high)
+        high = b->mines;
+
+    if (onlyA != 0)
+    {
+        if (a->mines - low == 0)
+            SettleWindow(solver, game, a, onlyA, SOLVER_SAFE);
+        else if (a->mines - high == sizeA)
+            SettleWindow(solver, game, a, onlyA, SOLVER_MINE);
+    }
+
+    if (onlyB != 0)
+    {
+        if (b->mines - low == 0)
+            SettleWindow(solver, game, a, onlyB, SOLVER_SAFE);
+        else if (b->mines - high == sizeB)
+            SettleWindow(solver, game, a, onlyB, SOLVER_MINE);
+    }
+}
+
+/*
+Neighbour mask bit of the wall tile at offset t (-1, 0, 1) along a strip.
+*/
+static int WallBit(int direction, int t)
+{
+    const int *d = stripDirections[direction];
+
+    return (d[2] + t * d[0] + 1) * 3 + (d[3] + t * d[1] + 1);
+}
+
+/*
+Packs the state of a strip of count numbers starting at (row, col).
+Returns false unless every tile is an opened number whose unknown
+neighbours all lie on the wall.
+*/
+static bool ReadStrip(Solver *solver, const Game *game, int direction,
+                      int row, int col, int count, unsigned *state)
+{
+    const int *d = stripDirections[direction];
+    unsigned wallMask = (1u << WallBit(direction, -1)) | (1u << WallBit(direction, 0))
+                        | (1u << WallBit(direction, 1));
+    unsigned missing = 0;
+    unsigned unknown = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int r = row + i * d[0];
+        int c = col + i * d[1];
+
+        if (!InsideBoard(game, r, c) || solver->knowledge[r * game->cols + c] != SOLVER_OPEN)
+            return false;
+
+        // Opened tiles without a constraint have nothing unknown around them
+        int index = solver->constraintAt[r * game->cols + c];
+
+        if (index < 0)
+            continue;
+
+        SolverConstraint *constraint = &solver->constraints[index];
+        Refresh(solver, game, constraint);
+
+        if (constraint->mask & ~wallMask)
+            return false;
+
+        missing |= (unsigned)constraint->mines << (2 * i);
+
+        for (int t = -1; t <= 1; t++)
+        {
+            if (constraint->mask & (1u << WallBit(direction, t)))
+                unknown |= 1u << (i + t + 1);
+        }
+    }
+
+    *state = missing | (unknown << (2 * count));
+
+    return true;
+}
+
+/*
+Looks up every strip of 4 (or, if none can be read, of 3) numbers
+through the constraint. Returns true once a lookup settles tiles.
+*/
+static bool ApplyPatterns(Solver *solver, const Game *game, const SolverConstraint *constraint)
+{
+    for (int direction = 0; direction < 4; direction++)
+    {
+        const int *d = stripDirections[direction];
+        unsigned wallMask = (1u << WallBit(direction, -1)) | (1u << WallBit(direction, 0))
+                            | (1u << WallBit(direction, 1));
+
+        if (constraint->mask & ~wallMask)
+            continue;
+
+        // A longer strip forces everything its shorter parts do
+        bool readLong = false;
+
+        for (int count = 4; count >= 3 && !readLong; count--)
+        {
+            for (int offset = 0; offset < count; offset++)
+            {
+                int row = constraint->row - offset * d[0];
+                int col = constraint->col - offset * d[1];
+                unsigned state;
+
+                if (!ReadStrip(solver, game, direction, row, col, count, &state))
+                    continue;
+
+                readLong = (count == 4);
+
+                uint16_t entry = (count == 4) ? patternTable4[state] : patternTable3[state];
+
+                if (entry == 0)
+                    continue;
+
+                for (int j = 0; j < count + 2; j++)
+                {
+                    int r = row + d[2] + (j - 1) * d[0];
+                    int c = col + d[3] + (j - 1) * d[1];
+
+                    if (entry & (1u << j))
+                        Settle(solver, game, r, c, SOLVER_SAFE);
+                    else if (entry & (0x100u << j))
+                        Settle(solver, game, r, c, SOLVER_MINE);
+                }
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// =============================================================
+//                       LINEAR ALGEBRA
+// =============================================================
+
+/*
+Gathers numbers connected through shared hidden tiles, starting
+from one constraint, until the column limit is reached. Numbers
+left out start groups of their own later. Returns the row count.
+*/
+static int GatherGroup(Solver *solver, const Game *game, int start, int *variableCount)
+{
+    int rowCount = 0;
+
+    *variableCount = 0;
+    solver->grouped[start] = true;
+    solver->groupNumbers[rowCount++] = start;
+
+    for (int head = 0; head < rowCount; head++)
+    {
+        const SolverConstraint *constraint = &solver->constraints[solver->groupNumbers[head]];
+        uint16_t mask = constraint->mask;
+
+        while (mask != 0)
+        {
+            int bit = __builtin_ctz(mask);
+            mask &= (uint16_t)(mask - 1);
+
+            int row = constraint->row + bit / 3 - 1;
+            int col = constraint->col + bit % 3 - 1;
+            int tile = row * game->cols + col;
+
+            if (solver->variableOf[tile] >= 0)
+                continue;
+
+            solver->variableOf[tile] = *variableCount;
+            solver->groupCells[(*variableCount)++] = tile;
+
+            if (*variableCount >= SOLVER_MAX_LINEAR_VARIABLES)
+                continue;
+
+            // Other numbers around this tile join the group
+            for (int dr = -1; dr <= 1; dr++)
+            {
+                for (int dc = -1; dc <= 1; dc++)
+                {
+                    if (!InsideBoard(game, row + dr, col + dc))
+                        continue;
+
+                    int other = solver->constraintAt[tile + dr * game->cols + dc];
+
+                    if (other < 0 || solver->grouped[other])
+                        continue;
+
+                    Refresh(solver, game, &solver->constraints[other]);
+
+                    if (solver->constraints[other].mask != 0)
+                    {
+                        solver->grouped[other] = true;
+                        solver->groupNumbers[rowCount++] = other;
+                    }
+                }
+            }
+        }
+    }
+
+    return rowCount;
+}
+
+/*
+Takes a matrix of the given size from the game's arena. The caller
+rewinds the arena once the matrix is done with.
+*/
+static bool ReserveMatrix(Solver *solver, Game *game, int rowCount, int wordCount)
+{
+    solver->matrix = ArenaAlloc(game->arena, (size_t)rowCount * 2 * wordCount * sizeof(uint64_t));
+    solver->matrixTotals = ArenaAlloc(game->arena, (size_t)rowCount * sizeof(int));
+
+    return solver->matrix != NULL && solver->matrixTotals != NULL;
+}
+
+/*
+Fills one matrix row per number: +1 on each hidden neighbour.
+*/
+static void BuildMatrix(Solver *solver, const Game *game, int rowCount, int wordCount)
+{
+    memset(solver->matrix, 0, (size_t)rowCount * 2 * wordCount * sizeof(uint64_t));
+
+    for (int r = 0; r < rowCount; r++)
+    {
+        const SolverConstraint *constraint = &solver->constraints[solver->groupNumbers[r]];
+        uint64_t *plus = solver->matrix + (size_t)r * 2 * wordCount;
+        uint16_t mask = constraint->mask;
+
+        while (mask != 0)
+        {
+            int bit = __builtin_ctz(mask);
+            mask &= (uint16_t)(mask - 1);
+
+            int tile = (constraint->row + bit / 3 - 1) * game->cols + (constraint->col + bit % 3 - 1);
+            int column = solver->variableOf[tile];
+
+            plus[column >> 6] |= 1ull << (column & 63);
+        }
+
+        solver->matrixTotals[r] = constraint->mines;
+    }
+}
+
+/*
+Reduces the matrix column by column. Each pivot row is scaled to +1
+and subtracted from (or added to) the other rows that use the column,
+unless that would leave a coefficient of 2 somewhere in them.
+*/
+static void EliminateMatrix(Solver *solver, int rowCount, int variableCount, int wordCount)
+{
+    size_t stride = 2 * (size_t)wordCount;
+    int rank = 0;
+
+    for (int column = 0; column < variableCount && rank < rowCount; column++)
+    {
+        int word = column >> 6;
+        uint64_t bit = 1ull << (column & 63);
+        int pivot = -1;
+
+        for (int r = rank; r < rowCount; r++)
+        {
+            const uint64_t *row = solver->matrix + r * stride;
+
+            if ((row[word] | row[wordCount + word]) & bit)
+            {
+                pivot = r;
+                break;
+            }
+        }
+
+        if (pivot < 0)
+            continue;
+
+        uint64_t *top = solver->matrix + rank * stride;
+        uint64_t *pivotRow = solver->matrix + pivot * stride;
+
+        if (pivot != rank)
+        {
+            for (size_t w = 0; w < stride; w++)
+            {
+                uint64_t swap = top[w];
+                top[w] = pivotRow[w];
+                pivotRow[w] = swap;
+            }
+
+            int swapTotal = solver->matrixTotals[rank];
+            solver->matrixTotals[rank] = solver->matrixTotals[pivot];
+            solver->matrixTotals[pivot] = swapTotal;
+        }
+
+        // Scale the pivot row so the column has coefficient +1
+        if (top[wordCount + word] & bit)
+        {
+            for (int w = 0; w < wordCount; w++)
+            {
+                uint64_t swap = top[w];
+                top[w] = top[wordCount + w];
+                top[wordCount + w] = swap;
+            }
+
+            solver->matrixTotals[rank] = -solver->matrixTotals[rank];
+        }
+
+        for (int r = 0; r < rowCount; r++)
+        {
+            uint64_t *row = solver->matrix + r * stride;
+
+            if (r == rank || !((row[word] | row[wordCount + word]) & bit))
+                continue;
+
+            // Subtract the pivot row times the row's own coefficient
+            bool positive = (row[word] & bit) != 0;
+            const uint64_t *subPlus = positive ? top : top + wordCount;
+            const uint64_t *subMinus = positive ? top + wordCount : top;
+            uint64_t clash = 0;
+
+            for (int w = 0; w < wordCount; w++)
+                clash |= (row[w] & subMinus[w]) | (row[wordCount + w] & subPlus[w]);
+
+            if (clash != 0)
+                continue;
+
+            for (int w = 0; w < wordCount; w++)
+            {
+                uint64_t plus = row[w];
+                uint64_t minus = row[wordCount + w];
+
+                row[w] = (plus & ~subPlus[w]) | (subMinus[w] & ~minus);
+                row[wordCount + w] = (minus & ~subMinus[w]) | (subPlus[w] & ~plus);
+            }
+
+            solver->matrixTotals[r] -= positive ? solver->matrixTotals[rank] : -solver->matrixTotals[rank];
+        }
+
+        rank++;
+    }
+}
+
+/*
+Settles the tiles of every row that can only be met one way.
+Returns the number of tiles settled.
+*/
+static int ApplyRowBounds(Solver *solver, const Game *game, int rowCount, int wordCount)
+{
+    size_t stride = 2 * (size_t)wordCount;
+    int settled = 0;
+
+    for (int r = 0; r < rowCount; r++)
+    {
+        const uint64_t *plus = solver->matrix + r * stride;
+        const uint64_t *minus = plus + wordCount;
+        int plusCount = 0;
+        int minusCount = 0;
+
+        for (int w = 0; w < wordCount; w++)
+        {
+            plusCount += __builtin_popcountll(plus[w]);
+            minusCount += __builtin_popcountll(minus[w]);
+        }
+
+        int total = solver->matrixTotals[r];
+        uint8_t plusValue;
+
+        if (plusCount + minusCount == 0)
+            continue;
+        else if (total == plusCount)
+            plusValue = SOLVER_MINE;
+        else if (total == -minusCount)
+            plusValue = SOLVER_SAFE;
+        else
+            continue;
+
+        uint8_t minusValue = (plusValue == SOLVER_MINE) ? SOLVER_SAFE : SOLVER_MINE;
+
+        for (int w = 0; w < wordCount; w++)
+        {
+            for (int side = 0; side < 2; side++)
+            {
+                uint64_t bits = side ? minus[w] : plus[w];
+
+                while (bits != 0)
+                {
+                    int tile = solver->groupCells[w * 64 + __builtin_ctzll(bits)];
+                    bits &= bits - 1;
+
+                    if (solver->knowledge[tile] == SOLVER_UNKNOWN)
+                    {
+                        Settle(solver, game, tile / game->cols, tile % game->cols,
+                               side ? minusValue : plusValue);
+                        settled++;
+                    }
+                }
+            }
+        }
+    }
+
+    return settled;
+}
+
+/*
+One elimination round over every frontier region.
+Returns the number of tiles settled, or -1 if memory runs out.
+*/
+static int LinearPass(Solver *solver, Game *game)
+{
+    ArenaMark scratch = ArenaPosition(game->arena);
+    int settled = 0;
+
+    for (int i = 0; i < solver->constraintCount; i++)
+        solver->grouped[i] = false;
+
+    for (int start = 0; start < solver->constraintCount; start++)
+    {
+        if (solver->grouped[start])
+            continue;
+
+        Refresh(solver, game, &solver->constraints[start]);
+
+        if (solver->constraints[start].mask == 0)
+            continue;
+
+        int variableCount;
+        int rowCount = GatherGroup(solver, game, start, &variableCount);
+        int wordCount = (variableCount + 63) / 64;
+
+        RewindArena(game->arena, scratch);
+
+        if (!ReserveMatrix(solver, game, rowCount, wordCount))
+            settled = -1;
+        else if (settled >= 0)
+        {
+            BuildMatrix(solver, game, rowCount, wordCount);
+            EliminateMatrix(solver, rowCount, variableCount, wordCount);
+
+            // Columns refer to groupCells until the map is cleared below
+            settled += ApplyRowBounds(solver, game, rowCount, wordCount);
+        }
+
+        for (int v = 0; v < variableCount; v++)
+            solver->variableOf[solver->groupCells[v]] = -1;
+
+        if (settled < 0)
+            break;
+    }
+
+    RewindArena(game->arena, scratch);
+    solver->matrix = NULL;
+    solver->matrixTotals = NULL;
+
+    return settled;
+}
+
+// =============================================================
+//                      OTHER TOPOLOGIES
+// =============================================================
+
+/*
+Settle() for a board with adjacency lists.
+*/
+static void SettleAdjacent(Solver *solver, const Game *game, int index, uint8_t value)
+{
+    if (solver->knowledge[index] != SOLVER_UNKNOWN)
+        return;
+
+    solver->knowledge[index] = value;
+
+    if (value == SOLVER_SAFE)
+        solver->safe[solver->safeCount++] = index;
+    else
+        solver->mines[solver->mineCount++] = index;
+
+    int degree;
+    const int *neighbours = TileNeighbours(game->adjacency, index, &degree);
+
+    for (int k = 0; k < degree; k++)
+        Enqueue(solver, solver->constraintAt[neighbours[k]]);
+}
+
+/*
+Refresh() for a board with adjacency lists.
+*/
+static void RefreshAdjacent(Solver *solver, const Game *game, SolverConstraint *constraint)
+{
+    int degree;
+    const int *neighbours = TileNeighbours(game->adjacency, constraint->row * game->cols + constraint->col, &degree);
+    uint32_t mask = constraint->mask;
+
+    while (mask != 0)
+    {
+        int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        uint8_t known = solver->knowledge[neighbours[bit]];
+
+        if (known != SOLVER_UNKNOWN)
+        {
+            constraint->mask &= ~(1u << bit);
+
+            if (known == SOLVER_MINE)
+                constraint->mines--;
+        }
+    }
+}
+
+/*
+Settles the neighbours of a constraint's tile picked by a mask.
+*/
+static void SettleAdjacentMask(Solver *solver, const Game *game, const SolverConstraint *constraint,
+                               uint32_t mask, uint8_t value)
+{
+    int degree;
+    const int *neighbours = TileNeighbours(game->adjacency, constraint->row * game->cols + constraint->col, &degree);
+
+    while (mask != 0)
+    {
+        int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        SettleAdjacent(solver, game, neighbours[bit], value);
+    }
+}
+
+/*
+Bits of a's mask whose tiles are not hidden neighbours of b.
+*/
+static uint32_t OnlyInFirst(const Game *game, const SolverConstraint *a, const SolverConstraint *b)
+{
+    int degreeA;
+    int degreeB;
+    const int *neighboursA = TileNeighbours(game->adjacency, a->row * game->cols + a->col, &degreeA);
+    const int *neighboursB = TileNeighbours(game->adjacency, b->row * game->cols + b->col, &degreeB);
+    uint32_t only = 0;
+
+    for (int i = 0; i < degreeA; i++)
+    {
+        if (!(a->mask & (1u << i)))
+            continue;
+
+        bool shared = false;
+
+        for (int j = 0; j < degreeB && !shared; j++)
+            shared = (b->mask & (1u << j)) && neighboursB[j] == neighboursA[i];
+
+        if (!shared)
+            only |= 1u << i;
+    }
+
+    return only;
+}
+
+/*
+ApplyPairRule() for a board with adjacency lists. The hidden
+neighbours of a must be marked with its index in tileMark.
+*/
+static void ApplyAdjacentPairRule(Solver *solver, const Game *game, int indexA,
+                                  const SolverConstraint *a, const SolverConstraint *b)
+{
+    int degree;
+    const int *neighbours = TileNeighbours(game->adjacency, b->row * game->cols + b->col, &degree);
+    uint32_t sharedB = 0;
+    uint32_t mask = b->mask;
+
+    while (mask != 0)
+    {
+        int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        if (solver->tileMark[neighbours[bit]] == indexA)
+            sharedB |= 1u << bit;
+    }
+
+    if (sharedB == 0)
+        return;
+
+    uint32_t onlyB = b->mask & ~sharedB;
+
+    int sizeShared = __builtin_popcount(sharedB);
+    int sizeA = __builtin_popcount(a->mask) - sizeShared;
+    int sizeB = __builtin_popcount(onlyB);
+
+    int low = 0;
+    int high = sizeShared;
+
+    if (a->mines - sizeA > low)
+        low = a->mines - sizeA;
+    if (b->mines - sizeB > low)
+        low = b->mines - sizeB;
+    if (a->mines < high)
+        high = a->mines;
+    if (b->mines < high)
+        high = b->mines;
+
+    if (sizeA > 0 && (a->mines - low == 0 || a->mines - high == sizeA))
+    {
+        SettleAdjacentMask(solver, game, a, OnlyInFirst(game, a, b),
+                           (a->mines - low == 0) ? SOLVER_SAFE : SOLVER_MINE);
+    }
+
+    if (onlyB != 0)
+    {
+        if (b->mines - low == 0)
+            SettleAdjacentMask(solver, game, b, onlyB, SOLVER_SAFE);
+        else if (b->mines - high == sizeB)
+            SettleAdjacentMask(solver, game, b, onlyB, SOLVER_MINE);
+    }
+}
+
+/*
+AddConstraint() for a board with adjacency lists.
+*/
+static void AddAdjacentConstraint(Solver *solver, const Game *game, int index)
+{
+    const Cell *cell = &game->cells[index];
+
+    if (cell->hasMine)
+        return;
+
+    int degree;
+    const int *neighbours = TileNeighbours(game->adjacency, index, &degree);
+    uint32_t mask = 0;
+    int mines = cell->nearbyMines;
+
+    for (int k = 0; k < degree; k++)
+    {
+        uint8_t known = solver->knowledge[neighbours[k]];
+
+        if (known == SOLVER_UNKNOWN)
+            mask |= 1u << k;
+        else if (known == SOLVER_MINE)
+            mines--;
+    }
+
+    if (mask == 0)
+        return;
+
+    int constraint = solver->constraintCount++;
+
+    solver->constraints[constraint].row = index / game->cols;
+    solver->constraints[constraint].col = index % game->cols;
+    solver->constraints[constraint].mask = mask;
+    solver->constraints[constraint].mines = mines;
+
+    solver->constraintAt[index] = constraint;
+    solver->queued[constraint] = false;
+
+    Enqueue(solver, constraint);
+}
+
+/*
+Runs both rules on the scheduled constraints of a board with
+adjacency lists until nothing changes. Pair candidates are the
+numbers around each hidden neighbour.
+*/
+static void PropagateAdjacent(Solver *solver, const Game *game)
+{
+    while (solver->pendingCount > 0)
+    {
+        int index = solver->pending[--solver->pendingCount];
+        solver->queued[index] = false;
+
+        SolverConstraint *constraint = &solver->constraints[index];
+        RefreshAdjacent(solver, game, constraint);
+
+        int hidden = __builtin_popcount(constraint->mask);
+
+        if (hidden == 0)
+            continue;
+
+        if (constraint->mines == 0 || constraint->mines == hidden)
+        {
+            SettleAdjacentMask(solver, game, constraint, constraint->mask,
+                               (constraint->mines == 0) ? SOLVER_SAFE : SOLVER_MINE);
+            continue;
+        }
+
+        // Copy the hidden neighbours: the mask shrinks as tiles settle
+        int degree;
+        const int *neighbours = TileNeighbours(game->adjacency, constraint->row * game->cols + constraint->col, &degree);
+        int hiddenTiles[TOPOLOGY_MAX_DEGREE];
+        int hiddenCount = 0;
+
+        for (int k = 0; k < degree; k++)
+        {
+            if (constraint->mask & (1u << k))
+            {
+                hiddenTiles[hiddenCount++] = neighbours[k];
+                solver->tileMark[neighbours[k]] = index;
+            }
+        }
+
+        for (int h = 0; h < hiddenCount && constraint->mask != 0; h++)
+        {
+            int around;
+            const int *others = TileNeighbours(game->adjacency, hiddenTiles[h], &around);
+
+            for (int k = 0; k < around && constraint->mask != 0; k++)
+            {
+                int other = solver->constraintAt[others[k]];
+
+                if (other < 0 || other == index)
+                    continue;
+
+                SolverConstraint *neighbour = &solver->constraints[other];
+                RefreshAdjacent(solver, game, neighbour);
+
+                if (neighbour->mask != 0)
+                {
+                    ApplyAdjacentPairRule(solver, game, index, constraint, neighbour);
+                    RefreshAdjacent(solver, game, constraint);
+                }
+            }
+        }
+    }
+}
+
+/*
+SolveBoard() for a board with adjacency lists. Deductions are not
+kept between calls: every call starts from the opened numbers.
+*/
+static void SolveAdjacent(Solver *solver, const Game *game)
+{
+    int cellCount = game->rows * game->cols;
+
+    solver->warm = false;
+    solver->constraintCount = 0;
+    solver->pendingCount = 0;
+    solver->safeCount = 0;
+    solver->mineCount = 0;
+
+    for (int i = 0; i < cellCount; i++)
+    {
+        solver->knowledge[i] = game->cells[i].revealed ? SOLVER_OPEN : SOLVER_UNKNOWN;
+        solver->constraintAt[i] = -1;
+        solver->tileMark[i] = -1;
+    }
+
+    for (int i = 0; i < cellCount; i++)
+    {
+        if (game->cells[i].revealed)
+            AddAdjacentConstraint(solver, game, i);
+    }
+
+    PropagateAdjacent(solver, game);
+}
+
+// =============================================================
+//                         DEDUCTION
+// =============================================================
+
+/*
+Creates the constraint of an opened number if it touches tiles
+that are not settled yet, and schedules it.
+*/
+static void AddConstraint(Solver *solver, const Game *game, int row, int col)
+{
+    const Cell *cell = GameCell(game, row, col);
+
+    if (cell->hasMine)
+        return;
+
+    uint16_t mask = 0;
+    int mines = cell->nearbyMines;
+
+    for (int dr = -1; dr <= 1; dr++)
+    {
+        for (int dc = -1; dc <= 1; dc++)
+        {
+            if (!InsideBoard(game, row + dr, col + dc))
+                continue;
+
+            uint8_t known = solver->knowledge[(row + dr) * game->cols + (col + dc)];
+
+            if (known == SOLVER_UNKNOWN)
+                mask |= (uint16_t)(1u << ((dr + 1) * 3 + (dc + 1)));
+            else if (known == SOLVER_MINE)
+                mines--;
+        }
+    }
+
+    if (mask == 0)
+        return;
+
+    int index = solver->constraintCount++;
+
+    solver->constraints[index].row = row;
+    solver->constraints[index].col = col;
+    solver->constraints[index].mask = mask;
+    solver->constraints[index].mines = mines;
+
+    solver->constraintAt[row * game->cols + col] = index;
+    solver->queued[index] = false;
+
+    Enqueue(solver, index);
+}
+
+/*
+Forgets all deductions and builds one constraint per opened number.
+Flags are ignored: they are the player's guesses, not facts.
+*/
+static void CollectConstraints(Solver *solver, const Game *game)
+{
+    int cellCount = game->rows * game->cols;
+
+    solver->constraintCount = 0;
+    solver->pendingCount = 0;
+    solver->safeCount = 0;
+    solver->mineCount = 0;
+
+    for (int i = 0; i < cellCount; i++)
+    {
+        solver->knowledge[i] = game->cells[i].revealed ? SOLVER_OPEN : SOLVER_UNKNOWN;
+        solver->constraintAt[i] = -1;
+    }
+
+    for (int r = 0; r < game->rows; r++)
+    {
+        for (int c = 0; c < game->cols; c++)
+        {
+            if (GameCell(game, r, c)->revealed)
+                AddConstraint(solver, game, r, c);
+        }
+    }
+
+    solver->warm = true;
+    solver->seed = game->seed;
+    solver->rows = game->rows;
+    solver->cols = game->cols;
+}
+
+/*
+Brings warm knowledge up to date with the board: tiles opened since
+the last call become constraints and wake their neighbours.
+Returns false if a tile was hidden again (undo, load), in which case
+the caller starts over.
+*/
+static bool UpdateConstraints(Solver *solver, const Game *game)
+{
+    if (!solver->warm || solver->seed != game->seed
+        || solver->rows != game->rows || solver->cols != game->cols)
+        return false;
+
+    int cellCount = game->rows * game->cols;
+
+    for (int i = 0; i < cellCount; i++)
+    {
+        bool wasOpen = (solver->knowledge[i] == SOLVER_OPEN);
+
+        if (game->cells[i].revealed == wasOpen)
+            continue;
+
+        if (wasOpen || solver->knowledge[i] == SOLVER_MINE)
+            return false;
+
+        solver->knowledge[i] = SOLVER_OPEN;
+
+        int row = i / game->cols;
+        int col = i % game->cols;
+
+        for (int dr = -1; dr <= 1; dr++)
+        {
+            for (int dc = -1; dc <= 1; dc++)
+            {
+                if (InsideBoard(game, row + dr, col + dc))
+                    Enqueue(solver, solver->constraintAt[i + dr * game->cols + dc]);
+            }
+        }
+
+        // Neighbours opened later in this scan are dropped by Refresh
+        AddConstraint(solver, game, row, col);
+    }
+
+    return true;
+}
+
+/*
+Removes results that the player has opened since they were found.
+*/
+static void DropOpenedResults(Solver *solver)
+{
+    int kept = 0;
+
+    for (int i = 0; i < solver->safeCount; i++)
+    {
+        if (solver->knowledge[solver->safe[i]] == SOLVER_SAFE)
+            solver->safe[kept++] = solver->safe[i];
+    }
+
+    solver->safeCount = kept;
+}
+
+/*
+Runs both rules on the scheduled constraints until nothing changes.
+*/
+static void Propagate(Solver *solver, const Game *game)
+{
+    while (solver->pendingCount > 0)
+    {
+        int index = solver->pending[--solver->pendingCount];
+        solver->queued[index] = false;
+
+        SolverConstraint *constraint = &solver->constraints[index];
+        Refresh(solver, game, constraint);
+
+        if (constraint->mask == 0)
+            continue;
+
+        ApplySingleRule(solver, game, constraint);
+        Refresh(solver, game, constraint);
+
+        if (constraint->mask != 0 && ApplyPatterns(solver, game, constraint))
+            Refresh(solver, game, constraint);
+
+        // Numbers up to two tiles away can share hidden neighbours
+        for (int dr = -2; dr <= 2 && constraint->mask != 0; dr++)
+        {
+            for (int dc = -2; dc <= 2; dc++)
+            {
+                int r = constraint->row + dr;
+                int c = constraint->col + dc;
+
+                if ((dr == 0 && dc == 0) || !InsideBoard(game, r, c))
+                    continue;
+
+                int other = solver->constraintAt[r * game->cols + c];
+
+                if (other < 0)
+                    continue;
+
+                SolverConstraint *neighbour = &solver->constraints[other];
+                Refresh(solver, game, neighbour);
+
+                if (neighbour->mask != 0)
+                {
+                    ApplyPairRule(solver, game, constraint, neighbour);
+                    Refresh(solver, game, constraint);
+
+                    if (constraint->mask == 0)
+                        break;
+                }
+            }
+        }
+    }
+}
+
+/*
+Finds every tile the two rules can settle on the current board.
+Results are left in solver->safe and solver->mines.
+Returns false if memory runs out.
+*/
+bool SolveBoard(Solver *solver, const Game *game)
+{
+    int cellCount = game->rows * game->cols;
+
+    if (!ReserveSolver(solver, cellCount))
+        return false;
+
+    if (game->status != GAME_PLAYING)
+    {
+        solver->warm = false;
+        solver->safeCount = 0;
+        solver->mineCount = 0;
+        return true;
+    }
+
+    if (game->adjacency != NULL)
+    {
+        SolveAdjacent(solver, game);
+        return true;
+    }
+
+    if (!UpdateConstraints(solver, game))
+        CollectConstraints(solver, game);
+
+    DropOpenedResults(solver);
+
+    Propagate(solver, game);
+
+    return true;
+}
+
+/*
+Runs the rules, then elimination rounds (each followed by the rules
+again) until a round settles nothing new. Results are left in
+solver->safe and solver->mines. Boards of other topologies get the
+rules only. The matrix is taken from the game's arena and given
+back before returning.
+Returns false if memory runs out.
+*/
+bool SolveBoardLinear(Solver *solver, Game *game)
+{
+    if (!SolveBoard(solver, game))
+        return false;
+
+    if (game->status != GAME_PLAYING || game->adjacency != NULL)
+        return true;
+
+    for (;;)
+    {
+        int settled = LinearPass(solver, game);
+
+        if (settled < 0)
+            return false;
+
+        if (settled == 0)
+            return true;
+
+        Propagate(solver, game);
+    }
+}
+
+/*
+Takes the first result the player has not acted on yet.
+*/
+static bool PickHint(const Solver *solver, const Game *game, Move *hint)
+{
+    for (int i = 0; i < solver->safeCount; i++)
+    {
+        int index = solver->safe[i];
+
+        if (!game->cells[index].flagged)
+        {
+            hint->type = MOVE_REVEAL;
+            hint->row = index / game->cols;
+            hint->col = index % game->cols;
+            return true;
+        }
+    }
+
+    for (int i = 0; i < solver->mineCount; i++)
+    {
+        int index = solver->mines[i];
+
+        if (!game->cells[index].flagged)
+        {
+            hint->type = MOVE_FLAG;
+            hint->row = index / game->cols;
+            hint->col = index % game->cols;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+Suggests a move that is certainly correct: opening a safe tile,
+or else flagging a certain mine that is not flagged yet.
+The linear pass is only tried when the rules find nothing.
+Returns false if no certain move is found.
+*/
+bool FindHint(Solver *solver, Game *game, Move *hint)
+{
+    if (!SolveBoard(solver, game))
+        return false;
+
+    if (PickHint(solver, game, hint))
+        return true;
+
+    return SolveBoardLinear(solver, game) && PickHint(solver, game, hint);
+}
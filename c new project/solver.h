@@ -0,0 +1,95 @@
+
+// =============================================================
+// Solver
+// Finds tiles that are provably safe or provably mines using
+// only what the player can see: the numbers on opened tiles
+// =============================================================
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "engine.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// What the solver knows about a tile
+#define SOLVER_UNKNOWN 0
+#define SOLVER_SAFE 1
+#define SOLVER_MINE 2
+#define SOLVER_OPEN 3       // Already revealed on the board
+
+// Variables gathered into one elimination matrix before it is cut off
+#define SOLVER_MAX_LINEAR_VARIABLES 1024
+
+// -------------------- Data Structures --------------------
+
+/*
+"The hidden neighbours in mask hold exactly mines mines",
+read from one opened number.
+*/
+typedef struct
+{
+    int row;
+    int col;
+    uint32_t mask;      // Unknown neighbours, bit (dr + 1) * 3 + (dc + 1),
+                        // or on other topologies bit k for the tile's
+                        // k-th entry in its adjacency list
+    int mines;          // Mines left among them
+} SolverConstraint;
+
+/*
+Solver state and results. Deductions are kept between calls on the
+same game, so running it after every move only rechecks the numbers
+around tiles opened since the previous call.
+*/
+typedef struct
+{
+    bool warm;                  // Knowledge below belongs to the game below
+    uint64_t seed;
+    int rows;
+    int cols;
+
+    int cellCapacity;
+    uint8_t *knowledge;         // SOLVER_* for every tile
+    int *constraintAt;          // Constraint index of each tile, or -1
+    int *tileMark;              // Other topologies: constraint whose hidden
+                                // neighbours were last marked at each tile
+
+    SolverConstraint *constraints;
+    int constraintCount;
+    int constraintCapacity;
+
+    int *pending;               // Constraints waiting to be rechecked
+    bool *queued;
+    int pendingCount;
+
+    int *safe;                  // Results: hidden tiles proven safe
+    int safeCount;
+    int *mines;                 // Results: hidden tiles proven mines
+    int mineCount;
+
+    int *variableOf;            // Linear pass: column of each tile, or -1
+    int *groupCells;            // Tiles of the current matrix columns
+    int *groupNumbers;          // Constraints of the current matrix rows
+    bool *grouped;              // Constraint already used by a matrix
+    uint64_t *matrix;           // Rows of plus and minus bitsets, and
+    int *matrixTotals;          // the right-hand side of each row: scratch
+                                // in the game's arena during a linear pass
+} Solver;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+void InitSolver(Solver *solver);
+void FreeSolver(Solver *solver);
+bool ReserveSolver(Solver *solver, int cellCount);
+
+// Deduction
+bool SolveBoard(Solver *solver, const Game *game);
+bool SolveBoardLinear(Solver *solver, Game *game);
+bool FindHint(Solver *solver, Game *game, Move *hint);
+
+#endif
@@ -0,0 +1,146 @@
+
+// =============================================================
+// Pattern table generator
+// Writes pattern_table.h: for every state of a short row of
+// numbers against a wall of hidden tiles, the wall tiles that
+// are forced safe or forced mines. Run by 'make patterns'.
+//
+// A strip of n numbers touches n + 2 wall tiles; number i sees
+// wall tiles i, i + 1 and i + 2. A state packs the mines still
+// missing around each number (2 bits each, number 0 lowest)
+// followed by the mask of wall tiles that are still unknown.
+// An entry holds the safe tiles in its low byte and the mines
+// in its high byte; 0 means nothing is forced (or no layout fits).
+//
+// It also writes the solver's spread table, which places each 3x3
+// neighbour mask around the centre of the solver's 8x8 window.
+// Being constant data, the table is shared by solver threads
+// without any setup.
+// =============================================================
+
+#include <stdio.h>
+
+// Solver window, as in solver.c
+#define WINDOW_CENTER 3
+#define WINDOW_STRIDE 8
+
+/*
+Finds the forced wall tiles of one state by trying every layout.
+*/
+static unsigned ResolveState(int numbers, unsigned state)
+{
+    int wallCount = numbers + 2;
+    unsigned unknown = state >> (2 * numbers);
+    unsigned alwaysMine = unknown;
+    unsigned neverMine = unknown;
+    int layouts = 0;
+
+    for (unsigned layout = 0; layout < (1u << wallCount); layout++)
+    {
+        // Mines may only sit on unknown wall tiles
+        if (layout & ~unknown)
+            continue;
+
+        int fits = 1;
+
+        for (int i = 0; i < numbers && fits; i++)
+        {
+            int missing = (int)((state >> (2 * i)) & 3);
+            int seen = __builtin_popcount(layout & (7u << i));
+
+            fits = (seen == missing);
+        }
+
+        if (!fits)
+            continue;
+
+        alwaysMine &= layout;
+        neverMine &= ~layout;
+        layouts++;
+    }
+
+    if (layouts == 0)
+        return 0;
+
+    return neverMine | (alwaysMine << 8);
+}
+
+/*
+Prints one table as a C array.
+*/
+static void WriteTable(int numbers)
+{
+    unsigned stateCount = 1u << (2 * numbers + numbers + 2);
+
+    printf("// Strips of %d numbers: %u states\n", numbers, stateCount);
+    printf("static const uint16_t patternTable%d[%u] = {\n", numbers, stateCount);
+
+    for (unsigned state = 0; state < stateCount; state++)
+    {
+        if (state % 12 == 0)
+            printf("   ");
+
+        printf(" 0x%04X,", ResolveState(numbers, state));
+
+        if (state % 12 == 11 || state + 1 == stateCount)
+            printf("\n");
+    }
+
+    printf("};\n\n");
+}
+
+/*
+Prints the neighbour mask of each 3x3 pattern, placed around the
+window centre.
+*/
+static void WriteSpreadTable(void)
+{
+    printf("// 3x3 neighbour masks placed in the solver window\n");
+    printf("static const uint64_t spreadTable[512] = {\n");
+
+    for (int mask = 0; mask < 512; mask++)
+    {
+        unsigned long long spread = 0;
+
+        for (int bit = 0; bit < 9; bit++)
+        {
+            if (mask & (1 << bit))
+            {
+                int r = WINDOW_CENTER + bit / 3 - 1;
+                int c = WINDOW_CENTER + bit % 3 - 1;
+
+                spread |= 1ull << (r * WINDOW_STRIDE + c);
+            }
+        }
+
+        if (mask % 4 == 0)
+            printf("   ");
+
+        printf(" 0x%016llXull,", spread);
+
+        if (mask % 4 == 3)
+            printf("\n");
+    }
+
+    printf("};\n\n");
+}
+
+int main(void)
+{
+    printf("\n");
+    printf("// =============================================================\n");
+    printf("// Pattern table\n");
+    printf("// Generated by tools/generate_patterns.c - do not edit\n");
+    printf("// =============================================================\n\n");
+    printf("#ifndef PATTERN_TABLE_H\n");
+    printf("#define PATTERN_TABLE_H\n\n");
+    printf("#include <stdint.h>\n\n");
+
+    WriteTable(3);
+    WriteTable(4);
+    WriteSpreadTable();
+
+    printf("#endif\n");
+
+    return 0;
+}
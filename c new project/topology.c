@@ -0,0 +1,266 @@
+
+// =============================================================
+// Board topology
+//
+// Tables are built once per board shape and shared read-only by
+// every game of that shape. Lists are sorted and free of repeats,
+// which matters on boards too narrow for the wrap-around of a
+// torus to reach distinct tiles.
+// =============================================================
+
+#include "topology.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *topologyNames[TOPOLOGY_COUNT] = {"square", "torus", "hex", "cube"};
+
+// =============================================================
+//                         NEIGHBOURS
+// =============================================================
+
+/*
+Adds a tile to a sorted list unless it is already there.
+*/
+static void AddNeighbour(int *list, int *count, int index)
+{
+    int at = *count;
+
+    while (at > 0 && list[at - 1] > index)
+        at--;
+
+    if (at > 0 && list[at - 1] == index)
+        return;
+
+    memmove(&list[at + 1], &list[at], (size_t)(*count - at) * sizeof(int));
+    list[at] = index;
+    (*count)++;
+}
+
+/*
+Writes the neighbours of tile (row, col) into list, sorted.
+Returns how many there are.
+*/
+static int CollectNeighbours(const BoardAdjacency *adjacency, int row, int col, int *list)
+{
+    int rows = adjacency->rows;
+    int cols = adjacency->cols;
+    int self = row * cols + col;
+    int count = 0;
+
+    switch (adjacency->kind)
+    {
+    case TOPOLOGY_SQUARE:
+    case TOPOLOGY_TORUS:
+        for (int dr = -1; dr <= 1; dr++)
+        {
+            for (int dc = -1; dc <= 1; dc++)
+            {
+                int r = row + dr;
+                int c = col + dc;
+
+                if (adjacency->kind == TOPOLOGY_TORUS)
+                {
+                    r = (r + rows) % rows;
+                    c = (c + cols) % cols;
+                }
+                else if (r < 0 || r >= rows || c < 0 || c >= cols)
+                    continue;
+
+                if (r * cols + c != self)
+                    AddNeighbour(list, &count, r * cols + c);
+            }
+        }
+        break;
+
+    case TOPOLOGY_HEX:
+    {
+        // Rows above and below touch the tile's column and the one
+        // on the side its row is shifted towards
+        int side = (row & 1) ? 1 : -1;
+        static const int rowSteps[6] = {-1, -1, 0, 0, 1, 1};
+        int colSteps[6] = {0, side, -1, 1, 0, side};
+
+        for (int k = 0; k < 6; k++)
+        {
+            int r = row + rowSteps[k];
+            int c = col + colSteps[k];
+
+            if (r >= 0 && r < rows && c >= 0 && c < cols)
+                AddNeighbour(list, &count, r * cols + c);
+        }
+        break;
+    }
+
+    case TOPOLOGY_CUBE:
+    {
+        int layerRows = rows / adjacency->layers;
+        int layer = row / layerRows;
+        int y = row % layerRows;
+
+        for (int dz = -1; dz <= 1; dz++)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    int z = layer + dz;
+                    int r = y + dy;
+                    int c = col + dx;
+
+                    if ((dz == 0 && dy == 0 && dx == 0) || z < 0 || z >= adjacency->layers
+                        || r < 0 || r >= layerRows || c < 0 || c >= cols)
+                        continue;
+
+                    AddNeighbour(list, &count, (z * layerRows + r) * cols + c);
+                }
+            }
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return count;
+}
+
+/*
+Fills the offsets of the neighbours of inner tiles, in the order
+CollectNeighbours() gives them.
+*/
+static void FillInnerSteps(BoardAdjacency *adjacency)
+{
+    int cols = adjacency->cols;
+
+    for (int parity = 0; parity < 2; parity++)
+    {
+        int count = 0;
+
+        if (adjacency->kind == TOPOLOGY_HEX)
+        {
+            int side = parity ? 1 : -1;
+            int steps[6] = {-cols + (side < 0 ? -1 : 0), -cols + (side < 0 ? 0 : 1), -1, 1,
+                            cols + (side < 0 ? -1 : 0), cols + (side < 0 ? 0 : 1)};
+
+            for (int k = 0; k < 6; k++)
+                adjacency->innerSteps[parity][count++] = steps[k];
+        }
+        else
+        {
+            int layerSize = (adjacency->kind == TOPOLOGY_CUBE) ? (adjacency->rows / adjacency->layers) * cols : 0;
+            int depth = (adjacency->kind == TOPOLOGY_CUBE) ? 1 : 0;
+
+            for (int dz = -depth; dz <= depth; dz++)
+            {
+                for (int dy = -1; dy <= 1; dy++)
+                {
+                    for (int dx = -1; dx <= 1; dx++)
+                    {
+                        if (dz != 0 || dy != 0 || dx != 0)
+                            adjacency->innerSteps[parity][count++] = dz * layerSize + dy * cols + dx;
+                    }
+                }
+            }
+        }
+
+        adjacency->innerDegree = count;
+    }
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Builds the neighbour lists of a rows x cols board. layers is used
+by TOPOLOGY_CUBE only and must divide rows. Returns false if the
+shape is invalid or memory runs out.
+*/
+bool BuildBoardAdjacency(BoardAdjacency *adjacency, TopologyKind kind, int rows, int cols, int layers)
+{
+    memset(adjacency, 0, sizeof(*adjacency));
+
+    if (kind >= TOPOLOGY_COUNT || rows <= 0 || cols <= 0 || (long long)rows * cols > INT_MAX)
+        return false;
+
+    if (kind != TOPOLOGY_CUBE)
+        layers = 1;
+    else if (layers <= 0 || rows % layers != 0)
+        return false;
+
+    adjacency->kind = kind;
+    adjacency->rows = rows;
+    adjacency->cols = cols;
+    adjacency->layers = layers;
+    adjacency->cellCount = rows * cols;
+
+    FillInnerSteps(adjacency);
+
+    adjacency->first = malloc(((size_t)adjacency->cellCount + 1) * sizeof(int));
+
+    if (adjacency->first == NULL)
+        return false;
+
+    // First pass sizes the table, second fills it
+    int list[TOPOLOGY_MAX_DEGREE];
+    long long total = 0;
+
+    for (int i = 0; i < adjacency->cellCount; i++)
+    {
+        int count = CollectNeighbours(adjacency, i / cols, i % cols, list);
+
+        adjacency->first[i] = (int)total;
+        total += count;
+
+        if (count > adjacency->maxDegree)
+            adjacency->maxDegree = count;
+
+        if (total > INT_MAX)
+        {
+            FreeBoardAdjacency(adjacency);
+            return false;
+        }
+    }
+
+    adjacency->first[adjacency->cellCount] = (int)total;
+    adjacency->neighbours = malloc((size_t)(total > 0 ? total : 1) * sizeof(int));
+
+    if (adjacency->neighbours == NULL)
+    {
+        FreeBoardAdjacency(adjacency);
+        return false;
+    }
+
+    for (int i = 0; i < adjacency->cellCount; i++)
+        CollectNeighbours(adjacency, i / cols, i % cols, &adjacency->neighbours[adjacency->first[i]]);
+
+    return true;
+}
+
+/*
+Releases the tables.
+*/
+void FreeBoardAdjacency(BoardAdjacency *adjacency)
+{
+    free(adjacency->first);
+    free(adjacency->neighbours);
+
+    adjacency->first = NULL;
+    adjacency->neighbours = NULL;
+    adjacency->cellCount = 0;
+    adjacency->maxDegree = 0;
+}
+
+// =============================================================
+//                           NAMES
+// =============================================================
+
+/*
+Name of a topology as printed by the topology benchmark.
+*/
+const char *TopologyName(TopologyKind kind)
+{
+    return (kind < TOPOLOGY_COUNT) ? topologyNames[kind] : "unknown";
+}
@@ -0,0 +1,100 @@
+
+// =============================================================
+// Board topology
+// Which tiles touch which. The classic square board is handled
+// by the engine's fixed offsets; other shapes (wrapping torus,
+// hexagonal, stacked 3D layers) are described by a precomputed
+// adjacency table that the engine and solver walk instead. Tiles
+// away from every edge have the same neighbours at fixed index
+// offsets, so hot loops only need the table near the edges. Only
+// the topology benchmark builds the other shapes: the game, the
+// renderer, metrics and the probability engine play square boards
+// =============================================================
+
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdbool.h>
+
+// -------------------- Constants --------------------
+
+// Most neighbours a tile has in any topology (3D: 3 x 3 x 3 - 1)
+#define TOPOLOGY_MAX_DEGREE 26
+
+// -------------------- Data Structures --------------------
+
+/*
+How the tiles of a rows x cols board are connected.
+*/
+typedef enum
+{
+    TOPOLOGY_SQUARE,    // Eight neighbours, edges are walls
+    TOPOLOGY_TORUS,     // Eight neighbours, edges wrap around
+    TOPOLOGY_HEX,       // Six neighbours, odd rows shifted half a tile right
+    TOPOLOGY_CUBE,      // 26 neighbours: the rows are split into layers
+                        // stacked on top of each other
+    TOPOLOGY_COUNT
+} TopologyKind;
+
+/*
+Neighbour lists of every tile in compressed sparse row form: the
+neighbours of tile i are neighbours[first[i]] .. neighbours[first[i + 1] - 1],
+in increasing index order and without repeats.
+*/
+typedef struct
+{
+    TopologyKind kind;
+    int rows;
+    int cols;
+    int layers;             // TOPOLOGY_CUBE: layers of rows / layers rows
+    int cellCount;
+    int maxDegree;          // Longest neighbour list
+
+    int innerDegree;                            // Neighbours of an inner tile
+    int innerSteps[2][TOPOLOGY_MAX_DEGREE];     // Index offsets of those, by row
+                                                // parity (they differ on hex)
+
+    int *first;             // cellCount + 1 offsets into neighbours
+    int *neighbours;
+} BoardAdjacency;
+
+// -------------------- Board Access --------------------
+
+/*
+Neighbour list of a tile; count receives its length.
+*/
+static inline const int *TileNeighbours(const BoardAdjacency *adjacency, int index, int *count)
+{
+    *count = adjacency->first[index + 1] - adjacency->first[index];
+
+    return &adjacency->neighbours[adjacency->first[index]];
+}
+
+/*
+Checks whether a tile is away from every edge, so its neighbours
+are the innerSteps[row & 1] offsets from it.
+*/
+static inline bool IsInnerTile(const BoardAdjacency *adjacency, int row, int col)
+{
+    if ((unsigned)(col - 1) >= (unsigned)(adjacency->cols - 2))
+        return false;
+
+    if (adjacency->kind != TOPOLOGY_CUBE)
+        return (unsigned)(row - 1) < (unsigned)(adjacency->rows - 2);
+
+    int layerRows = adjacency->rows / adjacency->layers;
+
+    return (unsigned)(row % layerRows - 1) < (unsigned)(layerRows - 2)
+           && (unsigned)(row / layerRows - 1) < (unsigned)(adjacency->layers - 2);
+}
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool BuildBoardAdjacency(BoardAdjacency *adjacency, TopologyKind kind, int rows, int cols, int layers);
+void FreeBoardAdjacency(BoardAdjacency *adjacency);
+
+// Names
+const char *TopologyName(TopologyKind kind);
+
+#endif
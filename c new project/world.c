@@ -0,0 +1,716 @@
+
+// =============================================================
+// Endless world
+//
+// Whether a tile holds a mine is a pure function of the seed and
+// its position: the position is mixed into the seed and run
+// through the same finalizer as NextRandom(), and the result is
+// compared with a threshold set by the density. No state is kept
+// for tiles nobody has looked at.
+//
+// Tiles that play has touched live in 64x64 chunks, found through
+// an open-addressing hash table on the chunk position. A new
+// chunk gets its mines and numbers at once; the numbers on its
+// edges read the hash of the neighbouring chunks' tiles, so
+// chunks never need each other to exist. Memory therefore grows
+// with the area explored, not with the size of the world.
+//
+// Every chunk is also on a recently used list. With a chunk store
+// attached, the oldest chunks are evicted once maxChunks are in
+// memory: chunks play has changed are written to the store first,
+// the others are dropped since the hash deals them again. A miss
+// reads the chunk back from the store if it has a copy.
+// =============================================================
+
+#include "world.h"
+#include "chunkstore.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Tiles farther than this from the origin do not exist, which
+// keeps neighbour arithmetic far from integer overflow
+#define WORLD_LIMIT (1 << 30)
+
+// Chunks in a new table (a power of two)
+#define INITIAL_SLOTS 64
+
+// Search radius for a starting opening around the origin
+#define START_SEARCH_RADIUS (4 * WORLD_CHUNK_SIZE)
+
+// =============================================================
+//                          HELPERS
+// =============================================================
+
+/*
+Checks whether a position lies inside the world.
+*/
+static inline bool InsideWorld(int32_t x, int32_t y)
+{
+    return (x > -WORLD_LIMIT && x < WORLD_LIMIT) && (y > -WORLD_LIMIT && y < WORLD_LIMIT);
+}
+
+/*
+Chunk coordinate of a tile coordinate, rounding towards minus
+infinity for negative positions.
+*/
+static inline int32_t ChunkOf(int32_t coordinate)
+{
+    return (coordinate >= 0) ? (coordinate >> WORLD_CHUNK_SHIFT) : ~(~coordinate >> WORLD_CHUNK_SHIFT);
+}
+
+/*
+Slot a chunk position hashes to.
+*/
+static inline int SlotOf(const World *world, int32_t chunkX, int32_t chunkY)
+{
+    uint64_t key = ((uint64_t)(uint32_t)chunkX << 32) | (uint32_t)chunkY;
+
+    return (int)(NextRandom(&key) & (uint64_t)(world->slotCapacity - 1));
+}
+
+/*
+Checks whether a tile holds a mine, from the seed alone.
+*/
+bool IsWorldMine(const World *world, int32_t x, int32_t y)
+{
+    uint64_t state = world->seed ^ (((uint64_t)(uint32_t)x << 32) | (uint32_t)y);
+
+    return InsideWorld(x, y) && NextRandom(&state) < world->mineThreshold;
+}
+
+// =============================================================
+//                          LIFETIME
+// =============================================================
+
+/*
+Starts an empty world. density is the chance of a tile holding a
+mine and is clamped to WORLD_MIN_DENSITY..WORLD_MAX_DENSITY.
+Returns false if memory runs out.
+*/
+bool InitWorld(World *world, uint64_t seed, double density)
+{
+    if (density < WORLD_MIN_DENSITY)
+        density = WORLD_MIN_DENSITY;
+    if (density > WORLD_MAX_DENSITY)
+        density = WORLD_MAX_DENSITY;
+
+    world->seed = seed;
+    world->mineThreshold = (uint64_t)(density * 18446744073709551616.0);
+
+    world->slotCapacity = INITIAL_SLOTS;
+    world->slots = CountedCalloc((size_t)world->slotCapacity, sizeof(WorldChunk *));
+    world->chunkCount = 0;
+    world->lastChunk = NULL;
+    world->newest = NULL;
+    world->oldest = NULL;
+
+    world->store = NULL;
+    world->maxChunks = 0;
+    world->chunkHits = 0;
+    world->chunkMisses = 0;
+    world->chunksCreated = 0;
+    world->chunksLoaded = 0;
+    world->chunksEvicted = 0;
+
+    world->worklist = NULL;
+    world->worklistCapacity = 0;
+
+    world->status = GAME_PLAYING;
+    world->revealedSafe = 0;
+    world->flaggedCount = 0;
+
+    return world->slots != NULL;
+}
+
+/*
+Releases every chunk. An attached chunk store stays open.
+*/
+void FreeWorld(World *world)
+{
+    for (int s = 0; s < world->slotCapacity; s++)
+        free(world->slots[s]);
+
+    free(world->slots);
+    free(world->worklist);
+
+    world->slots = NULL;
+    world->slotCapacity = 0;
+    world->chunkCount = 0;
+    world->lastChunk = NULL;
+    world->newest = NULL;
+    world->oldest = NULL;
+    world->store = NULL;
+    world->worklist = NULL;
+    world->worklistCapacity = 0;
+}
+
+/*
+Keeps at most maxChunks chunks in memory (at least
+WORLD_MIN_RESIDENT_CHUNKS), sending the rest to store. The store
+must be open for the world's seed and outlive its use here.
+*/
+void AttachChunkStore(World *world, ChunkStore *store, int maxChunks)
+{
+    world->store = store;
+    world->maxChunks = (maxChunks > WORLD_MIN_RESIDENT_CHUNKS) ? maxChunks : WORLD_MIN_RESIDENT_CHUNKS;
+}
+
+/*
+Memory held by the world, in bytes.
+*/
+size_t WorldMemoryBytes(const World *world)
+{
+    size_t index = (world->store != NULL) ? (size_t)world->store->indexCapacity * sizeof(ChunkIndexEntry) : 0;
+
+    return (size_t)world->chunkCount * sizeof(WorldChunk)
+           + (size_t)world->slotCapacity * sizeof(WorldChunk *)
+           + (size_t)world->worklistCapacity * sizeof(WorldPoint)
+           + index;
+}
+
+// =============================================================
+//                           CHUNKS
+// =============================================================
+
+/*
+Slot holding a chunk, or the empty slot it would go in.
+*/
+static int FindChunkSlot(const World *world, int32_t chunkX, int32_t chunkY)
+{
+    int mask = world->slotCapacity - 1;
+
+    for (int s = SlotOf(world, chunkX, chunkY);; s = (s + 1) & mask)
+    {
+        const WorldChunk *chunk = world->slots[s];
+
+        if (chunk == NULL || (chunk->chunkX == chunkX && chunk->chunkY == chunkY))
+            return s;
+    }
+}
+
+/*
+Looks up a chunk in memory. Returns NULL if it is not there.
+*/
+static WorldChunk *FindChunk(const World *world, int32_t chunkX, int32_t chunkY)
+{
+    return world->slots[FindChunkSlot(world, chunkX, chunkY)];
+}
+
+/*
+Takes a chunk off the recently used list.
+*/
+static void UnlinkChunk(World *world, WorldChunk *chunk)
+{
+    if (chunk->newer != NULL)
+        chunk->newer->older = chunk->older;
+    else
+        world->newest = chunk->older;
+
+    if (chunk->older != NULL)
+        chunk->older->newer = chunk->newer;
+    else
+        world->oldest = chunk->newer;
+}
+
+/*
+Puts a chunk at the recently used end of the list.
+*/
+static void LinkNewestChunk(World *world, WorldChunk *chunk)
+{
+    chunk->newer = NULL;
+    chunk->older = world->newest;
+
+    if (world->newest != NULL)
+        world->newest->newer = chunk;
+    else
+        world->oldest = chunk;
+
+    world->newest = chunk;
+}
+
+/*
+Empties a table slot, moving later chunks of the same probe run
+back so lookups never stop early.
+*/
+static void RemoveChunkSlot(World *world, int slot)
+{
+    int mask = world->slotCapacity - 1;
+
+    world->slots[slot] = NULL;
+
+    for (int next = (slot + 1) & mask; world->slots[next] != NULL; next = (next + 1) & mask)
+    {
+        const WorldChunk *chunk = world->slots[next];
+        int home = SlotOf(world, chunk->chunkX, chunk->chunkY);
+
+        // Move it if the hole lies between its home slot and where it is
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            world->slots[slot] = world->slots[next];
+            world->slots[next] = NULL;
+            slot = next;
+        }
+    }
+}
+
+/*
+Evicts the least recently used chunks until one more fits in the
+budget, writing changed ones to the store first. Stops early (and
+lets memory grow) if the store cannot take a chunk.
+*/
+static void EvictChunks(World *world)
+{
+    while (world->store != NULL && world->chunkCount >= world->maxChunks)
+    {
+        WorldChunk *victim = world->oldest;
+
+        if (victim->dirty && !WriteStoredChunk(world->store, victim))
+            return;
+
+        UnlinkChunk(world, victim);
+        RemoveChunkSlot(world, FindChunkSlot(world, victim->chunkX, victim->chunkY));
+
+        if (world->lastChunk == victim)
+            world->lastChunk = NULL;
+
+        free(victim);
+        world->chunkCount--;
+        world->chunksEvicted++;
+    }
+}
+
+/*
+Doubles the chunk table once it is half full.
+*/
+static bool GrowChunkTable(World *world)
+{
+    if (2 * (world->chunkCount + 1) <= world->slotCapacity)
+        return true;
+
+    WorldChunk **old = world->slots;
+    int oldCapacity = world->slotCapacity;
+    WorldChunk **slots = CountedCalloc((size_t)oldCapacity * 2, sizeof(WorldChunk *));
+
+    if (slots == NULL)
+        return false;
+
+    world->slots = slots;
+    world->slotCapacity = oldCapacity * 2;
+
+    for (int s = 0; s < oldCapacity; s++)
+    {
+        if (old[s] == NULL)
+            continue;
+
+        int slot = SlotOf(world, old[s]->chunkX, old[s]->chunkY);
+
+        while (slots[slot] != NULL)
+            slot = (slot + 1) & (world->slotCapacity - 1);
+
+        slots[slot] = old[s];
+    }
+
+    free(old);
+
+    return true;
+}
+
+/*
+Deals the mines and numbers of the chunk at chunk->chunkX,
+chunk->chunkY. Reads nothing but the seed and density, so any
+thread may call it while the world is in use.
+*/
+void FillWorldChunk(const World *world, WorldChunk *chunk)
+{
+    // Mines of the chunk and a one-tile ring around it
+    enum { SPAN = WORLD_CHUNK_SIZE + 2 };
+    uint8_t mines[SPAN * SPAN];
+
+    int32_t left = chunk->chunkX * WORLD_CHUNK_SIZE - 1;
+    int32_t top = chunk->chunkY * WORLD_CHUNK_SIZE - 1;
+
+    for (int r = 0; r < SPAN; r++)
+    {
+        for (int c = 0; c < SPAN; c++)
+            mines[r * SPAN + c] = IsWorldMine(world, left + c, top + r);
+    }
+
+    for (int r = 0; r < WORLD_CHUNK_SIZE; r++)
+    {
+        for (int c = 0; c < WORLD_CHUNK_SIZE; c++)
+        {
+            const uint8_t *above = &mines[r * SPAN + c];
+            const uint8_t *middle = above + SPAN;
+            const uint8_t *below = middle + SPAN;
+
+            int count = above[0] + above[1] + above[2] + middle[0] + middle[2] + below[0] + below[1] + below[2];
+
+            chunk->tiles[r * WORLD_CHUNK_SIZE + c] = (uint8_t)(count | (middle[1] ? WORLD_TILE_MINE : 0));
+        }
+    }
+
+    chunk->dirty = false;
+    chunk->version = 0;
+}
+
+/*
+Adds a chunk to the table and the recently used list.
+Returns false if memory runs out.
+*/
+static bool InsertChunk(World *world, WorldChunk *chunk)
+{
+    if (!GrowChunkTable(world))
+        return false;
+
+    world->slots[FindChunkSlot(world, chunk->chunkX, chunk->chunkY)] = chunk;
+    world->chunkCount++;
+    LinkNewestChunk(world, chunk);
+
+    return true;
+}
+
+/*
+Creates a chunk with its mines and numbers.
+Returns NULL if memory runs out.
+*/
+static WorldChunk *CreateChunk(World *world, int32_t chunkX, int32_t chunkY)
+{
+    WorldChunk *chunk = CountedMalloc(sizeof(WorldChunk));
+
+    if (chunk == NULL)
+        return NULL;
+
+    chunk->chunkX = chunkX;
+    chunk->chunkY = chunkY;
+    FillWorldChunk(world, chunk);
+
+    if (!InsertChunk(world, chunk))
+    {
+        free(chunk);
+        return NULL;
+    }
+
+    return chunk;
+}
+
+/*
+Returns a chunk, making it the most recently used. A chunk not in
+memory is read back from the store or else dealt from the hash.
+Returns NULL if memory runs out.
+*/
+static WorldChunk *GetChunk(World *world, int32_t chunkX, int32_t chunkY)
+{
+    WorldChunk *chunk = FindChunk(world, chunkX, chunkY);
+
+    if (chunk != NULL)
+    {
+        world->chunkHits++;
+        UnlinkChunk(world, chunk);
+        LinkNewestChunk(world, chunk);
+
+        return chunk;
+    }
+
+    world->chunkMisses++;
+    EvictChunks(world);
+
+    chunk = CreateChunk(world, chunkX, chunkY);
+
+    if (chunk != NULL && world->store != NULL && ReadStoredChunk(world->store, chunk))
+        world->chunksLoaded++;
+    else if (chunk != NULL)
+        world->chunksCreated++;
+
+    return chunk;
+}
+
+/*
+Returns the tile at a position, bringing its chunk into memory.
+Callers that change the tile mark world->lastChunk dirty.
+Returns NULL if memory runs out.
+*/
+static uint8_t *WorldTile(World *world, int32_t x, int32_t y)
+{
+    int32_t chunkX = ChunkOf(x);
+    int32_t chunkY = ChunkOf(y);
+    WorldChunk *chunk = world->lastChunk;
+
+    if (chunk == NULL || chunk->chunkX != chunkX || chunk->chunkY != chunkY)
+    {
+        chunk = GetChunk(world, chunkX, chunkY);
+
+        if (chunk == NULL)
+            return NULL;
+
+        world->lastChunk = chunk;
+    }
+
+    return &chunk->tiles[(y & WORLD_CHUNK_MASK) * WORLD_CHUNK_SIZE + (x & WORLD_CHUNK_MASK)];
+}
+
+/*
+Reads a tile without creating or loading anything. Tiles of chunks
+not in memory read as 0: hidden, unflagged, number unknown. Use
+LoadWorldArea() first for tiles that may have been evicted.
+*/
+uint8_t PeekWorldTile(const World *world, int32_t x, int32_t y)
+{
+    if (!InsideWorld(x, y))
+        return 0;
+
+    WorldChunk *chunk = FindChunk(world, ChunkOf(x), ChunkOf(y));
+
+    return (chunk != NULL) ? chunk->tiles[(y & WORLD_CHUNK_MASK) * WORLD_CHUNK_SIZE + (x & WORLD_CHUNK_MASK)] : 0;
+}
+
+/*
+Brings the chunks covering the tiles left..right, top..bottom into
+memory if they were evicted, and marks the rest as recently used.
+Chunks never touched stay uncreated. The area should span fewer
+chunks than the memory budget.
+*/
+void LoadWorldArea(World *world, int32_t left, int32_t top, int32_t right, int32_t bottom)
+{
+    for (int32_t chunkY = ChunkOf(top); chunkY <= ChunkOf(bottom); chunkY++)
+    {
+        for (int32_t chunkX = ChunkOf(left); chunkX <= ChunkOf(right); chunkX++)
+        {
+            bool known = FindChunk(world, chunkX, chunkY) != NULL
+                         || (world->store != NULL && HasStoredChunk(world->store, chunkX, chunkY));
+
+            if (known)
+                world->lastChunk = GetChunk(world, chunkX, chunkY);
+        }
+    }
+}
+
+/*
+Checks whether a chunk is in memory.
+*/
+bool IsWorldChunkLoaded(const World *world, int32_t chunkX, int32_t chunkY)
+{
+    return FindChunk(world, chunkX, chunkY) != NULL;
+}
+
+/*
+Takes over a chunk built by FillWorldChunk() (and possibly
+ReadStoredChunk()) on another thread. It is refused if the chunk
+is already in memory or the store was written since the copy was
+made; the caller then frees it. Returns true if it was added.
+*/
+bool AdoptWorldChunk(World *world, WorldChunk *chunk)
+{
+    uint32_t version = (world->store != NULL) ? StoredChunkVersion(world->store, chunk->chunkX, chunk->chunkY) : 0;
+
+    if (chunk->version != version || FindChunk(world, chunk->chunkX, chunk->chunkY) != NULL)
+        return false;
+
+    EvictChunks(world);
+
+    return InsertChunk(world, chunk);
+}
+
+// =============================================================
+//                        GAME ACTIONS
+// =============================================================
+
+/*
+Makes sure the flood fill stack can hold needed entries.
+*/
+static bool GrowWorldWorklist(World *world, int needed)
+{
+    if (needed <= world->worklistCapacity)
+        return true;
+
+    int capacity = (world->worklistCapacity > 0) ? world->worklistCapacity * 2 : 1024;
+
+    while (capacity < needed)
+        capacity *= 2;
+
+    WorldPoint *worklist = CountedRealloc(world->worklist, (size_t)capacity * sizeof(WorldPoint));
+
+    if (worklist == NULL)
+        return false;
+
+    world->worklist = worklist;
+    world->worklistCapacity = capacity;
+
+    return true;
+}
+
+/*
+Opens the hidden neighbours of an opened empty tile and keeps
+going through every empty tile found, across chunk borders.
+Stops after WORLD_MAX_REVEAL tiles. Returns the tiles opened.
+*/
+static long FloodWorld(World *world, int32_t x, int32_t y)
+{
+    long opened = 0;
+    int top = 0;
+
+    if (!GrowWorldWorklist(world, 1))
+        return 0;
+
+    world->worklist[top++] = (WorldPoint){x, y};
+
+    while (top > 0 && opened < WORLD_MAX_REVEAL)
+    {
+        WorldPoint point = world->worklist[--top];
+
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                int32_t nx = point.x + dx;
+                int32_t ny = point.y + dy;
+
+                if (!InsideWorld(nx, ny))
+                    continue;
+
+                uint8_t *next = WorldTile(world, nx, ny);
+
+                if (next == NULL)
+                    return opened;
+
+                if (*next & (WORLD_TILE_REVEALED | WORLD_TILE_MINE))
+                    continue;
+
+                if (*next & WORLD_TILE_FLAGGED)
+                    world->flaggedCount--;
+
+                *next = (uint8_t)((*next & ~WORLD_TILE_FLAGGED) | WORLD_TILE_REVEALED);
+                world->lastChunk->dirty = true;
+                world->revealedSafe++;
+                opened++;
+
+                if ((*next & WORLD_TILE_COUNT) == 0)
+                {
+                    if (!GrowWorldWorklist(world, top + 1))
+                        return opened;
+
+                    world->worklist[top++] = (WorldPoint){nx, ny};
+                }
+            }
+        }
+    }
+
+    return opened;
+}
+
+/*
+Opens the area around an opened empty tile. Empty tiles a capped
+flood left with hidden neighbours continue when clicked again.
+*/
+void RevealWorldEmptyCells(World *world, int32_t x, int32_t y)
+{
+    FloodWorld(world, x, y);
+}
+
+/*
+Applies a move to the world; move.col is x and move.row is y.
+The world has no win, only a loss on a mine.
+*/
+MoveResult ApplyWorldMove(World *world, Move move)
+{
+    int32_t x = move.col;
+    int32_t y = move.row;
+
+    if (world->status != GAME_PLAYING || !InsideWorld(x, y))
+        return MOVE_IGNORED;
+
+    uint8_t *tile = WorldTile(world, x, y);
+
+    if (tile == NULL)
+        return MOVE_IGNORED;
+
+    if (move.type == MOVE_FLAG)
+    {
+        if (*tile & WORLD_TILE_REVEALED)
+            return MOVE_IGNORED;
+
+        *tile ^= WORLD_TILE_FLAGGED;
+        world->lastChunk->dirty = true;
+        world->flaggedCount += (*tile & WORLD_TILE_FLAGGED) ? 1 : -1;
+
+        return (*tile & WORLD_TILE_FLAGGED) ? MOVE_FLAGGED : MOVE_UNFLAGGED;
+    }
+
+    if (*tile & WORLD_TILE_FLAGGED)
+        return MOVE_IGNORED;
+
+    // An empty tile whose flood was cut short carries on
+    if (*tile & WORLD_TILE_REVEALED)
+    {
+        if ((*tile & WORLD_TILE_COUNT) != 0)
+            return MOVE_IGNORED;
+
+        return (FloodWorld(world, x, y) > 0) ? MOVE_OPENED : MOVE_IGNORED;
+    }
+
+    *tile |= WORLD_TILE_REVEALED;
+    world->lastChunk->dirty = true;
+
+    if (*tile & WORLD_TILE_MINE)
+    {
+        world->status = GAME_LOST;
+        return MOVE_EXPLODED;
+    }
+
+    world->revealedSafe++;
+
+    if ((*tile & WORLD_TILE_COUNT) == 0)
+        FloodWorld(world, x, y);
+
+    return MOVE_OPENED;
+}
+
+/*
+Opens the empty tile closest to the origin (or, failing that, a
+safe one) so play starts with an opening. Returns where it is.
+*/
+WorldPoint OpenWorldStart(World *world)
+{
+    WorldPoint safe = {0, 0};
+    bool foundSafe = false;
+
+    // Rings of growing radius around the origin
+    for (int radius = 0; radius <= START_SEARCH_RADIUS; radius++)
+    {
+        for (int32_t y = -radius; y <= radius; y++)
+        {
+            for (int32_t x = -radius; x <= radius; x++)
+            {
+                if (abs(x) != radius && abs(y) != radius)
+                    continue;
+
+                if (IsWorldMine(world, x, y))
+                    continue;
+
+                if (!foundSafe)
+                {
+                    safe = (WorldPoint){x, y};
+                    foundSafe = true;
+                }
+
+                bool empty = true;
+
+                for (int dy = -1; dy <= 1 && empty; dy++)
+                {
+                    for (int dx = -1; dx <= 1 && empty; dx++)
+                        empty = !IsWorldMine(world, x + dx, y + dy);
+                }
+
+                if (empty)
+                {
+                    ApplyWorldMove(world, (Move){MOVE_REVEAL, y, x});
+                    return (WorldPoint){x, y};
+                }
+            }
+        }
+    }
+
+    if (foundSafe)
+        ApplyWorldMove(world, (Move){MOVE_REVEAL, safe.y, safe.x});
+
+    return safe;
+}
@@ -0,0 +1,127 @@
+
+// =============================================================
+// Endless world
+// A board without edges: mines come from a hash of the seed and
+// the tile position, and tiles are stored in chunks that are
+// only created once play reaches them. With a chunk store
+// attached, the least recently used chunks go to disk
+// =============================================================
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "engine.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// -------------------- Constants --------------------
+
+// Chunks are WORLD_CHUNK_SIZE tiles on a side
+#define WORLD_CHUNK_SHIFT 6
+#define WORLD_CHUNK_SIZE (1 << WORLD_CHUNK_SHIFT)
+#define WORLD_CHUNK_MASK (WORLD_CHUNK_SIZE - 1)
+
+// Tile byte: neighbour count in the low bits, then flags
+#define WORLD_TILE_COUNT 0x0F
+#define WORLD_TILE_MINE 0x10
+#define WORLD_TILE_REVEALED 0x20
+#define WORLD_TILE_FLAGGED 0x40
+
+// Mine densities allowed. Below the minimum, empty areas can grow
+// without end and a single click would never finish opening
+#define WORLD_MIN_DENSITY 0.12
+#define WORLD_MAX_DENSITY 0.9
+
+// Most tiles one click opens; the rest of a huge area stays hidden
+// until it is clicked
+#define WORLD_MAX_REVEAL (1 << 20)
+
+// Fewest chunks kept in memory with a chunk store attached
+#define WORLD_MIN_RESIDENT_CHUNKS 16
+
+// -------------------- Data Structures --------------------
+
+// Spill file for chunks, defined in chunkstore.h
+typedef struct ChunkStore ChunkStore;
+
+/*
+A square of tiles, created with its mines and numbers filled in.
+*/
+typedef struct WorldChunk
+{
+    int32_t chunkX;         // Position in chunks
+    int32_t chunkY;
+    struct WorldChunk *newer;   // Neighbours in the recently used list
+    struct WorldChunk *older;
+    bool dirty;             // Changed since it was created or loaded
+    uint32_t version;       // Store record it was loaded from, 0 if dealt
+    uint8_t tiles[WORLD_CHUNK_SIZE * WORLD_CHUNK_SIZE];   // Row-major
+} WorldChunk;
+
+/*
+Tile position in the world.
+*/
+typedef struct
+{
+    int32_t x;
+    int32_t y;
+} WorldPoint;
+
+/*
+Complete state of one endless game.
+*/
+typedef struct
+{
+    uint64_t seed;
+    uint64_t mineThreshold;     // Tile hashes below this are mines
+
+    WorldChunk **slots;         // Open-addressing table of chunks, NULL if empty
+    int slotCapacity;           // Power of two
+    int chunkCount;
+    WorldChunk *lastChunk;      // Most recent lookup, tried first
+    WorldChunk *newest;         // Recently used list of every chunk
+    WorldChunk *oldest;
+
+    ChunkStore *store;          // Where evicted chunks go, or NULL
+    int maxChunks;              // Chunks kept in memory with a store
+
+    // Chunk cache metrics (lookups that miss lastChunk)
+    long chunkHits;
+    long chunkMisses;
+    long chunksCreated;         // Misses dealt from the hash
+    long chunksLoaded;          // Misses read back from the store
+    long chunksEvicted;
+
+    WorldPoint *worklist;       // Scratch stack for flood fill
+    int worklistCapacity;
+
+    GameStatus status;          // Never GAME_WON
+    long revealedSafe;
+    long flaggedCount;
+} World;
+
+// -------------------- Function Prototypes --------------------
+
+// Lifetime
+bool InitWorld(World *world, uint64_t seed, double density);
+void FreeWorld(World *world);
+void AttachChunkStore(World *world, ChunkStore *store, int maxChunks);
+
+// Tiles
+bool IsWorldMine(const World *world, int32_t x, int32_t y);
+uint8_t PeekWorldTile(const World *world, int32_t x, int32_t y);
+size_t WorldMemoryBytes(const World *world);
+void LoadWorldArea(World *world, int32_t left, int32_t top, int32_t right, int32_t bottom);
+
+// Chunks made elsewhere (prefetch threads)
+void FillWorldChunk(const World *world, WorldChunk *chunk);
+bool IsWorldChunkLoaded(const World *world, int32_t chunkX, int32_t chunkY);
+bool AdoptWorldChunk(World *world, WorldChunk *chunk);
+
+// Game actions
+MoveResult ApplyWorldMove(World *world, Move move);
+void RevealWorldEmptyCells(World *world, int32_t x, int32_t y);
+WorldPoint OpenWorldStart(World *world);
+
+#endif